@@ -0,0 +1,4 @@
+color top white blue
+color bot black green
+color lst cyan  black
+color sel red   yellow
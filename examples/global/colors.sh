@@ -1,7 +0,0 @@
-#!/usr/bin/sh
-
-echo 'color top white blue'
-echo 'color bot black green'
-echo 'color lst cyan  black'
-echo 'color sel red   yellow'
-
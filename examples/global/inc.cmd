@@ -0,0 +1,2 @@
+source examples/global/keys.cmd
+source examples/global/colors.cmd
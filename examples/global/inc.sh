@@ -1,5 +0,0 @@
-#!/usr/bin/sh
-
-echo 'spawn source examples/global/keys.sh'
-echo 'spawn source examples/global/colors.sh'
-
@@ -1,21 +0,0 @@
-echo 'map i up'
-echo 'map k down'
-echo 'map j left'
-echo 'map l right'
-echo 'map [up] up'
-echo 'map [down] down'
-echo 'map [left] left'
-echo 'map [right] right'
-echo 'map t scroll toggle'
-echo 'map h hide toggle 10 20'
-
-echo 'map gg begin'
-echo 'map G end'
-echo 'map [home] begin'
-echo 'map [end] end'
-
-echo 'map p refresh'
-echo 'map :<Command : > exe %s'
-echo 'map m<Goto : > goto %s'
-echo 'map q quit'
-
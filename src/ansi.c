@@ -0,0 +1,147 @@
+
+#include "ansi.h"
+#include <string.h>
+
+size_t ansi_max_runs(const char* text, size_t len)
+{
+    const char* last = text + len;
+    size_t nb = 0;
+    while((text = memchr(text, '\033', last - text))) {
+        ++nb;
+        ++text;
+    }
+    return nb;
+}
+
+/* Apply the parameters of a SGR sequence to an attribute. */
+static uint16_t _ansi_sgr(const char* params, size_t len, uint16_t attr)
+{
+    const char* last = params + len;
+    unsigned int p;
+
+    /* An empty sequence is a reset. */
+    if(len == 0)
+        return ANSI_PLAIN;
+
+    while(params <= last) {
+        p = 0;
+        while(params < last && *params >= '0' && *params <= '9')
+            p = p * 10 + (*params++ - '0');
+
+        if(p == 0)
+            attr = ANSI_PLAIN;
+        else if(p == 1)
+            attr |= ANSI_BOLD;
+        else if(p == 4)
+            attr |= ANSI_UNDERLINE;
+        else if(p == 7)
+            attr |= ANSI_REVERSE;
+        else if(p == 22)
+            attr &= ~ANSI_BOLD;
+        else if(p == 24)
+            attr &= ~ANSI_UNDERLINE;
+        else if(p == 27)
+            attr &= ~ANSI_REVERSE;
+        else if(p >= 30 && p <= 37)
+            attr = (attr & ~0x0f) | (p - 30);
+        else if(p == 39)
+            attr = (attr & ~0x0f) | ANSI_DEFAULT;
+        else if(p >= 40 && p <= 47)
+            attr = (attr & ~0xf0) | ((p - 40) << 4);
+        else if(p == 49)
+            attr = (attr & ~0xf0) | (ANSI_DEFAULT << 4);
+        else if(p >= 90 && p <= 97)
+            attr = (attr & ~0x0f) | (p - 90) | ANSI_BOLD;
+        else if(p >= 100 && p <= 107)
+            attr = (attr & ~0xf0) | ((p - 100) << 4);
+        else if(p == 38 || p == 48) {
+            /* The 256 and true colors aren't supported : the rest of the
+             * sequence is ignored.
+             */
+            break;
+        }
+
+        if(params >= last)
+            break;
+        ++params; /* The ';'. */
+    }
+    return attr;
+}
+
+size_t ansi_parse(char* text, size_t len, ansi_run_t* runs, size_t* nb)
+{
+    size_t r, w, start;
+    uint16_t attr = ANSI_PLAIN;
+    uint16_t nattr;
+
+    *nb = 0;
+    r = w = 0;
+    while(r < len) {
+        if(text[r] != '\033') {
+            text[w++] = text[r++];
+            continue;
+        }
+
+        /* Other escape sequences than the CSI ones only have one byte, but the
+         * charset selections which have two.
+         */
+        if(r + 1 >= len || text[r + 1] != '[') {
+            r += (r + 1 < len && (text[r + 1] == '(' || text[r + 1] == ')')
+                    ? 3 : 2);
+            continue;
+        }
+
+        /* Reading up to the final byte of the CSI sequence. */
+        start = r + 2;
+        for(r = start; r < len; ++r) {
+            if(text[r] >= 0x40 && text[r] <= 0x7e)
+                break;
+        }
+        if(r >= len)
+            break;
+        ++r;
+        if(text[r - 1] != 'm')
+            continue;
+
+        nattr = _ansi_sgr(text + start, r - 1 - start, attr);
+        if(nattr == attr)
+            continue;
+        attr = nattr;
+        if(*nb > 0 && runs[*nb - 1].off == w)
+            runs[*nb - 1].attr = attr;
+        else {
+            runs[*nb].off  = w;
+            runs[*nb].attr = attr;
+            ++*nb;
+        }
+    }
+
+    /* A run at the end of the text is useless, and a plain text doesn't need
+     * any run.
+     */
+    if(*nb > 0 && runs[*nb - 1].off >= w)
+        --*nb;
+    if(*nb == 1 && runs[0].off == 0 && runs[0].attr == ANSI_PLAIN)
+        *nb = 0;
+    return (w < len ? w : len);
+}
+
+size_t ansi_find(const ansi_run_t* runs, size_t nb, size_t off)
+{
+    size_t low, high, mid;
+    if(nb == 0 || runs[0].off > off)
+        return nb;
+
+    /* The last run starting at off or before. */
+    low  = 0;
+    high = nb;
+    while(high - low > 1) {
+        mid = (low + high) / 2;
+        if(runs[mid].off <= off)
+            low = mid;
+        else
+            high = mid;
+    }
+    return low;
+}
+
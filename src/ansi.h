@@ -0,0 +1,52 @@
+
+#ifndef DEF_ANSI
+#define DEF_ANSI
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+/* The ansi module parses the SGR escape sequences (\033[...m) which color the
+ * output of programs like ls --color or grep --color. They are removed from
+ * the text, and the attributes they set are kept as a list of runs : each run
+ * gives the attribute of the text from its offset up to the next run.
+ */
+
+/* An attribute is made of a foreground color (bits 0-3), a background color
+ * (bits 4-7) and style flags. The colors are the eight colors of the
+ * terminals, or ANSI_DEFAULT to use the colors of the list.
+ */
+#define ANSI_DEFAULT   8
+#define ANSI_FG(attr)  ((attr) & 0xf)
+#define ANSI_BG(attr)  (((attr) >> 4) & 0xf)
+#define ANSI_BOLD      (1 << 8)
+#define ANSI_UNDERLINE (1 << 9)
+#define ANSI_REVERSE   (1 << 10)
+#define ANSI_PLAIN     (ANSI_DEFAULT | (ANSI_DEFAULT << 4))
+
+/* A run of text with the same attribute. */
+typedef struct _ansi_run_t {
+    /* The offset in the text of the start of the run. */
+    uint32_t off;
+    /* Its attribute. */
+    uint16_t attr;
+} ansi_run_t;
+
+/* Get the maximum number of runs the parsing of a text can give. */
+size_t ansi_max_runs(const char* text, size_t len);
+
+/* Remove the escape sequences from the len bytes of text, in place, and store
+ * the runs of the SGR sequences in runs, which must have room for
+ * ansi_max_runs(text, len) runs. Returns the new length of the text, and
+ * stores the number of runs in nb. There is no run if the whole text is
+ * plain.
+ */
+size_t ansi_parse(char* text, size_t len, ansi_run_t* runs, size_t* nb);
+
+/* Get the index of the run of the byte at off, or nb if it is before the
+ * first run (so plain).
+ */
+size_t ansi_find(const ansi_run_t* runs, size_t nb, size_t off);
+
+#endif
+
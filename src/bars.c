@@ -3,17 +3,26 @@
 #include "strformat.h"
 #include "feeder.h"
 #include "curses.h"
+#include "render.h"
 #include <stdio.h>
+#include <string.h>
+
+/* The symbols of the bars. */
+#define BARS_SYMBOLS "ntiIMFSB"
 
 static strformat_symbs_t* _bars_symbs;
 static strformat_t*       _bars_top;
 static strformat_t*       _bars_bot;
+/* The bitmask of the symbols the bars refer to : the others aren't computed.
+ */
+static unsigned int       _bars_deps;
 
 bool bars_init()
 {
-    _bars_top = NULL;
-    _bars_bot = NULL;
-    _bars_symbs = strformat_symbols("ntiI");
+    _bars_top   = NULL;
+    _bars_bot   = NULL;
+    _bars_deps  = 0;
+    _bars_symbs = strformat_symbols(BARS_SYMBOLS);
     return _bars_symbs;
 }
 
@@ -27,19 +36,54 @@ void bars_quit()
         strformat_destroy(_bars_bot);
 }
 
+/* Find the symbols the bars refer to. */
+static void _bars_deps_update()
+{
+    size_t i;
+
+    _bars_deps = 0;
+    for(i = 0; BARS_SYMBOLS[i]; ++i) {
+        if(strformat_uses(_bars_top, BARS_SYMBOLS[i])
+                || strformat_uses(_bars_bot, BARS_SYMBOLS[i]))
+            _bars_deps |= 1 << i;
+    }
+}
+
+/* Indicates if the bars refer to a symbol. */
+static bool _bars_uses(char symbol)
+{
+    return _bars_deps & (1 << (strchr(BARS_SYMBOLS, symbol) - BARS_SYMBOLS));
+}
+
+/* Set a symbol to a number if the bars refer to it. */
+static void _bars_number(char symbol, size_t nb)
+{
+    char buffer[32];
+    if(!_bars_uses(symbol))
+        return;
+    snprintf(buffer, 32, "%lu", nb);
+    strformat_set(_bars_symbs, symbol, buffer);
+}
+
 bool bars_top_set(const char* br)
 {
     if(_bars_top)
         strformat_destroy(_bars_top);
 
-    if(!br)
+    if(!br) {
         _bars_top = NULL;
+        curses_top_set(NULL);
+    }
     else {
         _bars_top = strformat_parse(_bars_symbs, br);
-        if(!_bars_top)
+        if(!_bars_top) {
+            curses_top_set(NULL);
+            _bars_deps_update();
             return false;
+        }
     }
-    bars_update();
+    _bars_deps_update();
+    render_mark();
     return true;
 }
 
@@ -48,44 +92,46 @@ bool bars_bot_set(const char* br)
     if(_bars_bot)
         strformat_destroy(_bars_bot);
 
-    if(!br)
+    if(!br) {
         _bars_bot = NULL;
+        curses_bot_set(NULL);
+    }
     else {
         _bars_bot = strformat_parse(_bars_symbs, br);
-        if(!_bars_bot)
+        if(!_bars_bot) {
+            curses_bot_set(NULL);
+            _bars_deps_update();
             return false;
+        }
     }
-    bars_update();
+    _bars_deps_update();
+    render_mark();
     return true;
 }
 
 void bars_update()
 {
-    size_t i;
     feeder_iterator_t it;
-    char buffer[256];
-
-    i = curses_list_get();
-    snprintf(buffer, 256, "%lu", i + 1);
-    strformat_set(_bars_symbs, 'i', buffer);
 
-    it = feeder_end();
-    snprintf(buffer, 256, "%lu", it.id);
-    strformat_set(_bars_symbs, 'I', buffer);
+    /* The symbols only change, and the bars are only built again, when their
+     * values do.
+     */
+    it = curses_list_selected();
+    _bars_number('i', it.vid + 1);
+    _bars_number('I', feeder_end().id);
+    _bars_number('M', feeder_marked());
+    _bars_number('F', render_drawn());
+    _bars_number('S', render_skipped());
+    _bars_number('B', curses_frame_bytes());
+    if(_bars_uses('n'))
+        strformat_set(_bars_symbs, 'n', feeder_get_it_name(it));
+    if(_bars_uses('t'))
+        strformat_set(_bars_symbs, 't', feeder_get_it_text(it));
 
-    it = feeder_begin();
-    feeder_next(&it, i);
-    strformat_set(_bars_symbs, 'n', feeder_get_it_name(it));
-    strformat_set(_bars_symbs, 't', feeder_get_it_text(it));
-
-    if(_bars_top)
+    /* The bars are only set again if their text changed. */
+    if(_bars_top && strformat_dirty(_bars_top))
         curses_top_set(strformat_get(_bars_top));
-    else
-        curses_top_set(NULL);
-
-    if(_bars_bot)
+    if(_bars_bot && strformat_dirty(_bars_bot))
         curses_bot_set(strformat_get(_bars_bot));
-    else
-        curses_top_set(NULL);
 }
 
@@ -7,11 +7,17 @@
 bool bars_init();
 void bars_quit();
 
-/* Set the tob/bottom bars. They can include the following symbols :
+/* Set the tob/bottom bars, which are computed with the next frame. They can
+ * include the following symbols :
  *  - %n : will be replaced by the name of the selected line.
  *  - %t : will be replaced by the text of the selected line.
  *  - %i : will be replaced by the id of the selected line.
  *  - %I : will be replaced by the total number of lines.
+ *  - %F : will be replaced by the number of frames drawn.
+ *  - %S : will be replaced by the number of frames delayed to be drawn with
+ *         later changes.
+ *  - %B : will be replaced by the number of bytes written by the last frame
+ *         with the vt backend.
  */
 bool bars_top_set(const char* br);
 bool bars_bot_set(const char* br);
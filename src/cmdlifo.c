@@ -2,15 +2,25 @@
 #include "cmdlifo.h"
 #include "spawn.h"
 #include "cmdparser.h"
+#include "render.h"
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 /* A spawned process from which commands are read. */
 struct _cmdlifo_sp_t {
-    /* The spawned process. */
+    /* The spawned process. A sourced file has no process : its commands are
+     * all in the buffer.
+     */
     spawn_t sp;
     /* A buffer in which yet to read data from the process is stored. */
     char* buffer;
+    /* The beginning of the last line read, which end hasn't been read yet. */
+    char* rest;
+    /* The number of batches opened by the process and not committed. */
+    size_t batches;
 };
 /* An array (pile) of processes to read from. Data is read from the top one,
  * and move to the one under when it dies.
@@ -22,6 +32,8 @@ static size_t                _cmdlifo_nb;
 static size_t                _cmdlifo_capa;
 /* Indicates if a new process was spawned while reading from one. */
 static bool                  _cmdlifo_spawned;
+/* The number of batches opened while no process is read from. */
+static size_t                _cmdlifo_batches;
 
 bool cmdlifo_init()
 {
@@ -29,6 +41,7 @@ bool cmdlifo_init()
     _cmdlifo_capa    = 10;
     _cmdlifo_sps     = malloc(_cmdlifo_capa * sizeof(struct _cmdlifo_sp_t));
     _cmdlifo_spawned = false;
+    _cmdlifo_batches = 0;
     return (_cmdlifo_sps != NULL);
 }
 
@@ -39,21 +52,56 @@ void cmdlifo_quit()
         for(i = 0; i < _cmdlifo_nb; ++i) {
             if(_cmdlifo_sps[i].buffer)
                 free(_cmdlifo_sps[i].buffer);
+            free(_cmdlifo_sps[i].rest);
             spawn_close(&_cmdlifo_sps[i].sp);
         }
         free(_cmdlifo_sps);
     }
 }
 
-bool cmdlifo_push(const char* cmd)
+/* Add an entry on top of the pile, without setting its process. */
+static bool _cmdlifo_add()
 {
+    struct _cmdlifo_sp_t* nsps;
     if(_cmdlifo_nb >= _cmdlifo_capa) {
-        _cmdlifo_capa += 10;
-        _cmdlifo_sps = realloc(_cmdlifo_sps, sizeof(spawn_t) * _cmdlifo_capa);
-        if(!_cmdlifo_sps)
+        nsps = realloc(_cmdlifo_sps,
+                sizeof(struct _cmdlifo_sp_t) * (_cmdlifo_capa + 10));
+        if(!nsps)
             return false;
+        _cmdlifo_sps   = nsps;
+        _cmdlifo_capa += 10;
     }
 
+    _cmdlifo_sps[_cmdlifo_nb].sp.process = -1;
+    _cmdlifo_sps[_cmdlifo_nb].buffer     = NULL;
+    _cmdlifo_sps[_cmdlifo_nb].rest       = NULL;
+    _cmdlifo_sps[_cmdlifo_nb].batches    = 0;
+    return true;
+}
+
+/* Remove the top entry, without resuming the one under. */
+static void _cmdlifo_drop()
+{
+    --_cmdlifo_nb;
+    spawn_close(&_cmdlifo_sps[_cmdlifo_nb].sp);
+    if(_cmdlifo_sps[_cmdlifo_nb].buffer)
+        free(_cmdlifo_sps[_cmdlifo_nb].buffer);
+    free(_cmdlifo_sps[_cmdlifo_nb].rest);
+    for(; _cmdlifo_sps[_cmdlifo_nb].batches > 0;
+            --_cmdlifo_sps[_cmdlifo_nb].batches)
+        render_release();
+}
+
+bool cmdlifo_push(const char* cmd)
+{
+    return cmdlifo_push_input(cmd, -1);
+}
+
+bool cmdlifo_push_input(const char* cmd, int input)
+{
+    if(!_cmdlifo_add())
+        return false;
+
     if(_cmdlifo_nb != 0) {
         if(!spawn_ended(_cmdlifo_sps[_cmdlifo_nb - 1].sp))
             spawn_pause(_cmdlifo_sps[_cmdlifo_nb - 1].sp);
@@ -61,8 +109,7 @@ bool cmdlifo_push(const char* cmd)
             spawn_close(&_cmdlifo_sps[_cmdlifo_nb - 1].sp);
     }
 
-    _cmdlifo_sps[_cmdlifo_nb].sp     = spawn_create_shell(cmd);
-    _cmdlifo_sps[_cmdlifo_nb].buffer = NULL;
+    _cmdlifo_sps[_cmdlifo_nb].sp = spawn_create_shell_input(cmd, input);
     if(!spawn_ok(_cmdlifo_sps[_cmdlifo_nb].sp)) {
         spawn_close(&_cmdlifo_sps[_cmdlifo_nb].sp);
         return false;
@@ -110,11 +157,7 @@ void cmdlifo_pop()
 {
     if(_cmdlifo_nb == 0)
         return;
-
-    --_cmdlifo_nb;
-    spawn_close(&_cmdlifo_sps[_cmdlifo_nb].sp);
-    if(_cmdlifo_sps[_cmdlifo_nb].buffer)
-        free(_cmdlifo_sps[_cmdlifo_nb].buffer);
+    _cmdlifo_drop();
 
     if(_cmdlifo_nb != 0) {
         if(spawn_ok(_cmdlifo_sps[_cmdlifo_nb - 1].sp))
@@ -134,6 +177,65 @@ void cmdlifo_pop()
     }
 }
 
+/* Read the whole file at path in a buffer ending with a '\0'. */
+static char* _cmdlifo_read_file(const char* path)
+{
+    struct stat st;
+    char* buffer;
+    ssize_t l;
+    size_t size;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return NULL;
+    if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return NULL;
+    }
+
+    buffer = malloc(st.st_size + 1);
+    if(!buffer) {
+        close(fd);
+        return NULL;
+    }
+    size = 0;
+    while(size < (size_t)st.st_size
+            && (l = read(fd, buffer + size, st.st_size - size)) > 0)
+        size += l;
+    buffer[size] = '\0';
+
+    close(fd);
+    return buffer;
+}
+
+bool cmdlifo_source(const char* path)
+{
+    char* buffer;
+
+    buffer = _cmdlifo_read_file(path);
+    if(!buffer)
+        return false;
+    if(!_cmdlifo_add()) {
+        free(buffer);
+        return false;
+    }
+    ++_cmdlifo_nb;
+
+    /* The file is read at once, unless it spawns a process : then, like for
+     * a spawned process, the rest of the file is kept in the buffer of its
+     * entry, and read when the process ends. The entry it was sourced from
+     * must then wait too.
+     */
+    if(_cmdlifo_parse_buffer(buffer))
+        _cmdlifo_drop();
+    else
+        _cmdlifo_spawned = true;
+
+    free(buffer);
+    return true;
+}
+
 int cmdlifo_fd()
 {
     if(_cmdlifo_nb == 0)
@@ -145,20 +247,89 @@ int cmdlifo_fd()
 void cmdlifo_update()
 {
     char buffer[4096];
-    size_t l;
+    char* text;
+    char* end;
+    size_t l, len;
+    bool done;
     size_t nb = _cmdlifo_nb;
 
     if(nb == 0)
         return;
     --nb;
 
-    while((l = spawn_read(_cmdlifo_sps[nb].sp, buffer, 4095)) != 0) {
-        buffer[l] = '\0';
-        if(!_cmdlifo_parse_buffer(buffer))
-            return;
+    /* Only one read is done by update : there is something to read, so it
+     * doesn't block, and the frames can be drawn between the reads.
+     */
+    l = spawn_read(_cmdlifo_sps[nb].sp, buffer, 4095);
+    if(l == (size_t)-1)
+        return;
+
+    render_hold();
+    if(l == 0) {
+        /* The last line may not end with a newline. */
+        text = _cmdlifo_sps[nb].rest;
+        _cmdlifo_sps[nb].rest = NULL;
+        done = true;
+        if(text) {
+            done = _cmdlifo_parse_buffer(text);
+            free(text);
+        }
+        if(done && spawn_ended(_cmdlifo_sps[nb].sp))
+            cmdlifo_pop();
+        render_release();
+        return;
+    }
+    buffer[l] = '\0';
+
+    /* The line cut by the previous read is completed. */
+    text = buffer;
+    if(_cmdlifo_sps[nb].rest) {
+        len  = strlen(_cmdlifo_sps[nb].rest);
+        text = malloc(len + l + 1);
+        if(text) {
+            memcpy(text, _cmdlifo_sps[nb].rest, len);
+            memcpy(text + len, buffer, l + 1);
+        }
+        else
+            text = buffer;
+        free(_cmdlifo_sps[nb].rest);
+        _cmdlifo_sps[nb].rest = NULL;
     }
 
-    if(spawn_ended(_cmdlifo_sps[nb].sp))
-        cmdlifo_pop();
+    /* The end of the last line hasn't been read yet. */
+    end = strrchr(text, '\n');
+    if(!end)
+        end = text;
+    else
+        *end++ = '\0';
+    if(*end != '\0')
+        _cmdlifo_sps[nb].rest = strdup(end);
+    if(end != text)
+        _cmdlifo_parse_buffer(text);
+
+    if(text != buffer)
+        free(text);
+    render_release();
+}
+
+void cmdlifo_batch()
+{
+    if(_cmdlifo_nb > 0)
+        ++_cmdlifo_sps[_cmdlifo_nb - 1].batches;
+    else
+        ++_cmdlifo_batches;
+    render_hold();
+}
+
+bool cmdlifo_commit()
+{
+    if(_cmdlifo_nb > 0 && _cmdlifo_sps[_cmdlifo_nb - 1].batches > 0)
+        --_cmdlifo_sps[_cmdlifo_nb - 1].batches;
+    else if(_cmdlifo_batches > 0)
+        --_cmdlifo_batches;
+    else
+        return false;
+    render_release();
+    return true;
 }
 
@@ -11,14 +11,36 @@ void cmdlifo_quit();
 /* Push a spawn on top of the lifo structure. */
 bool cmdlifo_push(const char* cmd);
 
+/* Same as cmdlifo_push, but the stdin of the spawn is read from the input file
+ * descriptor.
+ */
+bool cmdlifo_push_input(const char* cmd, int input);
+
+/* Read the commands of the file at path, without spawning a process. If one
+ * of them spawns a process, the rest of the file is read when it ends. Returns
+ * false if the file couldn't be read.
+ */
+bool cmdlifo_source(const char* path);
+
 /* Remove and close the top spawned. */
 void cmdlifo_pop();
 
 /* Get the fd associated to the top of the lifo. */
 int cmdlifo_fd();
 
-/* Read the input and update the state. */
+/* Read the input and update the state. The commands read at once are run
+ * as a batch.
+ */
 void cmdlifo_update();
 
+/* Open a batch : no frame is drawn until it is committed, so that the changes
+ * of the commands in between are drawn together. The batches opened by a
+ * spawned process are committed when it ends.
+ */
+void cmdlifo_batch();
+
+/* Commit the last opened batch. Returns false if there is none. */
+bool cmdlifo_commit();
+
 #endif
 
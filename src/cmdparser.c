@@ -13,11 +13,35 @@ struct _cmdparser_command_t {
     void* data;
 };
 
-/* The array of commands. */
+/* The command of a program which name is substituted. */
+#define CMDPARSER_DYNAMIC ((size_t)-1)
+
+/* A compiled command line. */
+struct _cmdparser_prog_t {
+    /* The index of the command in _cmdparser_cmds, or CMDPARSER_DYNAMIC if
+     * its name is substituted : the whole line is then parsed when it is run.
+     */
+    size_t cmd;
+    /* The args of the command, NULL if there are none. */
+    char* args;
+    /* The args with the symbols to be substituted, or the whole line if the
+     * command is CMDPARSER_DYNAMIC. NULL if nothing is substituted.
+     */
+    strformat_t* fmt;
+    /* Are the args only a number, and its value. */
+    bool numeric;
+    size_t number;
+};
+
+/* The array of commands, in the order they were added : programs refer to them
+ * by index.
+ */
 static struct _cmdparser_command_t* _cmdparser_cmds;
+/* The indexes of the commands sorted by name. */
+static size_t* _cmdparser_sorted;
 /* The number of commands. */
 static size_t _cmdparser_nb;
-/* The size of the array. */
+/* The size of the arrays. */
 static size_t _cmdparser_capa;
 
 bool cmdparser_init()
@@ -26,7 +50,8 @@ bool cmdparser_init()
     _cmdparser_capa = 10;
     _cmdparser_cmds
         = malloc(_cmdparser_capa * sizeof(struct _cmdparser_command_t));
-    if(!_cmdparser_cmds) {
+    _cmdparser_sorted = malloc(_cmdparser_capa * sizeof(size_t));
+    if(!_cmdparser_cmds || !_cmdparser_sorted) {
         _cmdparser_capa = 0;
         return false;
     }
@@ -37,19 +62,21 @@ void cmdparser_quit()
 {
     if(_cmdparser_cmds)
         free(_cmdparser_cmds);
+    if(_cmdparser_sorted)
+        free(_cmdparser_sorted);
 }
 
-/* Insert a cmd in the _cmdparser_cmds array at a specific position. It expect
- * id to be in [0; _cmdparser_nb] and _cmdparser_cmds to be already big enough.
+/* Insert the last command in the sorted indexes at a specific position. It
+ * expect id to be in [0; _cmdparser_nb].
  */
-static bool _cmdparser_insert(size_t id, struct _cmdparser_command_t cmd)
+static bool _cmdparser_insert(size_t id)
 {
     if(id != _cmdparser_nb) {
-        memmove(_cmdparser_cmds + id + 1,
-                _cmdparser_cmds + id,
-                sizeof(struct _cmdparser_command_t) * (_cmdparser_nb - id));
+        memmove(_cmdparser_sorted + id + 1,
+                _cmdparser_sorted + id,
+                sizeof(size_t) * (_cmdparser_nb - id));
     }
-    _cmdparser_cmds[id] = cmd;
+    _cmdparser_sorted[id] = _cmdparser_nb;
     return true;
 }
 
@@ -64,7 +91,9 @@ bool cmdparser_add_command(const char* name,
         _cmdparser_capa += 10;
         _cmdparser_cmds = realloc(_cmdparser_cmds,
                 _cmdparser_capa * sizeof(struct _cmdparser_command_t));
-        if(!_cmdparser_cmds) {
+        _cmdparser_sorted = realloc(_cmdparser_sorted,
+                _cmdparser_capa * sizeof(size_t));
+        if(!_cmdparser_cmds || !_cmdparser_sorted) {
             _cmdparser_capa = 0;
             _cmdparser_nb   = 0;
             return false;
@@ -74,12 +103,13 @@ bool cmdparser_add_command(const char* name,
     /* Insert it. */
     id = 0;
     while(id < _cmdparser_nb
-            && strcmp(_cmdparser_cmds[id].name, name) < 0)
+            && strcmp(_cmdparser_cmds[_cmdparser_sorted[id]].name, name) < 0)
         ++id;
     cmd.name = name;
     cmd.cb   = cb;
     cmd.data = data;
-    _cmdparser_insert(id, cmd);
+    _cmdparser_cmds[_cmdparser_nb] = cmd;
+    _cmdparser_insert(id);
     ++_cmdparser_nb;
     return true;
 }
@@ -91,24 +121,26 @@ struct _cmdparser_command_t* _cmdparser_find(const char* name)
 {
     size_t max, min, guess;
     int cmp;
+    if(_cmdparser_nb == 0)
+        return NULL;
     min = 0;
     max = _cmdparser_nb - 1;
 
     while(max - min > 1) {
         guess = (max + min) / 2;
-        cmp = strcmp(_cmdparser_cmds[guess].name, name);
+        cmp = strcmp(_cmdparser_cmds[_cmdparser_sorted[guess]].name, name);
         if(cmp == 0)
-            return &_cmdparser_cmds[guess];
+            return &_cmdparser_cmds[_cmdparser_sorted[guess]];
         else if(cmp < 0)
             min = guess;
         else
             max = guess;
     }
 
-    if(strcmp(_cmdparser_cmds[min].name, name) == 0)
-        return &_cmdparser_cmds[min];
-    else if(strcmp(_cmdparser_cmds[max].name, name) == 0)
-        return &_cmdparser_cmds[max];
+    if(strcmp(_cmdparser_cmds[_cmdparser_sorted[min]].name, name) == 0)
+        return &_cmdparser_cmds[_cmdparser_sorted[min]];
+    else if(strcmp(_cmdparser_cmds[_cmdparser_sorted[max]].name, name) == 0)
+        return &_cmdparser_cmds[_cmdparser_sorted[max]];
     else
         return NULL;
 }
@@ -162,3 +194,132 @@ bool cmdparser_parse(const char* line)
     return true;
 }
 
+/* Parse the args of a program if they are only a number. */
+static void _cmdparser_number(cmdparser_prog_t* prog)
+{
+    const char* args = prog->args;
+    char* end;
+
+    prog->numeric = false;
+    prog->number  = 0;
+    if(prog->fmt || !args)
+        return;
+    while(*args == ' ')
+        ++args;
+    if(*args < '0' || *args > '9')
+        return;
+    prog->number = strtoul(args, &end, 10);
+    while(*end == ' ')
+        ++end;
+    prog->numeric = (*end == '\0');
+}
+
+cmdparser_prog_t* cmdparser_compile(const char* line, strformat_symbs_t* sbs)
+{
+    cmdparser_prog_t* prog;
+    struct _cmdparser_command_t* cmd;
+    char* used;
+    char* args;
+    size_t len;
+    bool ok;
+
+    prog = malloc(sizeof(cmdparser_prog_t));
+    used = strdup(line);
+    if(!prog || !used) {
+        free(prog);
+        free(used);
+        return NULL;
+    }
+    prog->cmd  = CMDPARSER_DYNAMIC;
+    prog->args = NULL;
+    prog->fmt  = NULL;
+
+    /* Splitting the line the way cmdparser_parse does. */
+    ok   = false;
+    args = used;
+    while(*args == ' ')
+        ++args;
+    len = strcspn(args, " ");
+    if(sbs && memchr(args, '%', len)) {
+        prog->fmt = strformat_parse(sbs, line);
+        ok = (prog->fmt != NULL);
+    } else {
+        if(args[len] != '\0')
+            args[len++] = '\0';
+        cmd = _cmdparser_find(args);
+        if(cmd) {
+            prog->cmd = cmd - _cmdparser_cmds;
+            args += len;
+            if(strlen(args) == 0)
+                ok = true;
+            else if(sbs && strchr(args, '%')) {
+                prog->fmt = strformat_parse(sbs, args);
+                ok = (prog->fmt != NULL);
+            } else {
+                prog->args = strdup(args);
+                ok = (prog->args != NULL);
+            }
+        }
+    }
+    free(used);
+
+    if(!ok) {
+        cmdparser_prog_destroy(prog);
+        return NULL;
+    }
+    _cmdparser_number(prog);
+    return prog;
+}
+
+void cmdparser_prog_destroy(cmdparser_prog_t* prog)
+{
+    if(!prog)
+        return;
+    if(prog->args)
+        free(prog->args);
+    if(prog->fmt)
+        strformat_destroy(prog->fmt);
+    free(prog);
+}
+
+bool cmdparser_prog_constant(cmdparser_prog_t* prog)
+{
+    return !prog->fmt;
+}
+
+const char* cmdparser_prog_name(cmdparser_prog_t* prog)
+{
+    if(prog->cmd == CMDPARSER_DYNAMIC)
+        return NULL;
+    return _cmdparser_cmds[prog->cmd].name;
+}
+
+bool cmdparser_prog_count(cmdparser_prog_t* prog, size_t* count)
+{
+    if(prog->cmd == CMDPARSER_DYNAMIC || prog->fmt)
+        return false;
+    if(!prog->args) {
+        *count = 1;
+        return true;
+    }
+    *count = prog->number;
+    return prog->numeric;
+}
+
+bool cmdparser_run(cmdparser_prog_t* prog)
+{
+    struct _cmdparser_command_t* cmd;
+    const char* args;
+
+    if(prog->cmd == CMDPARSER_DYNAMIC)
+        return cmdparser_parse(strformat_get(prog->fmt));
+
+    cmd  = &_cmdparser_cmds[prog->cmd];
+    args = (prog->fmt ? strformat_get(prog->fmt) : prog->args);
+    if(args && strlen(args) == 0)
+        args = NULL;
+    if(cmd->cb)
+        cmd->cb(args, cmd->data);
+    return true;
+}
+
@@ -3,6 +3,8 @@
 #define DEF_CMDPARSER
 
 #include <stdbool.h>
+#include <stdlib.h>
+#include "strformat.h"
 
 /* The type of callback that is called when a command is parsed. The first
  * is a string with the arguments of the command, the second is a specific data
@@ -42,5 +44,38 @@ bool cmdparser_change_callback(const char* name,
  */
 bool cmdparser_parse(const char* line);
 
+/* A program is a command line compiled once to be run many times : the
+ * command is found when it is compiled, and only the symbols of the args are
+ * substituted when it is run. Running a program without symbols doesn't
+ * allocate anything.
+ */
+struct _cmdparser_prog_t;
+typedef struct _cmdparser_prog_t cmdparser_prog_t;
+
+/* Compile a line with the same format as cmdparser_parse. The symbols of sbs
+ * in the line are substituted each time the program is run, sbs can be NULL.
+ * If the name of the command is substituted, the line is parsed again each
+ * time. Returns NULL if the command isn't recognised or if the allocation
+ * failed. line won't be stored.
+ */
+cmdparser_prog_t* cmdparser_compile(const char* line, strformat_symbs_t* sbs);
+
+/* Destroy a program. */
+void cmdparser_prog_destroy(cmdparser_prog_t* prog);
+
+/* Indicates if nothing is substituted in a program. */
+bool cmdparser_prog_constant(cmdparser_prog_t* prog);
+
+/* Get the name of the command of a program, NULL if it is substituted. */
+const char* cmdparser_prog_name(cmdparser_prog_t* prog);
+
+/* Get the count given to the command of a program : 1 if there are no args.
+ * Returns false if the args aren't a constant number.
+ */
+bool cmdparser_prog_count(cmdparser_prog_t* prog, size_t* count);
+
+/* Run a program. Returns false if its command isn't recognised. */
+bool cmdparser_run(cmdparser_prog_t* prog);
+
 #endif
 
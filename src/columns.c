@@ -0,0 +1,245 @@
+
+#include "columns.h"
+#include "fields.h"
+#include "widths.h"
+#include <string.h>
+
+/* The ellipsis ending the cut fields, when the locale can display it. */
+#define COLUMNS_ELLIPSIS     "\xe2\x80\xa6"
+#define COLUMNS_ELLIPSIS_ALT "~"
+
+/* Are the fields laid out in columns. */
+static bool        _columns_on;
+/* The maximum width of the columns, and the fixed widths. */
+static size_t      _columns_max;
+static size_t      _columns_fixed[COLUMNS_MAX];
+/* The number of columns and their widths. */
+static size_t      _columns_nb;
+static size_t      _columns_widths[COLUMNS_MAX];
+/* The laid out line, its runs and the attribute of its end. */
+static char*       _columns_text;
+static size_t      _columns_len;
+static size_t      _columns_capa;
+static ansi_run_t* _columns_runs;
+static size_t      _columns_nbruns;
+static size_t      _columns_runs_capa;
+static uint16_t    _columns_attr;
+
+bool columns_init()
+{
+    _columns_on        = false;
+    _columns_max       = COLUMNS_DEFAULT_MAX;
+    _columns_nb        = 0;
+    _columns_text      = NULL;
+    _columns_len       = 0;
+    _columns_capa      = 0;
+    _columns_runs      = NULL;
+    _columns_nbruns    = 0;
+    _columns_runs_capa = 0;
+    memset(_columns_fixed, 0, sizeof(_columns_fixed));
+    memset(_columns_widths, 0, sizeof(_columns_widths));
+    return true;
+}
+
+void columns_quit()
+{
+    free(_columns_text);
+    free(_columns_runs);
+    _columns_text = NULL;
+    _columns_runs = NULL;
+}
+
+void columns_set(size_t max, const size_t* widths, size_t nb)
+{
+    size_t k;
+    _columns_on  = true;
+    _columns_max = max;
+    for(k = 0; k < COLUMNS_MAX; ++k)
+        _columns_fixed[k] = (k < nb ? widths[k] : 0);
+}
+
+void columns_off()
+{
+    _columns_on = false;
+}
+
+bool columns_enabled()
+{
+    return _columns_nb > 0;
+}
+
+bool columns_update()
+{
+    size_t k, nb, w;
+    bool changed;
+
+    nb = (_columns_on ? fields_nb() : 0);
+    if(nb > COLUMNS_MAX)
+        nb = COLUMNS_MAX;
+    changed     = (nb != _columns_nb);
+    _columns_nb = nb;
+
+    /* The last column isn't aligned. */
+    for(k = 0; k + 1 < nb; ++k) {
+        w = _columns_fixed[k];
+        if(w == 0) {
+            w = fields_width_max(k + 1);
+            if(w > _columns_max)
+                w = _columns_max;
+        }
+        if(w != _columns_widths[k]) {
+            _columns_widths[k] = w;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+size_t columns_width(size_t id)
+{
+    size_t k, width;
+
+    width = 0;
+    for(k = 0; k + 1 < _columns_nb; ++k)
+        width += _columns_widths[k] + COLUMNS_GAP;
+    return width + fields_width(id, _columns_nb);
+}
+
+/* Make room for len more bytes and one more run. */
+static bool _columns_reserve(size_t len)
+{
+    char* ntext;
+    ansi_run_t* nruns;
+    size_t ncapa;
+
+    if(_columns_len + len > _columns_capa) {
+        ncapa = (_columns_capa ? _columns_capa * 2 : 256);
+        while(ncapa < _columns_len + len)
+            ncapa *= 2;
+        ntext = realloc(_columns_text, ncapa);
+        if(!ntext)
+            return false;
+        _columns_text = ntext;
+        _columns_capa = ncapa;
+    }
+    if(_columns_nbruns >= _columns_runs_capa) {
+        ncapa = (_columns_runs_capa ? _columns_runs_capa * 2 : 32);
+        nruns = realloc(_columns_runs, sizeof(ansi_run_t) * ncapa);
+        if(!nruns)
+            return false;
+        _columns_runs      = nruns;
+        _columns_runs_capa = ncapa;
+    }
+    return true;
+}
+
+/* Append bytes with an attribute to the laid out line. */
+static bool _columns_put(const char* str, size_t len, uint16_t attr)
+{
+    if(!_columns_reserve(len))
+        return false;
+    if(attr != _columns_attr) {
+        _columns_runs[_columns_nbruns].off  = _columns_len;
+        _columns_runs[_columns_nbruns].attr = attr;
+        ++_columns_nbruns;
+        _columns_attr = attr;
+    }
+    memcpy(_columns_text + _columns_len, str, len);
+    _columns_len += len;
+    return true;
+}
+
+/* Append the field of the text at off, of flen bytes, to the laid out line.
+ * If it is wider than width columns, it is cut and ends with an ellipsis.
+ * Returns the number of columns it spans over, or -1 if the allocation
+ * failed.
+ */
+static long _columns_field(const char* text, size_t off, size_t flen,
+        const ansi_run_t* runs, size_t nbruns, size_t width)
+{
+    size_t end, l, c, r, mlen, mruns, mc;
+    uint16_t attr, mattr;
+    int w;
+
+    end   = off + flen;
+    c     = 0;
+    r     = ansi_find(runs, nbruns, off);
+    /* The state before the first character after width - 1 columns, where
+     * the ellipsis goes if the field is too wide.
+     */
+    mlen  = _columns_len;
+    mruns = _columns_nbruns;
+    mattr = _columns_attr;
+    mc    = 0;
+
+    while(off < end) {
+        if(r == nbruns && nbruns > 0 && runs[0].off <= off)
+            r = 0;
+        while(r + 1 < nbruns && runs[r + 1].off <= off)
+            ++r;
+        attr = (r < nbruns ? runs[r].attr : ANSI_PLAIN);
+
+        l = widths_char(text + off, end - off, c, &w);
+        w = (w < 0 ? -w : w);
+        if(c + w > width) {
+            /* The field is cut. */
+            _columns_len    = mlen;
+            _columns_nbruns = mruns;
+            _columns_attr   = mattr;
+            if(width == 0)
+                return 0;
+            if(MB_CUR_MAX > 1) {
+                if(!_columns_put(COLUMNS_ELLIPSIS,
+                            strlen(COLUMNS_ELLIPSIS), attr))
+                    return -1;
+            } else if(!_columns_put(COLUMNS_ELLIPSIS_ALT, 1, attr))
+                return -1;
+            return mc + 1;
+        }
+        if(!_columns_put(text + off, l, attr))
+            return -1;
+        c   += w;
+        off += l;
+        if(c + 1 <= width) {
+            mlen  = _columns_len;
+            mruns = _columns_nbruns;
+            mattr = _columns_attr;
+            mc    = c;
+        }
+    }
+    return c;
+}
+
+const char* columns_layout(size_t id, const char* text, size_t len,
+        const ansi_run_t* runs, size_t nbruns,
+        size_t* olen, const ansi_run_t** oruns, size_t* onbruns)
+{
+    size_t k, off, flen, pad;
+    long c;
+
+    _columns_len    = 0;
+    _columns_nbruns = 0;
+    _columns_attr   = ANSI_PLAIN;
+    for(k = 0; k < _columns_nb; ++k) {
+        fields_locate(id, text, len, k + 1, &off, &flen);
+        if(k + 1 == _columns_nb) {
+            if(_columns_field(text, off, flen, runs, nbruns, (size_t)-1) < 0)
+                return NULL;
+            break;
+        }
+
+        c = _columns_field(text, off, flen, runs, nbruns, _columns_widths[k]);
+        if(c < 0)
+            return NULL;
+        for(pad = _columns_widths[k] - c + COLUMNS_GAP; pad > 0; --pad) {
+            if(!_columns_put(" ", 1, ANSI_PLAIN))
+                return NULL;
+        }
+    }
+
+    *olen    = _columns_len;
+    *oruns   = _columns_runs;
+    *onbruns = _columns_nbruns;
+    return (_columns_text ? _columns_text : "");
+}
+
@@ -0,0 +1,60 @@
+
+#ifndef DEF_COLUMNS
+#define DEF_COLUMNS
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "ansi.h"
+
+/* The columns module lays out the fields of the lines (see fields.h) in
+ * aligned columns. A column is as wide as its widest field among the
+ * displayed lines, up to a maximum width, unless its width is fixed. The
+ * widths of the fields are counted by the fields module as the lines are read
+ * and hidden, so they are never computed again from the lines. The fields too
+ * wide for their column are cut and end with an ellipsis. The last field
+ * isn't aligned, so it is never cut.
+ */
+
+/* The default maximum width of the columns. */
+#define COLUMNS_DEFAULT_MAX 32
+/* The maximum number of columns : the next fields aren't displayed. */
+#define COLUMNS_MAX 64
+/* The number of spaces between two columns. */
+#define COLUMNS_GAP 2
+
+/* Init and free the columns. */
+bool columns_init();
+void columns_quit();
+
+/* Align the fields in columns at most max columns wide. The nb first columns
+ * have the widths of the array widths instead, unless they are 0.
+ */
+void columns_set(size_t max, const size_t* widths, size_t nb);
+
+/* Display the text of the lines as is. */
+void columns_off();
+
+/* Indicates if the lines are laid out in columns. It is false if the lines
+ * have no declared fields.
+ */
+bool columns_enabled();
+
+/* Compute the widths of the columns again. Returns true if one of them
+ * changed, in which case the lines must be drawn again.
+ */
+bool columns_update();
+
+/* Get the number of columns the layout of a line spans over. */
+size_t columns_width(size_t id);
+
+/* Lay out the len bytes of the text of a line, which attributes are given by
+ * nbruns runs. Returns the laid out text and stores its length in olen and
+ * its runs in oruns and onbruns. They are valid until the next call. Returns
+ * NULL if the allocation failed.
+ */
+const char* columns_layout(size_t id, const char* text, size_t len,
+        const ansi_run_t* runs, size_t nbruns,
+        size_t* olen, const ansi_run_t** oruns, size_t* onbruns);
+
+#endif
+
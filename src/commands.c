@@ -8,10 +8,16 @@
 #include "cmdlifo.h"
 #include "feeder.h"
 #include "bars.h"
+#include "strmatch.h"
+#include "fields.h"
+#include "columns.h"
+#include "render.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 static void _commands_up(const char* str, void* data)
 {
@@ -71,6 +77,12 @@ static void _commands_goto(const char* str, void* data)
     curses_list_set(pos - 1);
 }
 
+static void _commands_jump(const char* str, void* data)
+{
+    if(data) { } /* avoid warnings */
+    events_jump(str);
+}
+
 static void _commands_scroll(const char* str, void* data)
 {
     if(data) { } /* avoid warnings */
@@ -84,6 +96,54 @@ static void _commands_scroll(const char* str, void* data)
         curses_list_set_mode(!curses_list_get_mode());
 }
 
+static void _commands_wrap(const char* str, void* data)
+{
+    if(data) { } /* avoid warnings */
+    if(!str)
+        return;
+    if(strcmp(str, "on") == 0)
+        curses_list_set_wrap(true);
+    else if(strcmp(str, "off") == 0)
+        curses_list_set_wrap(false);
+    else if(strcmp(str, "toggle") == 0)
+        curses_list_set_wrap(!curses_list_get_wrap());
+}
+
+/* Indicates if str starts with the word word, followed by a space or its end.
+ */
+static bool _commands_word(const char* str, const char* word)
+{
+    size_t len = strlen(word);
+    return strncmp(str, word, len) == 0
+        && (str[len] == '\0' || str[len] == ' ');
+}
+
+static void _commands_columns(const char* str, void* data)
+{
+    size_t widths[COLUMNS_MAX];
+    size_t max, nb;
+    int read;
+    if(data) { } /* avoid warnings */
+    if(!str)
+        return;
+
+    if(strcmp(str, "off") == 0)
+        columns_off();
+    else if(_commands_word(str, "auto")) {
+        if(sscanf(str + 4, "%lu", &max) != 1)
+            max = COLUMNS_DEFAULT_MAX;
+        columns_set(max, NULL, 0);
+    } else if(_commands_word(str, "fixed")) {
+        str += 5;
+        for(nb = 0; nb < COLUMNS_MAX
+                && sscanf(str, "%lu%n", &widths[nb], &read) == 1; ++nb)
+            str += read;
+        columns_set(COLUMNS_DEFAULT_MAX, widths, nb);
+    } else
+        return;
+    curses_list_changed(true);
+}
+
 static void _commands_hide(const char* str, void* data)
 {
     char mode[16];
@@ -100,6 +160,94 @@ static void _commands_hide(const char* str, void* data)
         feeder_hide(false, id1, id2);
 }
 
+static void _commands_mark(const char* str, void* data)
+{
+    char mode[16];
+    char what[16];
+    size_t id1, id2;
+    int md, nb;
+    feeder_iterator_t it;
+    if(data) { } /* avoid warnings */
+    if(!str)
+        return;
+
+    nb = sscanf(str, "%15s %15s", mode, what);
+    if(nb < 1)
+        return;
+    if(strncmp(mode, "toggle", 15) == 0)
+        md = FEEDER_MARK_TOGGLE;
+    else if(strncmp(mode, "on", 15) == 0)
+        md = FEEDER_MARK_ON;
+    else if(strncmp(mode, "off", 15) == 0)
+        md = FEEDER_MARK_OFF;
+    else
+        return;
+
+    if(nb < 2) {
+        it = curses_list_selected();
+        if(it.valid)
+            feeder_mark(md, it.id, it.id);
+    }
+    else if(strncmp(what, "all", 15) == 0)
+        feeder_mark_shown(md);
+    else {
+        nb = sscanf(str, "%15s %zu %zu", mode, &id1, &id2);
+        if(nb == 2)
+            feeder_mark(md, id1, id1);
+        else if(nb == 3)
+            feeder_mark(md, id1, id2);
+    }
+}
+
+static void _commands_search(const char* str, void* data)
+{
+    int flags = 0;
+    size_t i, nb;
+    strmatch_t* m;
+    feeder_iterator_t it;
+    if(data) { } /* avoid warnings */
+    if(!str)
+        return;
+
+    if(strncmp(str, "-i ", 3) == 0) {
+        flags |= STRMATCH_ICASE;
+        str += 3;
+    }
+    m = strmatch_compile(str, flags);
+    if(!m)
+        return;
+
+    /* Look for the next matching line, going back to the beggining when
+     * reaching the end.
+     */
+    nb = feeder_end().vid;
+    it = feeder_begin();
+    feeder_next(&it, curses_list_get());
+    for(i = 0; i < nb; ++i) {
+        feeder_next(&it, 1);
+        if(!it.valid)
+            it = feeder_begin();
+        if(strmatch_search(m, feeder_get_it_text(it),
+                    feeder_get_it_length(it))) {
+            curses_list_set_it(it);
+            break;
+        }
+    }
+    strmatch_destroy(m);
+}
+
+static void _commands_where(const char* str, void* data)
+{
+    if(data) { } /* avoid warnings */
+    feeder_filter(str);
+}
+
+static void _commands_sort(const char* str, void* data)
+{
+    if(data) { } /* avoid warnings */
+    feeder_sort(str);
+}
+
 static void _commands_quit(const char* str, void* data)
 {
     if(str) { } /* avoid warnings */
@@ -148,29 +296,152 @@ static void _commands_map(const char* str, void* data)
 
 static void _commands_feed(const char* str, void* data)
 {
+    size_t nbfields = 0;
+    bool numeric = false;
+    int unique = FEEDER_UNIQUE_NONE;
+    int read;
     if(data) { } /* avoid warnings. */
     if(!str)
         return;
+
+    /* Parse the options. */
+    while(strncmp(str, "--", 2) == 0) {
+        read = 0;
+        if(strncmp(str, "--fields ", 9) == 0)
+            sscanf(str, "--fields %lu %n", &nbfields, &read);
+        else if(strncmp(str, "--numeric ", 10) == 0) {
+            numeric = true;
+            read = 10;
+        }
+        else if(strncmp(str, "--unique ", 9) == 0) {
+            unique = FEEDER_UNIQUE_FIRST;
+            read = 9;
+            if(strncmp(str + read, "first ", 6) == 0)
+                read += 6;
+            else if(strncmp(str + read, "last ", 5) == 0) {
+                unique = FEEDER_UNIQUE_LAST;
+                read += 5;
+            }
+        }
+        if(read == 0)
+            return;
+        str += read;
+    }
+
+    fields_set(nbfields, numeric);
+    feeder_set_unique(unique);
     feeder_set(str);
 }
 
+/* Write the names of the marked lines, one by line, in a temporary file.
+ * Returns its file descriptor, positioned at its beginning, or -1.
+ */
+static int _commands_marked_file()
+{
+    char buffer[4096];
+    char* path;
+    const char* dir;
+    const char* name;
+    size_t id, end, len, size;
+    bool ok = true;
+    int fd;
+
+    dir = getenv("TMPDIR");
+    if(!dir || dir[0] == '\0')
+        dir = "/tmp";
+    len  = strlen(dir) + sizeof("/list-XXXXXX");
+    path = malloc(len);
+    if(!path)
+        return -1;
+    snprintf(path, len, "%s/list-XXXXXX", dir);
+    fd = mkstemp(path);
+    /* The file is removed once it is closed by all the processes. */
+    if(fd >= 0)
+        unlink(path);
+    free(path);
+    if(fd < 0)
+        return -1;
+
+    size = 0;
+    end  = feeder_end().id;
+    for(id = feeder_marked_next(0); ok && id < end;
+            id = feeder_marked_next(id + 1)) {
+        name = feeder_get_name(id);
+        len  = strlen(name);
+        if(size + len + 1 > sizeof(buffer)) {
+            ok   = (write(fd, buffer, size) == (ssize_t)size);
+            size = 0;
+        }
+        if(len + 1 > sizeof(buffer))
+            ok = ok && (write(fd, name, len) == (ssize_t)len)
+                && (write(fd, "\n", 1) == 1);
+        else {
+            memcpy(buffer + size, name, len);
+            buffer[size + len] = '\n';
+            size += len + 1;
+        }
+    }
+    ok = ok && (write(fd, buffer, size) == (ssize_t)size);
+
+    if(!ok || lseek(fd, 0, SEEK_SET) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Parse the --marked option of the spawning commands : if it is there, str is
+ * moved after it and the file with the names of the marked lines is returned.
+ * Returns -1 if there is no option, -2 if the file couldn't be written.
+ */
+static int _commands_marked_input(const char** str)
+{
+    int fd;
+    if(strncmp(*str, "--marked ", 9) != 0)
+        return -1;
+    *str += 9;
+    fd = _commands_marked_file();
+    return (fd < 0 ? -2 : fd);
+}
+
 static void _commands_spawn(const char* str, void* data)
 {
+    int input;
     if(!data) { } /* avoid warnings */
     if(!str)
         return;
-    cmdlifo_push(str);
+
+    input = _commands_marked_input(&str);
+    if(input == -2)
+        return;
+    cmdlifo_push_input(str, input);
+    if(input >= 0)
+        close(input);
+}
+
+static void _commands_source(const char* str, void* data)
+{
+    if(!data) { } /* avoid warnings */
+    if(!str)
+        return;
+    cmdlifo_source(str);
 }
 
 static void _commands_term(const char* str, void* data)
 {
+    int input;
     if(data) { } /* avoid warnings. */
     if(!str)
         return;
 
+    input = _commands_marked_input(&str);
+    if(input == -2)
+        return;
     curses_disable();
-    spawn_exec_shell(str);
+    spawn_exec_shell_input(str, input);
     curses_enable();
+    if(input >= 0)
+        close(input);
 }
 
 static void _commands_refresh(const char* str, void* data)
@@ -179,6 +450,28 @@ static void _commands_refresh(const char* str, void* data)
     curses_redraw();
 }
 
+static void _commands_fps(const char* str, void* data)
+{
+    unsigned int fps;
+    if(data) { } /* avoid warnings */
+    if(!str)
+        render_set_fps(RENDER_DEFAULT_FPS);
+    else if(sscanf(str, "%u", &fps) == 1)
+        render_set_fps(fps);
+}
+
+static void _commands_batch(const char* str, void* data)
+{
+    if(data && str) { } /* avoid warnings */
+    cmdlifo_batch();
+}
+
+static void _commands_commit(const char* str, void* data)
+{
+    if(data && str) { } /* avoid warnings */
+    cmdlifo_commit();
+}
+
 static void _commands_top(const char* str, void* data)
 {
     if(data) { } /* avoid warnings */
@@ -218,6 +511,9 @@ static void _commands_color(const char* str, void* data)
     else if(strcmp(part, "sel") == 0)
         curses_list_colors_sel(curses_str_to_color(fg),
                 curses_str_to_color(bg));
+    else if(strcmp(part, "mrk") == 0)
+        curses_list_colors_mrk(curses_str_to_color(fg),
+                curses_str_to_color(bg));
     free(used);
 }
 
@@ -230,17 +526,28 @@ void commands_setup(bool* cont)
     cmdparser_add_command("begin",   &_commands_begin,   NULL);
     cmdparser_add_command("end",     &_commands_end,     NULL);
     cmdparser_add_command("goto",    &_commands_goto,    NULL);
+    cmdparser_add_command("jump",    &_commands_jump,    NULL);
     cmdparser_add_command("scroll",  &_commands_scroll,  NULL);
+    cmdparser_add_command("wrap",    &_commands_wrap,    NULL);
+    cmdparser_add_command("columns", &_commands_columns, NULL);
     cmdparser_add_command("hide",    &_commands_hide,    NULL);
+    cmdparser_add_command("mark",    &_commands_mark,    NULL);
+    cmdparser_add_command("search",  &_commands_search,  NULL);
+    cmdparser_add_command("where",   &_commands_where,   NULL);
+    cmdparser_add_command("sort",    &_commands_sort,    NULL);
 
     cmdparser_add_command("quit",    &_commands_quit,    cont);
     cmdparser_add_command("exe",     &_commands_exe,     NULL);
     cmdparser_add_command("map",     &_commands_map,     NULL);
     cmdparser_add_command("feed",    &_commands_feed,    NULL);
     cmdparser_add_command("spawn",   &_commands_spawn,   NULL);
+    cmdparser_add_command("source",  &_commands_source,  NULL);
     cmdparser_add_command("term",    &_commands_term,    NULL);
 
     cmdparser_add_command("refresh", &_commands_refresh, NULL);
+    cmdparser_add_command("fps",     &_commands_fps,     NULL);
+    cmdparser_add_command("batch",   &_commands_batch,   NULL);
+    cmdparser_add_command("commit",  &_commands_commit,  NULL);
     cmdparser_add_command("top",     &_commands_top,     NULL);
     cmdparser_add_command("bot",     &_commands_bot,     NULL);
     cmdparser_add_command("color",   &_commands_color,   NULL);
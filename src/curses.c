@@ -1,15 +1,69 @@
 
 #include "curses.h"
 #include "feeder.h"
+#include "widths.h"
+#include "vt.h"
+#include "wrap.h"
+#include "columns.h"
 #include <stdlib.h>
 #include <ctype.h>
 #include <math.h>
 #include <signal.h>
+#include <stdio.h>
+#include <time.h>
+#include <poll.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <ncurses.h>
 
 #define CURSES_TEXT_LENGTH 512
+/* The maximum number of bytes a row can hold for each of its columns. */
+#define CURSES_CELL_BYTES 8
+
+/* The environment variable choosing the backend drawing the screen. */
+#define CURSES_BACKEND_ENV "INTER_LIST_BACKEND"
+
+/* The backends drawing the screen. */
+enum {
+    CURSES_BACKEND_NCURSES,
+    CURSES_BACKEND_VT,
+    /* The frames are drawn in the shadows of the rows only, and dumped to the
+     * standard output. The keys are read from the standard input.
+     */
+    CURSES_BACKEND_HEADLESS
+};
+static int      _curses_backend;
+
+/* The keys sent as CSI sequences (without the leading \033[), which are
+ * decoded by the headless backend.
+ */
+static const char* _curses_csi_seqs[] = {
+    "A",
+    "B",
+    "C",
+    "D",
+    "H",
+    "F",
+    "5~",
+    "6~",
+    NULL
+};
+static const int _curses_csi_codes[] = {
+    KEY_UP,
+    KEY_DOWN,
+    KEY_RIGHT,
+    KEY_LEFT,
+    KEY_HOME,
+    KEY_END,
+    KEY_PPAGE,
+    KEY_NPAGE
+};
+
+/* The frames drawn by the headless backend, and the time spent drawing them in
+ * microseconds.
+ */
+static size_t   _curses_frames;
+static long     _curses_frames_time;
 
 /* Global ncurses variables. */
 static uint16_t _curses_term_width;
@@ -18,6 +72,34 @@ static bool     _curses_term_resized;
 static bool     _curses_colors;
 static bool     _curses_enabled;
 
+/* What a row of the screen shows, so that it isn't drawn again if it doesn't
+ * change.
+ */
+struct _curses_row_t {
+    /* The displayed bytes, there is room for _curses_row_capa bytes. */
+    char*  text;
+    size_t len;
+    /* The runs of attributes of the bytes, there is room for
+     * _curses_row_runs_capa runs.
+     */
+    ansi_run_t* runs;
+    size_t      nbruns;
+    /* The color pair, 0 if the content of the row is unknown. */
+    int    cp;
+};
+static struct _curses_row_t* _curses_rows;
+static size_t                _curses_rows_nb;
+/* The number of bytes a row can hold. */
+static size_t                _curses_row_capa;
+/* The number of runs a row can hold : the attribute can change on each
+ * column.
+ */
+static size_t                _curses_row_runs_capa;
+/* The buffers in which a row and its runs are prepared before being drawn. */
+static char*                 _curses_row_buffer;
+static ansi_run_t*           _curses_row_runs;
+static size_t                _curses_row_nbruns;
+
 /* The list. */
 /* The number of elements in the last update. */
 static size_t            _curses_list_nb;
@@ -26,6 +108,18 @@ static feeder_iterator_t _curses_list_sel;
 static size_t            _curses_list_offset;
 static bool              _curses_list_pager;
 static bool              _curses_list_mustdraw;
+/* Are the lines wrapped, and the number of rows of the first displayed line
+ * which are above the screen.
+ */
+static bool              _curses_list_wrap;
+static size_t            _curses_list_skip;
+/* The last line added to the wrap index. */
+static feeder_iterator_t _curses_wrap_last;
+/* Are there changes of the list waiting to be applied, and must one of them
+ * be forced.
+ */
+static bool              _curses_list_changes;
+static bool              _curses_list_force;
 
 /* Top and bottom bars. */
 static bool  _curses_top_enable;
@@ -42,6 +136,13 @@ static const char* _curses_cmd_prefix;
 static char        _curses_cmd_text[CURSES_TEXT_LENGTH];
 static size_t      _curses_cmd_pos;
 static bool        _curses_cmd_mustdraw;
+/* The completion of the command line : the text which was completed, and the
+ * index of the name shown among the ones starting with it (their number when
+ * the text itself is shown).
+ */
+static bool        _curses_comp_in;
+static char        _curses_comp_base[CURSES_TEXT_LENGTH];
+static size_t      _curses_comp_cur;
 
 /* The colors pairs. */
 enum {
@@ -49,8 +150,19 @@ enum {
     COLOR_BOT = 2,
     COLOR_CMD = 3,
     COLOR_SEL = 4,
-    COLOR_LST = 5
+    COLOR_LST = 5,
+    COLOR_MRK = 6
 };
+/* The number of color pairs, and the colors they use. */
+#define CURSES_PAIRS 7
+static int _curses_pairs_fg[CURSES_PAIRS];
+static int _curses_pairs_bg[CURSES_PAIRS];
+/* The pairs of the text colored by escape sequences, indexed by fg * 8 + bg.
+ * They are initialised on their first use, starting from CURSES_PAIRS, and
+ * are 0 until then.
+ */
+static int _curses_pairs_ansi[64];
+static int _curses_pairs_next;
 
 /********************* Generic Ncurses abilities *****************************/
 /* Handler for terminal resize. */
@@ -60,31 +172,193 @@ static void _curses_term_resize(int sig)
     _curses_term_resized = true;
 }
 
-static bool _curses_init_ncurses()
+/* Free the shadow of the rows. */
+static void _curses_rows_free()
 {
-    if(!initscr())
+    size_t i;
+    if(!_curses_rows)
+        return;
+    for(i = 0; i < _curses_rows_nb; ++i) {
+        free(_curses_rows[i].text);
+        free(_curses_rows[i].runs);
+    }
+    free(_curses_rows);
+    free(_curses_row_buffer);
+    free(_curses_row_runs);
+    _curses_rows       = NULL;
+    _curses_rows_nb    = 0;
+    _curses_row_buffer = NULL;
+    _curses_row_runs   = NULL;
+}
+
+/* Allocate the shadow of the rows for the size of the terminal. The rows
+ * will all be drawn again.
+ */
+static bool _curses_rows_alloc()
+{
+    size_t i;
+
+    _curses_rows_free();
+    _curses_row_capa   = (size_t)_curses_term_width * CURSES_CELL_BYTES;
+    _curses_row_runs_capa = (size_t)_curses_term_width + 1;
+    _curses_row_buffer = malloc(_curses_row_capa);
+    _curses_row_runs   = malloc(_curses_row_runs_capa * sizeof(ansi_run_t));
+    _curses_rows = calloc(_curses_term_height, sizeof(struct _curses_row_t));
+    if(!_curses_rows || !_curses_row_buffer || !_curses_row_runs) {
+        free(_curses_rows);
+        free(_curses_row_buffer);
+        free(_curses_row_runs);
+        _curses_rows       = NULL;
+        _curses_row_buffer = NULL;
+        _curses_row_runs   = NULL;
         return false;
-    cbreak();
-    noecho();
-    keypad(stdscr, TRUE);
-    _curses_term_width   = COLS;
-    _curses_term_height  = LINES;
+    }
+    _curses_rows_nb = _curses_term_height;
+    for(i = 0; i < _curses_rows_nb; ++i) {
+        _curses_rows[i].text = malloc(_curses_row_capa);
+        _curses_rows[i].runs = malloc(_curses_row_runs_capa
+                * sizeof(ansi_run_t));
+        if(!_curses_rows[i].text || !_curses_rows[i].runs) {
+            _curses_rows_free();
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Forget what the rows show, so that they are all drawn again. */
+static void _curses_rows_invalidate()
+{
+    size_t i;
+    for(i = 0; i < _curses_rows_nb; ++i)
+        _curses_rows[i].cp = 0;
+}
+
+/* Reverse the order of the shadows of the rows in [from, to). */
+static void _curses_rows_reverse(size_t from, size_t to)
+{
+    struct _curses_row_t tmp;
+    while(from + 1 < to) {
+        --to;
+        tmp = _curses_rows[from];
+        _curses_rows[from] = _curses_rows[to];
+        _curses_rows[to]   = tmp;
+        ++from;
+    }
+}
+
+/* Shift the shadows of the h rows starting at y0 like the content of a scroll
+ * region scrolled by k rows. The rows which are exposed are forgotten.
+ */
+static void _curses_rows_shift(size_t y0, size_t h, long k)
+{
+    size_t i, n;
+
+    /* Rotating to the left by n. */
+    n = (k > 0 ? (size_t)k : h - (size_t)-k);
+    _curses_rows_reverse(y0, y0 + n);
+    _curses_rows_reverse(y0 + n, y0 + h);
+    _curses_rows_reverse(y0, y0 + h);
+
+    if(k > 0) {
+        for(i = y0 + h - k; i < y0 + h; ++i)
+            _curses_rows[i].cp = 0;
+    } else {
+        for(i = y0; i < y0 + (size_t)-k; ++i)
+            _curses_rows[i].cp = 0;
+    }
+}
+
+/* Get a size from an environment variable, or def if it isn't set. */
+static uint16_t _curses_env_size(const char* name, uint16_t def)
+{
+    const char* value = getenv(name);
+    int size;
+    if(!value || sscanf(value, "%d", &size) != 1 || size <= 2 || size > 4096)
+        return def;
+    return size;
+}
+
+static bool _curses_init_term()
+{
+    if(_curses_backend == CURSES_BACKEND_HEADLESS) {
+        _curses_term_width  = _curses_env_size("COLUMNS", 80);
+        _curses_term_height = _curses_env_size("LINES", 24);
+    } else {
+        if(!initscr())
+            return false;
+        cbreak();
+        noecho();
+        keypad(stdscr, TRUE);
+        /* The pending keys are read until there are none left. */
+        nodelay(stdscr, TRUE);
+        /* Allows ncurses to use the scrolling abilities of the terminal. */
+        idlok(stdscr, TRUE);
+        _curses_term_width  = COLS;
+        _curses_term_height = LINES;
+    }
     _curses_term_resized = false;
     _curses_enabled      = true;
-    return true;
+
+    if(_curses_backend == CURSES_BACKEND_VT) {
+        /* ncurses clears the screen once, then the vt backend draws it. */
+        refresh();
+    }
+    if(_curses_backend != CURSES_BACKEND_NCURSES)
+        vt_resize(_curses_term_width, _curses_term_height);
+    return _curses_rows_alloc();
+}
+
+/* Set the colors of a pair. */
+static void _curses_pair(int cp, int fg, int bg)
+{
+    _curses_pairs_fg[cp] = fg;
+    _curses_pairs_bg[cp] = bg;
+    if(_curses_backend == CURSES_BACKEND_NCURSES)
+        init_pair(cp, fg, bg);
+    else {
+        /* The cells already drawn with the pair must be drawn again. */
+        vt_colors(cp, fg, bg);
+        curses_redraw();
+    }
 }
 
 bool curses_init()
 {
+    const char* backend;
+
+    /* Choosing the backend. */
+    backend = getenv(CURSES_BACKEND_ENV);
+    _curses_backend = CURSES_BACKEND_NCURSES;
+    if(backend && strcmp(backend, "vt") == 0) {
+        _curses_backend = CURSES_BACKEND_VT;
+        if(!vt_init(STDOUT_FILENO))
+            return false;
+    } else if(backend && strcmp(backend, "headless") == 0) {
+        /* The bytes of the frames are only counted. */
+        _curses_backend = CURSES_BACKEND_HEADLESS;
+        if(!vt_init(-1))
+            return false;
+    }
+    _curses_frames      = 0;
+    _curses_frames_time = 0;
+
     /* Initialising ncurses. */
-    if(!_curses_init_ncurses())
+    _curses_rows       = NULL;
+    _curses_rows_nb    = 0;
+    _curses_row_buffer = NULL;
+    _curses_row_runs   = NULL;
+    if(!_curses_init_term())
         return false;
     signal(SIGWINCH, _curses_term_resize);
 
     /* Initialising colors. */
-    _curses_colors = has_colors();
-    if(_curses_colors)
+    _curses_colors = (_curses_backend == CURSES_BACKEND_HEADLESS
+            || has_colors());
+    if(_curses_colors && _curses_backend != CURSES_BACKEND_HEADLESS)
         start_color();
+    memset(_curses_pairs_ansi, 0, sizeof(_curses_pairs_ansi));
+    _curses_pairs_next = CURSES_PAIRS;
 
     /* Initialising the list. */
     _curses_list_nb       = 0;
@@ -92,6 +366,10 @@ bool curses_init()
     _curses_list_pager    = false;
     _curses_list_first    = feeder_begin();
     _curses_list_sel      = feeder_begin();
+    _curses_list_wrap     = false;
+    _curses_list_skip     = 0;
+    _curses_list_changes  = false;
+    _curses_list_force    = false;
 
     /* Initialising the top and bottom bars. */
     _curses_top_enable = false;
@@ -100,15 +378,17 @@ bool curses_init()
     _curses_bot_str    = NULL;
 
     /* Initialising color pairs. */
-    init_pair(COLOR_TOP, COLOR_BLACK, COLOR_WHITE);
-    init_pair(COLOR_BOT, COLOR_BLACK, COLOR_WHITE);
-    init_pair(COLOR_CMD, COLOR_WHITE, COLOR_BLACK);
-    init_pair(COLOR_SEL, COLOR_BLACK, COLOR_WHITE);
-    init_pair(COLOR_LST, COLOR_WHITE, COLOR_BLACK);
+    _curses_pair(COLOR_TOP, COLOR_BLACK, COLOR_WHITE);
+    _curses_pair(COLOR_BOT, COLOR_BLACK, COLOR_WHITE);
+    _curses_pair(COLOR_CMD, COLOR_WHITE, COLOR_BLACK);
+    _curses_pair(COLOR_SEL, COLOR_BLACK, COLOR_WHITE);
+    _curses_pair(COLOR_LST, COLOR_WHITE, COLOR_BLACK);
+    _curses_pair(COLOR_MRK, COLOR_BLACK, COLOR_YELLOW);
 
     /* Initialising the command line. */
     _curses_cmd_in     = false;
     _curses_cmd_prefix = "";
+    _curses_comp_in    = false;
 
     /* Preparing drawing. */
     _curses_list_mustdraw = true;
@@ -121,7 +401,15 @@ bool curses_init()
 
 bool curses_end()
 {
-    endwin();
+    if(_curses_backend == CURSES_BACKEND_HEADLESS) {
+        printf("--- %lu frames, %lu bytes, %ld us\n", _curses_frames,
+                vt_total_bytes(), _curses_frames_time);
+    }
+    else
+        endwin();
+    _curses_rows_free();
+    if(_curses_backend != CURSES_BACKEND_NCURSES)
+        vt_quit();
     if(_curses_top_str)
         free(_curses_top_str);
     if(_curses_bot_str)
@@ -131,16 +419,20 @@ bool curses_end()
 
 void curses_enable()
 {
-    if(_curses_enabled)
+    if(_curses_enabled || _curses_backend == CURSES_BACKEND_HEADLESS)
         return;
     reset_prog_mode();
     refresh();
     _curses_enabled = true;
+    if(_curses_backend == CURSES_BACKEND_VT) {
+        vt_invalidate();
+        curses_redraw();
+    }
 }
 
 void curses_disable()
 {
-    if(!_curses_enabled)
+    if(!_curses_enabled || _curses_backend == CURSES_BACKEND_HEADLESS)
         return;
     def_prog_mode();
     endwin();
@@ -149,30 +441,177 @@ void curses_disable()
 
 void curses_redraw()
 {
+    _curses_rows_invalidate();
     _curses_top_mustdraw  = true;
     _curses_bot_mustdraw  = true;
     _curses_cmd_mustdraw  = true;
     _curses_list_mustdraw = true;
 }
 
-static void _curses_draw_line(const char* text, unsigned int y, int cp)
+/* Get the ncurses attributes of the text of a pair changed by an attribute
+ * of the ansi module.
+ */
+static attr_t _curses_attr(int cp, uint16_t attr)
+{
+    attr_t ret;
+    int fg, bg;
+
+    ret = (attr & ANSI_BOLD      ? A_BOLD      : 0)
+        | (attr & ANSI_UNDERLINE ? A_UNDERLINE : 0)
+        | (attr & ANSI_REVERSE   ? A_REVERSE   : 0);
+    fg = ANSI_FG(attr);
+    bg = ANSI_BG(attr);
+    if(fg == ANSI_DEFAULT)
+        fg = _curses_pairs_fg[cp];
+    if(bg == ANSI_DEFAULT)
+        bg = _curses_pairs_bg[cp];
+
+    if(_curses_colors && !_curses_pairs_ansi[fg * 8 + bg]
+            && _curses_pairs_next < COLOR_PAIRS) {
+        init_pair(_curses_pairs_next, fg, bg);
+        _curses_pairs_ansi[fg * 8 + bg] = _curses_pairs_next++;
+    }
+    /* Without enough pairs, only the style is kept. */
+    if(!_curses_pairs_ansi[fg * 8 + bg])
+        return ret | COLOR_PAIR(cp);
+    return ret | COLOR_PAIR(_curses_pairs_ansi[fg * 8 + bg]);
+}
+
+/* Check if two lists of runs are the same. */
+static bool _curses_runs_equal(const ansi_run_t* r1, size_t nb1,
+        const ansi_run_t* r2, size_t nb2)
 {
     size_t i;
-    char* txt;
+    if(nb1 != nb2)
+        return false;
+    for(i = 0; i < nb1; ++i) {
+        if(r1[i].off != r2[i].off || r1[i].attr != r2[i].attr)
+            return false;
+    }
+    return true;
+}
 
-    /* First fill the the bg with spaces. */
-    attron(COLOR_PAIR(cp));
-    for(i = 0; i < _curses_term_width; ++i)
-        mvaddch(y, i, ' ');
+/* Draw a row of the screen from the len bytes of text, which span over cols
+ * columns, unless it already shows the same bytes with the same colors. The
+ * colors of the pair are changed by the nbruns runs of attributes. The rest
+ * of the row is cleared at once.
+ */
+static void _curses_draw_row(const char* text, size_t len,
+        const ansi_run_t* runs, size_t nbruns, size_t cols,
+        unsigned int y, int cp)
+{
+    struct _curses_row_t* row;
+    size_t i, off, end;
+
+    if(y < _curses_rows_nb) {
+        row = &_curses_rows[y];
+        if(row->cp == cp && row->len == len
+                && memcmp(row->text, text, len) == 0
+                && _curses_runs_equal(row->runs, row->nbruns, runs, nbruns))
+            return;
+        memcpy(row->text, text, len);
+        if(nbruns > 0)
+            memcpy(row->runs, runs, nbruns * sizeof(ansi_run_t));
+        row->len    = len;
+        row->nbruns = nbruns;
+        row->cp     = cp;
+    }
 
-    /* Print the text. */
-    if(strlen(text) == 0)
+    if(_curses_backend != CURSES_BACKEND_NCURSES) {
+        vt_row(y, cp, text, len, runs, nbruns, cols);
         return;
-    txt = strdup(text);
-    if(strlen(txt) > _curses_term_width)
-        txt[_curses_term_width] = '\0';
-    mvaddstr(y, 0, txt);
-    free(txt);
+    }
+    attrset(COLOR_PAIR(cp));
+    bkgdset(' ' | COLOR_PAIR(cp));
+    move(y, 0);
+    off = (nbruns > 0 ? runs[0].off : len);
+    if(off > 0)
+        addnstr(text, off);
+    for(i = 0; i < nbruns; ++i) {
+        end = (i + 1 < nbruns ? runs[i + 1].off : len);
+        attrset(_curses_attr(cp, runs[i].attr));
+        if(end > off)
+            addnstr(text + off, end - off);
+        off = end;
+    }
+    attrset(COLOR_PAIR(cp));
+    clrtoeol();
+}
+
+/* Prepare in the row buffer the columns of text starting at column col. The
+ * text is displayed from the character at offset off, which starts at column
+ * start. The tabulations are expanded and the characters which can't be
+ * printed are replaced by '?'. The runs of attributes of the text are moved
+ * to the offsets of the row in the runs buffer. Returns the number of bytes of
+ * the row, and stores the number of columns it spans over in cols.
+ */
+static size_t _curses_render(const char* text, size_t len,
+        const ansi_run_t* runs, size_t nbruns,
+        size_t off, size_t start, size_t col, size_t* cols)
+{
+    char* out = _curses_row_buffer;
+    size_t n, l, c, end, r;
+    uint16_t attr, cur;
+    int w;
+
+    end = col + _curses_term_width;
+    n   = 0;
+    for(c = col; c < start && c < end; ++c)
+        out[n++] = ' ';
+
+    _curses_row_nbruns = 0;
+    cur = ANSI_PLAIN;
+    r   = ansi_find(runs, nbruns, off);
+    while(off < len && c < end) {
+        /* A new run starts when the attribute changes. */
+        if(nbruns > 0) {
+            if(r == nbruns && runs[0].off <= off)
+                r = 0;
+            while(r + 1 < nbruns && runs[r + 1].off <= off)
+                ++r;
+            attr = (r < nbruns ? runs[r].attr : ANSI_PLAIN);
+            if(attr != cur
+                    && _curses_row_nbruns < _curses_row_runs_capa) {
+                _curses_row_runs[_curses_row_nbruns].off  = n;
+                _curses_row_runs[_curses_row_nbruns].attr = attr;
+                ++_curses_row_nbruns;
+                cur = attr;
+            }
+        }
+
+        l = widths_char(text + off, len - off, c, &w);
+        if(w < 0) {
+            w = -w;
+            if(c + w > end || n + w > _curses_row_capa)
+                break;
+            memset(out + n, '?', w);
+            n += w;
+        } else if(text[off] == '\t') {
+            if(c + w > end)
+                w = end - c;
+            if(n + w > _curses_row_capa)
+                break;
+            memset(out + n, ' ', w);
+            n += w;
+        } else {
+            if(c + w > end || n + l > _curses_row_capa)
+                break;
+            memcpy(out + n, text + off, l);
+            n += l;
+        }
+        c   += w;
+        off += l;
+    }
+    *cols = c - col;
+    return n;
+}
+
+/* Draw a row of the screen from the beginning of a text. */
+static void _curses_draw_line(const char* text, unsigned int y, int cp)
+{
+    size_t cols;
+    size_t n = _curses_render(text, strlen(text), NULL, 0, 0, 0, 0, &cols);
+    _curses_draw_row(_curses_row_buffer, n, NULL, 0, cols, y, cp);
 }
 
 static unsigned int _curses_list_height()
@@ -182,51 +621,238 @@ static unsigned int _curses_list_height()
         - (_curses_bot_enable ? 1 : 0);
 }
 
+/* Get the row of the list at which a line starts. */
+static size_t _curses_list_row(size_t vid)
+{
+    return (_curses_list_wrap ? wrap_row(vid) : vid);
+}
+
+/* Get the number of rows a line spans over. */
+static size_t _curses_list_rows(feeder_iterator_t it)
+{
+    return (_curses_list_wrap ? wrap_rows(it.vid) : 1);
+}
+
+/* Get the row of the list displayed at the top of the list area. */
+static size_t _curses_list_top()
+{
+    return _curses_list_row(_curses_list_first.vid) + _curses_list_skip;
+}
+
+/* Get the row of the list area at which a line starts. It is negative if the
+ * line starts above it.
+ */
+static long _curses_list_y(feeder_iterator_t it)
+{
+    return (long)_curses_list_row(it.vid) - (long)_curses_list_top();
+}
+
+/* Check if some rows of a line are displayed. */
 static bool _curses_list_isin(feeder_iterator_t it)
 {
-    return (it.vid >= _curses_list_first.vid
-            && it.vid < _curses_list_first.vid + _curses_list_height());
+    long y = _curses_list_y(it);
+    return (y + (long)_curses_list_rows(it) > 0
+            && y < (long)_curses_list_height());
+}
+
+/* Check if all the rows of a line are displayed, or if it starts at the top
+ * of the list area when it is higher than it.
+ */
+static bool _curses_list_fits(feeder_iterator_t it)
+{
+    long y = _curses_list_y(it);
+    return (y == 0 || (y > 0 && y + (long)_curses_list_rows(it)
+                    <= (long)_curses_list_height()));
+}
+
+/* Draw the columns of a line starting at column col on a row of the
+ * screen.
+ */
+static void _curses_list_draw_cols(feeder_iterator_t it, size_t col,
+        unsigned int y, int cp)
+{
+    const char* txt;
+    const ansi_run_t* runs;
+    size_t len, off, start, n, cols, nbruns;
+
+    txt  = feeder_get_it_text(it);
+    len  = feeder_get_it_length(it);
+    runs = feeder_get_it_runs(it, &nbruns);
+    /* The selected line is drawn with the colors of the selection only. */
+    if(cp == COLOR_SEL)
+        nbruns = 0;
+
+    if(columns_enabled()) {
+        txt = columns_layout(it.id, txt, len, runs, nbruns,
+                &len, &runs, &nbruns);
+        if(!txt)
+            return;
+        off = widths_scan(txt, len, col, &start);
+        n   = _curses_render(txt, len, runs, nbruns, off, start, col, &cols);
+        _curses_draw_row(_curses_row_buffer, n, _curses_row_runs,
+                _curses_row_nbruns, cols, y, cp);
+    } else if(nbruns == 0 && widths_simple(it.id, txt, len)) {
+        /* A column is a byte : the text is drawn as is. */
+        off = (col < len ? col : len);
+        n   = len - off;
+        if(n > _curses_term_width)
+            n = _curses_term_width;
+        _curses_draw_row(txt + off, n, NULL, 0, n, y, cp);
+    } else {
+        off = widths_locate(it.id, txt, len, col, &start);
+        n   = _curses_render(txt, len, runs, nbruns, off, start, col, &cols);
+        _curses_draw_row(_curses_row_buffer, n, _curses_row_runs,
+                _curses_row_nbruns, cols, y, cp);
+    }
 }
 
 static void _curses_list_draw_line(feeder_iterator_t it)
 {
     int cp;
-    unsigned int y;
-    const char* txt;
+    long y, r, rows, height;
+    unsigned int y0;
 
     if(!_curses_list_isin(it))
         return;
 
     if(feeder_it_cmp(it, _curses_list_sel) == 0)
         cp = COLOR_SEL;
+    else if(feeder_get_it_marked(it))
+        cp = COLOR_MRK;
     else
         cp = COLOR_LST;
 
-    y = it.vid - _curses_list_first.vid + (_curses_top_enable ? 1 : 0);
-    txt = feeder_get_it_text(it);
-    if(!it.valid || it.vid >= _curses_list_nb
-            || strlen(txt) <= _curses_list_offset)
-        _curses_draw_line("", y, cp);
+    y  = _curses_list_y(it);
+    y0 = (_curses_top_enable ? 1 : 0);
+    if(!it.valid || it.vid >= _curses_list_nb) {
+        _curses_draw_row("", 0, NULL, 0, 0, y0 + y, cp);
+        return;
+    }
+    if(!_curses_list_wrap) {
+        _curses_list_draw_cols(it, _curses_list_offset, y0 + y, cp);
+        return;
+    }
+
+    /* The rows of a wrapped line show the following slices of its columns. */
+    rows   = _curses_list_rows(it);
+    height = _curses_list_height();
+    for(r = (y < 0 ? -y : 0); r < rows && y + r < height; ++r)
+        _curses_list_draw_cols(it, r * _curses_term_width, y0 + y + r, cp);
+}
+
+/* Display the list from a row. If the list moves by less than a screen, the
+ * rows already on screen are scrolled within the list area, so that only the
+ * rows which have been exposed or which changed are drawn.
+ */
+static void _curses_list_scroll_to(size_t top)
+{
+    long k = (long)top - (long)_curses_list_top();
+    size_t h  = _curses_list_height();
+    size_t y0 = (_curses_top_enable ? 1 : 0);
+    size_t vid, skip;
+    feeder_iterator_t first;
+
+    if(_curses_list_wrap)
+        vid = wrap_find(top, &skip);
+    else {
+        vid  = top;
+        skip = 0;
+    }
+    /* The first line is reached from the selection, which is close to it. */
+    first = _curses_list_sel;
+    if(vid < first.vid)
+        feeder_prev(&first, first.vid - vid);
     else
-        _curses_draw_line(txt + _curses_list_offset, y, cp);
+        feeder_next(&first, vid - first.vid);
+    if(!first.valid) {
+        first = feeder_begin();
+        skip  = 0;
+    }
+
+    _curses_list_first    = first;
+    _curses_list_skip     = skip;
+    _curses_list_mustdraw = true;
+    if(k == 0 || (size_t)labs(k) >= h || y0 + h > _curses_rows_nb)
+        return;
+
+    if(_curses_backend != CURSES_BACKEND_NCURSES)
+        vt_scroll(y0, y0 + h - 1, k);
+    else {
+        setscrreg(y0, y0 + h - 1);
+        scrollok(stdscr, TRUE);
+        scrl(k);
+        scrollok(stdscr, FALSE);
+        setscrreg(0, _curses_term_height - 1);
+    }
+    _curses_rows_shift(y0, h, k);
+}
+
+/* Place the first displayed line so that the selection is in the middle of the
+ * screen, and redraw the list.
+ */
+static void _curses_list_place()
+{
+    size_t height = _curses_list_height();
+    size_t row    = _curses_list_row(_curses_list_sel.vid);
+    size_t total  = _curses_list_row(_curses_list_nb);
+
+    if(row < height / 2)
+        _curses_list_scroll_to(0);
+    else if(total - row < height / 2)
+        _curses_list_scroll_to(total > height ? total - height : 0);
+    else
+        _curses_list_scroll_to(row - height / 2);
+}
+
+/* Add to the wrap index the lines which aren't in it yet. */
+static void _curses_wrap_update()
+{
+    feeder_iterator_t it;
+    size_t width;
+
+    if(wrap_count() == 0)
+        it = feeder_begin();
+    else {
+        it = _curses_wrap_last;
+        feeder_next(&it, 1);
+    }
+    while(it.valid) {
+        if(columns_enabled())
+            width = columns_width(it.id);
+        else
+            width = widths_total(it.id, feeder_get_it_text(it),
+                    feeder_get_it_length(it));
+        if(!wrap_push(width))
+            return;
+        _curses_wrap_last = it;
+        feeder_next(&it, 1);
+    }
+}
+
+/* Index all the lines in the wrap index again. */
+static void _curses_wrap_build()
+{
+    wrap_clear(_curses_term_width);
+    _curses_wrap_update();
 }
 
 static void _curses_list_draw()
 {
-    size_t i;
-    unsigned int lines;
+    long y;
+    unsigned int lines, y0;
     feeder_iterator_t it;
 
     lines = _curses_list_height();
-    it = _curses_list_first;
-    for(i = 0; i < lines; ++i) {
-        if(it.valid) {
-            _curses_list_draw_line(it);
-            feeder_next(&it, 1);
-        }
-        else
-            _curses_draw_line("", i + (_curses_top_enable ? 1 : 0), COLOR_LST);
+    y0    = (_curses_top_enable ? 1 : 0);
+    y     = 0;
+    it    = _curses_list_first;
+    while(y < (long)lines && it.valid) {
+        _curses_list_draw_line(it);
+        y = _curses_list_y(it) + _curses_list_rows(it);
+        feeder_next(&it, 1);
     }
+    for(; y < (long)lines; ++y)
+        _curses_draw_line("", y0 + y, COLOR_LST);
 }
 
 static void _curses_cmd_draw()
@@ -241,27 +867,148 @@ static void _curses_cmd_draw()
     _curses_draw_line(buffer, _curses_term_height - 1, COLOR_CMD);
 }
 
+/* Apply the last resize of the terminal. All the resizes since the last frame
+ * are applied at once, and ncurses only resizes its windows. Returns false if
+ * the size didn't change.
+ */
 static bool _curses_term_apply_resize()
 {
     struct winsize winsz;
-    ioctl(0, TIOCGWINSZ, &winsz);
+
+    _curses_term_resized = false;
+    if(ioctl(0, TIOCGWINSZ, &winsz) < 0 || winsz.ws_col == 0
+            || winsz.ws_row == 0)
+        return false;
+    if(winsz.ws_col == _curses_term_width
+            && winsz.ws_row == _curses_term_height)
+        return false;
 
     _curses_term_width  = winsz.ws_col;
     _curses_term_height = winsz.ws_row;
-    resizeterm(_curses_term_height, _curses_term_width);
+    /* With the vt backend, ncurses only reads the keys : resizing its
+     * windows would make it clear the screen on the next key.
+     */
+    if(_curses_backend == CURSES_BACKEND_NCURSES)
+        resizeterm(_curses_term_height, _curses_term_width);
+    else
+        vt_resize(_curses_term_width, _curses_term_height);
+    return _curses_rows_alloc();
+}
 
-    endwin();
-    return _curses_init_ncurses();
+/* Get the current time in microseconds. */
+static long _curses_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
 }
 
-void curses_draw()
+/* Dump the frame drawn by the headless backend, which started at start. The
+ * rows are prefixed by a character telling their colors : T and B for the
+ * bars, C for the command line, > for the selection, and a space for the other
+ * lines of the list.
+ */
+static void _curses_dump(long start)
+{
+    struct _curses_row_t* row;
+    long time;
+    size_t y;
+    char c;
+
+    time = _curses_time() - start;
+    _curses_frames_time += time;
+    ++_curses_frames;
+
+    printf("--- frame %lu : %lu bytes, %ld us\n",
+            _curses_frames, vt_frame_bytes(), time);
+    for(y = 0; y < _curses_rows_nb; ++y) {
+        row = &_curses_rows[y];
+        switch(row->cp) {
+            case COLOR_TOP: c = 'T'; break;
+            case COLOR_BOT: c = 'B'; break;
+            case COLOR_CMD: c = 'C'; break;
+            case COLOR_SEL: c = '>'; break;
+            case COLOR_MRK: c = '*'; break;
+            default:        c = ' '; break;
+        }
+        printf("%c%.*s\n", c, (int)row->len, row->text);
+    }
+    fflush(stdout);
+}
+
+/* Apply the changes of the list notified since the last time. */
+static void _curses_list_sync()
 {
-    if(_curses_term_resized) {
-        _curses_term_apply_resize();
+    size_t nb, old;
+    bool relayout, force;
+    feeder_iterator_t it;
+
+    if(!_curses_list_changes)
+        return;
+    force = _curses_list_force;
+    _curses_list_changes = false;
+    _curses_list_force   = false;
+
+    it  = feeder_end();
+    nb  = it.vid;
+    old = _curses_list_nb;
+    /* The widths of the columns follow the displayed lines. */
+    relayout = columns_update();
+    if(relayout)
+        _curses_list_mustdraw = true;
+
+    if(force) {
+        /* The displayed lines may have changed : the selection is kept on the
+         * same line if it is still displayed.
+         */
+        _curses_list_nb    = nb;
+        _curses_list_first = feeder_at_id(_curses_list_first.id);
+        _curses_list_skip  = 0;
+        _curses_list_sel   = feeder_at_id(_curses_list_sel.id);
+        if(!_curses_list_sel.valid)
+            _curses_list_sel = feeder_begin();
+        if(_curses_list_wrap)
+            _curses_wrap_build();
+        if(!_curses_list_first.valid || !_curses_list_fits(_curses_list_sel))
+            _curses_list_place();
         _curses_list_mustdraw = true;
-        _curses_top_mustdraw  = true;
-        _curses_bot_mustdraw  = true;
-        _curses_cmd_mustdraw  = true;
+    }
+    else if((old == 0 && !_curses_list_first.valid) || nb < old) {
+        _curses_list_first = feeder_begin();
+        _curses_list_skip  = 0;
+        _curses_list_sel   = _curses_list_first;
+        if(_curses_list_wrap)
+            _curses_wrap_build();
+        _curses_list_mustdraw = true;
+    }
+    else if(_curses_list_wrap && relayout)
+        _curses_wrap_build();
+    else if(_curses_list_wrap)
+        _curses_wrap_update();
+
+    /* The new lines may be displayed. */
+    if(nb != old && _curses_list_row(old)
+            < _curses_list_top() + _curses_list_height())
+        _curses_list_mustdraw = true;
+    _curses_list_nb = nb;
+}
+
+void curses_draw()
+{
+    size_t x;
+    long start = _curses_time();
+
+    _curses_list_sync();
+    if(_curses_term_resized && _curses_term_apply_resize()) {
+        /* Only the lines wider than the screen are wrapped again. */
+        if(_curses_list_wrap) {
+            wrap_resize(_curses_term_width);
+            if(_curses_list_skip >= _curses_list_rows(_curses_list_first))
+                _curses_list_skip = _curses_list_rows(_curses_list_first) - 1;
+        }
+        if(!_curses_list_fits(_curses_list_sel))
+            _curses_list_place();
+        curses_redraw();
     }
 
     if(_curses_top_mustdraw) {
@@ -292,14 +1039,66 @@ void curses_draw()
     }
 
     /* Placing the cursor. */
-    if(!_curses_cmd_in)
-        move(_curses_term_height - 1, 0);
-    else {
-        move(_curses_term_height - 1,
-                strlen(_curses_cmd_prefix) + _curses_cmd_pos);
+    x = (_curses_cmd_in ? strlen(_curses_cmd_prefix) + _curses_cmd_pos : 0);
+    if(_curses_backend == CURSES_BACKEND_NCURSES) {
+        move(_curses_term_height - 1, x);
+        refresh();
+    } else {
+        vt_cursor(_curses_term_height - 1, x);
+        if(vt_flush() && _curses_backend == CURSES_BACKEND_HEADLESS)
+            _curses_dump(start);
     }
+}
 
-    refresh();
+size_t curses_frame_bytes()
+{
+    if(_curses_backend != CURSES_BACKEND_NCURSES)
+        return vt_frame_bytes();
+    return 0;
+}
+
+int curses_getch()
+{
+    unsigned char c;
+    char seq[16];
+    struct pollfd pfd;
+    size_t i, n;
+
+    if(_curses_backend != CURSES_BACKEND_HEADLESS)
+        return getch();
+
+    pfd.fd     = 0;
+    pfd.events = POLLIN;
+    if(poll(&pfd, 1, 0) <= 0)
+        return ERR;
+    if(read(0, &c, 1) <= 0)
+        return CURSES_KEY_EOF;
+    if(c == '\r')
+        return '\n';
+    if(c == 0x7f)
+        return KEY_BACKSPACE;
+    if(c != 0x1b)
+        return c;
+
+    /* An escape sequence follows the escape key if it is sent at once. */
+    if(poll(&pfd, 1, 0) <= 0 || read(0, &c, 1) <= 0)
+        return 0x1b;
+    if(c != '[')
+        return c;
+
+    /* Reading the parameters and the final byte of the sequence. */
+    n = 0;
+    while(n < sizeof(seq) - 1 && read(0, &c, 1) > 0) {
+        seq[n++] = c;
+        if(c >= 0x40 && c <= 0x7e)
+            break;
+    }
+    seq[n] = '\0';
+    for(i = 0; _curses_csi_seqs[i]; ++i) {
+        if(strcmp(seq, _curses_csi_seqs[i]) == 0)
+            return _curses_csi_codes[i];
+    }
+    return ERR;
 }
 
 int curses_str_to_color(const char* str)
@@ -327,37 +1126,38 @@ int curses_str_to_color(const char* str)
 /********************* List handling abilities *******************************/
 void curses_list_colors(int fg, int bg)
 {
-    init_pair(COLOR_LST, fg, bg);
+    _curses_pair(COLOR_LST, fg, bg);
 }
 
 void curses_list_colors_sel(int fg, int bg)
 {
-    init_pair(COLOR_SEL, fg, bg);
+    _curses_pair(COLOR_SEL, fg, bg);
 }
 
-void curses_list_changed(bool force)
+void curses_list_colors_mrk(int fg, int bg)
 {
-    size_t nb;
-    feeder_iterator_t it;
+    _curses_pair(COLOR_MRK, fg, bg);
+}
 
-    it = feeder_end();
-    nb = it.vid;
-    if((nb != _curses_list_nb && nb < _curses_list_height())
-            || force)
-        _curses_list_mustdraw = true;
-    if((_curses_list_nb == 0 && !_curses_list_first.valid)
-            || nb < _curses_list_nb) {
-        _curses_list_first = feeder_begin();
-        _curses_list_sel   = _curses_list_first;
-    }
+void curses_list_redraw()
+{
+    _curses_list_mustdraw = true;
+}
 
-    _curses_list_nb = nb;
+void curses_list_changed(bool force)
+{
+    _curses_list_changes = true;
+    _curses_list_force   = _curses_list_force || force;
 }
 
 bool curses_list_down(size_t nb)
 {
-    feeder_iterator_t savesel = _curses_list_sel;
+    feeder_iterator_t savesel;
+    size_t height, row, end, top;
     bool ret = true;
+
+    _curses_list_sync();
+    savesel = _curses_list_sel;
     feeder_next(&_curses_list_sel, nb);
     if(!_curses_list_sel.valid) {
         _curses_list_sel = feeder_begin();
@@ -366,20 +1166,18 @@ bool curses_list_down(size_t nb)
         ret = false;
     }
 
-    if(_curses_list_isin(_curses_list_sel)) {
+    if(_curses_list_fits(_curses_list_sel)) {
         _curses_list_draw_line(savesel);
         _curses_list_draw_line(_curses_list_sel);
     } else {
-        if(_curses_list_height() > _curses_list_sel.vid)
-            _curses_list_first = feeder_begin();
-        else if(_curses_list_pager)
-            _curses_list_first = _curses_list_sel;
-        else {
-            _curses_list_first = feeder_begin();
-            feeder_next(&_curses_list_first,
-                    _curses_list_sel.vid - _curses_list_height() + 1);
-        }
-        _curses_list_mustdraw = true;
+        height = _curses_list_height();
+        row    = _curses_list_row(_curses_list_sel.vid);
+        end    = row + _curses_list_rows(_curses_list_sel);
+        /* In pager mode, the selection is at the top of the screen. */
+        top = (end > height ? end - height : 0);
+        if(top > 0 && (_curses_list_pager || top > row))
+            top = row;
+        _curses_list_scroll_to(top);
     }
 
     return ret;
@@ -387,66 +1185,84 @@ bool curses_list_down(size_t nb)
 
 bool curses_list_up(size_t nb)
 {
-    feeder_iterator_t savesel = _curses_list_sel;
+    feeder_iterator_t savesel;
+    size_t height, row, end, top;
     bool ret = true;
+
+    _curses_list_sync();
+    savesel = _curses_list_sel;
     feeder_prev(&_curses_list_sel, nb);
     if(!_curses_list_sel.valid) {
         _curses_list_sel = feeder_begin();
         ret = false;
     }
 
-    if(_curses_list_isin(_curses_list_sel)) {
+    if(_curses_list_fits(_curses_list_sel)) {
         _curses_list_draw_line(savesel);
         _curses_list_draw_line(_curses_list_sel);
     } else {
-        if(_curses_list_pager) {
-            _curses_list_first = feeder_begin();
-            if(_curses_list_height() <= _curses_list_sel.vid) {
-                feeder_next(&_curses_list_first,
-                        _curses_list_sel.vid - _curses_list_height() + 1);
-            }
-        } else
-            _curses_list_first = _curses_list_sel;
-        _curses_list_mustdraw = true;
+        height = _curses_list_height();
+        row    = _curses_list_row(_curses_list_sel.vid);
+        end    = row + _curses_list_rows(_curses_list_sel);
+        /* In pager mode, the selection is at the bottom of the screen. */
+        top = (end > height ? end - height : 0);
+        if(!_curses_list_pager || top > row)
+            top = row;
+        _curses_list_scroll_to(top);
     }
     return ret;
 }
 
+size_t curses_list_height()
+{
+    return _curses_list_height();
+}
+
 size_t curses_list_get()
 {
+    _curses_list_sync();
     return _curses_list_sel.vid;
 }
 
+feeder_iterator_t curses_list_selected()
+{
+    _curses_list_sync();
+    return _curses_list_sel;
+}
+
 bool curses_list_set(size_t nb)
 {
-    size_t height;
-    feeder_iterator_t savesel = _curses_list_sel;
+    feeder_iterator_t it;
 
-    _curses_list_sel = feeder_begin();
-    feeder_next(&_curses_list_sel, nb);
-    if(!_curses_list_sel.valid) {
-        _curses_list_sel = savesel;
+    _curses_list_sync();
+    /* The selection moves from where it is, so that near lines are reached
+     * quickly.
+     */
+    it = _curses_list_sel;
+    if(!it.valid)
+        it = feeder_begin();
+    if(nb >= it.vid)
+        feeder_next(&it, nb - it.vid);
+    else
+        feeder_prev(&it, it.vid - nb);
+    return curses_list_set_it(it);
+}
+
+bool curses_list_set_it(feeder_iterator_t it)
+{
+    feeder_iterator_t savesel;
+
+    if(!it.valid)
         return false;
-    }
-    
-    if(_curses_list_isin(_curses_list_sel)) {
+    _curses_list_sync();
+    savesel = _curses_list_sel;
+    _curses_list_sel = it;
+
+    if(_curses_list_fits(_curses_list_sel)) {
         _curses_list_draw_line(savesel);
         _curses_list_draw_line(_curses_list_sel);
-    } else {
-        height = _curses_list_height();
-        if(_curses_list_sel.vid < height / 2)
-            _curses_list_first = feeder_begin();
-        else if(_curses_list_nb - _curses_list_sel.vid < height / 2) {
-            _curses_list_first = feeder_begin();
-            feeder_next(&_curses_list_first, _curses_list_nb - height);
-        }
-        else {
-            _curses_list_first = feeder_begin();
-            feeder_next(&_curses_list_first,
-                    _curses_list_sel.vid - height / 2);
-        }
-        _curses_list_mustdraw = true;
-    }
+    } else
+        _curses_list_place();
 
     return true;
 }
@@ -488,9 +1304,33 @@ bool curses_list_get_mode()
     return _curses_list_pager;
 }
 
+void curses_list_set_wrap(bool wrap)
+{
+    if(wrap == _curses_list_wrap)
+        return;
+    _curses_list_sync();
+    _curses_list_wrap     = wrap;
+    _curses_list_skip     = 0;
+    _curses_list_mustdraw = true;
+    if(wrap)
+        _curses_wrap_build();
+    else
+        wrap_clear(_curses_term_width);
+    if(!_curses_list_fits(_curses_list_sel))
+        _curses_list_place();
+}
+
+bool curses_list_get_wrap()
+{
+    return _curses_list_wrap;
+}
+
 /********************* Bars abilities ****************************************/
 bool curses_top_set(const char* str)
 {
+    /* The bar is only drawn again if its text changed. */
+    if(str && _curses_top_str && strcmp(str, _curses_top_str) == 0)
+        return false;
     if(_curses_top_str)
         free(_curses_top_str);
 
@@ -515,6 +1355,8 @@ bool curses_top_set(const char* str)
 
 bool curses_bot_set(const char* str)
 {
+    if(str && _curses_bot_str && strcmp(str, _curses_bot_str) == 0)
+        return false;
     if(_curses_bot_str)
         free(_curses_bot_str);
 
@@ -539,13 +1381,13 @@ bool curses_bot_set(const char* str)
 
 void curses_top_colors(int fg, int bg)
 {
-    init_pair(1, fg, bg);
+    _curses_pair(COLOR_TOP, fg, bg);
     _curses_top_mustdraw = true;
 }
 
 void curses_bot_colors(int fg, int bg)
 {
-    init_pair(2, fg, bg);
+    _curses_pair(COLOR_BOT, fg, bg);
     _curses_bot_mustdraw = true;
 }
 
@@ -556,6 +1398,7 @@ void curses_command_enter(const char* prefix)
     _curses_cmd_text[0]  = '\0';
     _curses_cmd_pos      = 0;
     _curses_cmd_mustdraw = true;
+    _curses_comp_in      = false;
 }
 
 const char* curses_command_leave()
@@ -567,9 +1410,103 @@ const char* curses_command_leave()
     return _curses_cmd_text;
 }
 
+/* Replace the text of the command line by the len first bytes of str. */
+static void _curses_command_set(const char* str, size_t len)
+{
+    if(len > CURSES_TEXT_LENGTH - 1)
+        len = CURSES_TEXT_LENGTH - 1;
+    memmove(_curses_cmd_text, str, len);
+    _curses_cmd_text[len] = '\0';
+    _curses_cmd_pos      = len;
+    _curses_cmd_mustdraw = true;
+}
+
+/* Complete the command line with the names of the lines : the text is first
+ * extended to the longest prefix they share, then each completion cycles
+ * through them, forward or backward, and back to the text.
+ */
+static void _curses_command_complete(bool backward)
+{
+    const char* first;
+    const char* last;
+    size_t beg, nb, len;
+
+    if(!_curses_comp_in) {
+        nb = feeder_prefix(_curses_cmd_text, &beg);
+        if(nb == 0)
+            return;
+
+        /* As the names are sorted, the prefix shared by all of them is the
+         * one shared by the first and the last.
+         */
+        first = feeder_prefix_name(beg);
+        last  = feeder_prefix_name(beg + nb - 1);
+        for(len = 0; first[len] && first[len] == last[len]; ++len);
+        if(len > strlen(_curses_cmd_text)) {
+            _curses_command_set(first, len);
+            return;
+        }
+
+        strcpy(_curses_comp_base, _curses_cmd_text);
+        _curses_comp_cur = nb;
+        _curses_comp_in  = true;
+    }
+
+    /* The names may have changed since the last completion. */
+    nb = feeder_prefix(_curses_comp_base, &beg);
+    if(_curses_comp_cur > nb)
+        _curses_comp_cur = nb;
+    if(nb == 0) {
+        _curses_command_set(_curses_comp_base, strlen(_curses_comp_base));
+        return;
+    }
+
+    /* The duplicated names are skipped. */
+    if(!backward) {
+        if(_curses_comp_cur == nb)
+            _curses_comp_cur = 0;
+        else {
+            do
+                ++_curses_comp_cur;
+            while(_curses_comp_cur < nb
+                    && strcmp(feeder_prefix_name(beg + _curses_comp_cur),
+                        feeder_prefix_name(beg + _curses_comp_cur - 1)) == 0);
+        }
+    }
+    else {
+        if(_curses_comp_cur == 0)
+            _curses_comp_cur = nb;
+        else {
+            --_curses_comp_cur;
+            while(_curses_comp_cur > 0
+                    && strcmp(feeder_prefix_name(beg + _curses_comp_cur),
+                        feeder_prefix_name(beg + _curses_comp_cur - 1)) == 0)
+                --_curses_comp_cur;
+        }
+    }
+
+    if(_curses_comp_cur == nb)
+        _curses_command_set(_curses_comp_base, strlen(_curses_comp_base));
+    else {
+        first = feeder_prefix_name(beg + _curses_comp_cur);
+        _curses_command_set(first, strlen(first));
+    }
+}
+
+const char* curses_command_text()
+{
+    return _curses_cmd_text;
+}
+
 bool curses_command_parse_event(int c)
 {
     size_t pos;
+    if(c == '\t' || c == KEY_BTAB) {
+        _curses_command_complete(c == KEY_BTAB);
+        return true;
+    }
+    _curses_comp_in = false;
+
     if(isprint(c)) {
         if(_curses_cmd_pos == strlen(_curses_cmd_text)) {
             pos = strlen(_curses_cmd_text);
@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include <inttypes.h>
 #include <string.h>
+#include "feeder.h"
 
 /********************* Generic Ncurses abilities *****************************/
 /* Initialises the curses display, must be called only once. */
@@ -25,6 +26,18 @@ void curses_redraw();
 /* Draw the changes on screen. */
 void curses_draw();
 
+/* Get the number of bytes written to the terminal by the last frame. It is
+ * only known with the vt backend, and is 0 otherwise.
+ */
+size_t curses_frame_bytes();
+
+/* Read a key without waiting : ERR is returned if no key is pending. With the
+ * headless backend, the keys are read from the standard input, and
+ * CURSES_KEY_EOF is returned when it is closed.
+ */
+#define CURSES_KEY_EOF (-2)
+int curses_getch();
+
 /* Get the color corresponding to a string. The value of str must be one of the
  * following values :
  *  - black
@@ -46,12 +59,21 @@ void curses_list_colors(int fg, int bg);
 /* Define the colors for the selected entry of the list. */
 void curses_list_colors_sel(int fg, int bg);
 
+/* Define the colors for the marked entries of the list. */
+void curses_list_colors_mrk(int fg, int bg);
+
 /* Notify curses that the list has changed, so it may update the screen. If
  * force is true, the screen will be redrawn anyway. If it is false, it will
- * try to guess if the screen needs to be redrawn.
+ * try to guess if the screen needs to be redrawn. The changes are applied
+ * together when the list is next used or drawn.
  */
 void curses_list_changed(bool force);
 
+/* Draw the list again with the next frame : its lines are the same, but the
+ * way they look changed.
+ */
+void curses_list_redraw();
+
 /* Move the selection downward by nb steps. Returns false if it reached the
  * end.
  */
@@ -62,16 +84,25 @@ bool curses_list_down(size_t nb);
  */
 bool curses_list_up(size_t nb);
 
+/* Get the number of rows of the list area. */
+size_t curses_list_height();
+
 /* Get the number of the selected line. */
 size_t curses_list_get();
 
+/* Get the iterator to the selected line. */
+feeder_iterator_t curses_list_selected();
+
 /* Set the number of the selected line. Return false if the line is invalid. */
 bool curses_list_set(size_t nb);
 
-/* Move the screen to the right by nb chars. */
+/* Select the line of an iterator. Return false if it is invalid. */
+bool curses_list_set_it(feeder_iterator_t it);
+
+/* Move the screen to the right by nb columns. */
 void curses_list_right(size_t nb);
 
-/* Move the screen to the left by nb chars. Returns left if it reached the
+/* Move the screen to the left by nb columns. Returns left if it reached the
  * beggining.
  */
 bool curses_list_left(size_t nb);
@@ -88,6 +119,14 @@ void curses_list_set_mode(bool pager);
 /* Returns true if the scroll mode is pager. */
 bool curses_list_get_mode();
 
+/* Set if the lines are wrapped : each line spans over as many rows as it needs
+ * to be displayed as a whole, and the horizontal offset is ignored.
+ */
+void curses_list_set_wrap(bool wrap);
+
+/* Returns true if the lines are wrapped. */
+bool curses_list_get_wrap();
+
 /********************* Bars abilities ****************************************/
 /* Set the content of the top/bottom bars. The strings will be deduplicated. If
  * they are NULL, the top/bottom bars will be disabled. Returns true if
@@ -111,7 +150,11 @@ void curses_command_enter(const char* prefix);
  */
 const char* curses_command_leave();
 
-/* Parse an event. Returns false if the command line must be left.
+/* Get the text typed in the command line so far. */
+const char* curses_command_text();
+
+/* Parse an event. Returns false if the command line must be left. Tab and
+ * shift-Tab complete the text with the names of the lines.
  * TODO handle utf8
  */
 bool curses_command_parse_event(int c);
@@ -4,13 +4,12 @@
 #include "curses.h"
 #include "cmdparser.h"
 #include "feeder.h"
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <ncurses.h>
 #include <sys/ioctl.h>
 
-#define EVENTS_MAX_SEQ 64
-
 /* Modifiers */
 #define EVENTS_MOD_SHIFT (1<<0)
 #define EVENTS_MOD_ALTR  (1<<1)
@@ -45,67 +44,98 @@ int _events_keys_code[] = {
     KEY_PPAGE,
 };
 
-/* Comp event (<C-A-l> for example). */
-struct _events_comp_t {
-    /* bitmask of the modifiers that required by this event. */
-    unsigned char mods;
-    /* The code of the letter. */
-    int letter;
-    /* The action to be executed when the event is completed. */
-    char* action;
+/* The motion commands, which are merged when they are repeated in a burst of
+ * keys. The order of the names matches the EVENTS_MOTION_* values.
+ */
+#define EVENTS_MOTION_NONE  (-1)
+#define EVENTS_MOTION_UP    0
+#define EVENTS_MOTION_DOWN  1
+#define EVENTS_MOTION_LEFT  2
+#define EVENTS_MOTION_RIGHT 3
+const char* _events_motions_name[] = {
+    "up",
+    "down",
+    "left",
+    "right",
+    NULL
 };
 
-/* The comps events, sorted by letter. */
-static struct _events_comp_t* _events_comps;
-static size_t _events_comps_capa;
-static size_t _events_comps_size;
+/* The number of keys the first level of the keymap is indexed by : the
+ * letters and the special keys of ncurses.
+ */
+#define EVENTS_KEYS    (KEY_MAX + 1)
+/* The number of letters and of combinations of modifiers of comp events. */
+#define EVENTS_LETTERS 256
+#define EVENTS_MODS    32
 
-/* Seq event (abc for example). */
-struct _events_seq_t {
-    /* The sequence of letters. */
-    int* seq;
-    /* Must a string be queried to the user. */
-    bool use_prefix;
-    /* The prefix to be displayed when querying a string to the user. */
+/* The programs of the comp events (<C-A-l> for example), indexed by letter
+ * and modifiers. NULL if there is no such event.
+ */
+static cmdparser_prog_t* _events_comps[EVENTS_LETTERS * EVENTS_MODS];
+
+/* A node of the keymap, the trie of the seq events (abc for example) : it
+ * stands for the keys typed so far.
+ */
+struct _events_node_t {
+    /* The program to be run when the node is reached, NULL if more keys are
+     * expected.
+     */
+    cmdparser_prog_t* prog;
+    /* The prefix to be displayed when querying a string to the user, NULL if
+     * no string is queried.
+     */
     char* prefix;
-    /* Action to be performat when the event is completed. */
-    strformat_t* action;
 };
 
-/* The sequence events, sorted by seq. */
-static struct _events_seq_t* _events_seqs;
-static size_t _events_seqs_capa;
-static size_t _events_seqs_size;
+/* An edge of the keymap, from a node to its child reached by a key. */
+struct _events_edge_t {
+    uint32_t node;
+    int key;
+    /* The child, 0 if the slot is empty : the root is never a child. */
+    uint32_t child;
+};
+
+/* The nodes of the keymap, the root being the first one. */
+static struct _events_node_t* _events_nodes;
+static size_t _events_nodes_nb;
+static size_t _events_nodes_capa;
+/* The children of the root, indexed by key. */
+static uint32_t _events_root[EVENTS_KEYS];
+/* The other edges of the keymap. It is an open addressing hash table, kept at
+ * most half full.
+ */
+static struct _events_edge_t* _events_edges;
+static size_t _events_edges_nb;
+static size_t _events_edges_capa;
 /* The symbols that can be parsed in the actions. */
 static strformat_symbs_t* _events_sbs;
 
-/* An array of the typed letters. */
-static int _events_typed[EVENTS_MAX_SEQ];
-/* The number of typed letters. */
-static size_t _events_nb_typed;
+/* The node of the keys typed so far. */
+static uint32_t _events_node;
 /* Is the prompt on. */
 static bool _events_inprompt;
-/* Restrict where to search the seq event when a new key is typed. */
-static size_t _events_typ_min;
-static size_t _events_typ_max;
+/* Is the prompt of the jump on. */
+static bool _events_injump;
+/* The motion waiting to be performed, and its count. */
+static int _events_motion;
+static size_t _events_count;
 
 bool events_init()
 {
-    _events_comps = NULL;
-    _events_seqs  = NULL;
-    _events_sbs   = NULL;
-
-    _events_comps_size = 0;
-    _events_comps_capa = 10;
-    _events_comps = malloc(sizeof(struct _events_comp_t) * _events_comps_capa);
-    if(!_events_comps)
-        return false;
-
-    _events_seqs_size = 0;
-    _events_seqs_capa = 10;
-    _events_seqs = malloc(sizeof(struct _events_seq_t) * _events_seqs_capa);
-    if(!_events_seqs)
+    _events_edges      = NULL;
+    _events_edges_nb   = 0;
+    _events_edges_capa = 0;
+    _events_sbs        = NULL;
+    memset(_events_comps, 0, sizeof(_events_comps));
+    memset(_events_root, 0, sizeof(_events_root));
+
+    _events_nodes_nb   = 1;
+    _events_nodes_capa = 64;
+    _events_nodes = malloc(sizeof(struct _events_node_t) * _events_nodes_capa);
+    if(!_events_nodes)
         return false;
+    _events_nodes[0].prog   = NULL;
+    _events_nodes[0].prefix = NULL;
 
     _events_sbs = strformat_symbols("snti");
     if(!_events_sbs)
@@ -115,142 +145,117 @@ bool events_init()
     strformat_set(_events_sbs, 'y', "");
     strformat_set(_events_sbs, 'i', "");
 
-    _events_nb_typed = 0;
-    _events_typ_min  = 0;
-    _events_typ_max  = 0;
+    _events_node     = 0;
+    _events_inprompt = false;
+    _events_injump   = false;
+    _events_motion   = EVENTS_MOTION_NONE;
+    _events_count    = 0;
 
     return true;
 }
 
 void events_quit()
 {
-    size_t i;
-
-    if(_events_comps) {
-        for(i = 0; i < _events_comps_size; ++i)
-            free(_events_comps[i].action);
-        free(_events_comps);
+    if(_events_nodes) {
+        events_clear();
+        free(_events_nodes);
     }
-
-    if(_events_seqs) {
-        for(i = 0; i < _events_seqs_size; ++i) {
-            free(_events_seqs[i].seq);
-            strformat_destroy(_events_seqs[i].action);
-            if(_events_seqs[i].use_prefix)
-                free(_events_seqs[i].prefix);
-        }
-        free(_events_seqs);
-    }
-    
+    if(_events_edges)
+        free(_events_edges);
     if(_events_sbs)
         strformat_symbols_destroy(_events_sbs);
 }
 
-void events_clear()
+/* Free the program of a node. */
+static void _events_node_unset(struct _events_node_t* nd)
 {
-    _events_comps_size = 0;
-    _events_seqs_size  = 0;
+    if(nd->prog)
+        cmdparser_prog_destroy(nd->prog);
+    if(nd->prefix)
+        free(nd->prefix);
+    nd->prog   = NULL;
+    nd->prefix = NULL;
 }
 
-/* Add a new comp event. Returns false if the allocation failed : in this case,
- * all the comp events have been freed.
- */
-static bool _events_comp_insert(size_t pos, struct _events_comp_t elem)
+void events_clear()
 {
-    size_t nsize = _events_comps_size + 1;
-    size_t ncapa;
-    if(nsize >= _events_comps_capa) {
-        ncapa = _events_comps_capa + 10;
-        _events_comps = realloc(_events_comps,
-                ncapa * sizeof(struct _events_comp_t));
-        if(!_events_comps) {
-            _events_comps_size = 0;
-            _events_comps_capa = 0;
-            return false;
-        }
+    size_t i;
+
+    for(i = 0; i < EVENTS_LETTERS * EVENTS_MODS; ++i) {
+        if(_events_comps[i])
+            cmdparser_prog_destroy(_events_comps[i]);
+        _events_comps[i] = NULL;
     }
 
-    memmove(_events_comps + pos + 1, _events_comps + pos,
-            sizeof(struct _events_comp_t) * (_events_comps_size - pos));
-    _events_comps[pos] = elem;
-    ++_events_comps_size;
-    return true;
+    for(i = 0; i < _events_nodes_nb; ++i)
+        _events_node_unset(&_events_nodes[i]);
+    _events_nodes_nb = 1;
+    _events_node     = 0;
+    memset(_events_root, 0, sizeof(_events_root));
+    if(_events_edges)
+        memset(_events_edges, 0,
+                sizeof(struct _events_edge_t) * _events_edges_capa);
+    _events_edges_nb = 0;
 }
 
-/* Add a new seq event. Returns false if the allocation failed : in this case,
- * all the seq events have been freed.
- */
-static bool _events_seq_insert(size_t pos, struct _events_seq_t elem)
+/* Get the index of the comp event of a letter and a bitmask of modifiers. */
+static size_t _events_comp_index(int letter, unsigned char mods)
 {
-    size_t nsize = _events_seqs_size + 1;
-    size_t ncapa;
-    if(nsize >= _events_seqs_capa) {
-        ncapa = _events_seqs_capa + 10;
-        _events_seqs = realloc(_events_seqs,
-                ncapa * sizeof(struct _events_seq_t));
-        if(!_events_seqs) {
-            _events_seqs_size = 0;
-            _events_seqs_capa = 0;
-            return false;
-        }
-        _events_seqs_capa = ncapa;
-    }
-
-    memmove(_events_seqs + pos + 1, _events_seqs + pos,
-            sizeof(struct _events_seq_t) * (_events_seqs_size - pos));
-    _events_seqs[pos] = elem;
-    ++_events_seqs_size;
-    return true;
+    /* The super modifier is the only one after the fourth bit. */
+    mods = (mods & 0x0f) | ((mods & EVENTS_MOD_SUPER) >> 2);
+    return (size_t)letter * EVENTS_MODS + mods;
 }
 
-/* Parse the string of a comp event and add it. Return false if the syntax was
- * not respected.
+/* Parse the string of a comp event and add it, replacing the event with the
+ * same letter and modifiers. Return false if the syntax was not respected.
  */
 static bool _events_parse_comp(char* str, const char* action)
 {
-    struct _events_comp_t cp;
+    unsigned char mods;
+    int letter;
     size_t i;
     char c;
-    bool letter = false;
+    cmdparser_prog_t* prog;
+    bool hasletter = false;
 
     if(strlen(str) == 0 || strlen(str) % 2 != 1)
         return false;
 
-    cp.mods = 0;
+    mods   = 0;
+    letter = 0;
     for(i = 0; i < strlen(str); i += 2) {
         if(i != strlen(str) - 1 && str[i+1] != '-')
             return false;
         c = str[i];
         if(c == 'C')
-            cp.mods |= EVENTS_MOD_CTRL;
+            mods |= EVENTS_MOD_CTRL;
         else if(c == 'A')
-            cp.mods |= EVENTS_MOD_ALTR;
+            mods |= EVENTS_MOD_ALTR;
         else if(c == 'G')
-            cp.mods |= EVENTS_MOD_ALTL;
+            mods |= EVENTS_MOD_ALTL;
         else if(c == 'S')
-            cp.mods |= EVENTS_MOD_SHIFT;
+            mods |= EVENTS_MOD_SHIFT;
         else if(c == 'W')
-            cp.mods |= EVENTS_MOD_SUPER;
-        else if(!letter) {
-            cp.letter = c;
-            letter = true;
+            mods |= EVENTS_MOD_SUPER;
+        else if(!hasletter) {
+            letter    = (unsigned char)c;
+            hasletter = true;
         }
         else
             return false;
     }
-    if(!letter)
+    if(!hasletter)
         return false;
 
-    cp.action = strdup(action);
-    for(i = 0; i < _events_comps_size; ++i) {
-        if(cp.letter < _events_comps[i].letter)
-            break;
-    }
-    if(!_events_comp_insert(i, cp)) {
-        free(cp.action);
+    /* The actions of the comp events aren't substituted. */
+    prog = cmdparser_compile(action, NULL);
+    if(!prog)
         return false;
-    } else
-        return true;
+    i = _events_comp_index(letter, mods);
+    if(_events_comps[i])
+        cmdparser_prog_destroy(_events_comps[i]);
+    _events_comps[i] = prog;
+    return true;
 }
 
 /* Returns the key code corresponding to a key name. */
@@ -320,86 +325,195 @@ static int* _events_parse_seq_string(const char* str)
     return ret;
 }
 
-/* Get the length of a 0-terminated array of keycodes. */
-static size_t _events_seqlen(int* sq)
+/* Hash an edge of the keymap. */
+static uint32_t _events_edge_hash(uint32_t node, int key)
+{
+    uint64_t h = ((uint64_t)node << 32) | (uint32_t)key;
+    h *= 0x9e3779b97f4a7c15ULL;
+    return (uint32_t)(h >> 32);
+}
+
+/* Find the slot of an edge : either the slot holding it or the empty slot
+ * where it must be inserted.
+ */
+static struct _events_edge_t* _events_edges_find(uint32_t node, int key)
+{
+    struct _events_edge_t* slot;
+    size_t mask = _events_edges_capa - 1;
+    size_t i;
+
+    for(i = _events_edge_hash(node, key) & mask;; i = (i + 1) & mask) {
+        slot = &_events_edges[i];
+        if(slot->child == 0 || (slot->node == node && slot->key == key))
+            return slot;
+    }
+}
+
+/* Double the capacity of the edges. */
+static bool _events_edges_grow()
+{
+    struct _events_edge_t* old = _events_edges;
+    size_t oldcapa = _events_edges_capa;
+    size_t ncapa   = (oldcapa ? oldcapa * 2 : 256);
+    size_t i;
+
+    _events_edges = calloc(ncapa, sizeof(struct _events_edge_t));
+    if(!_events_edges) {
+        _events_edges = old;
+        return false;
+    }
+    _events_edges_capa = ncapa;
+
+    for(i = 0; i < oldcapa; ++i) {
+        if(old[i].child != 0)
+            *_events_edges_find(old[i].node, old[i].key) = old[i];
+    }
+    if(old)
+        free(old);
+    return true;
+}
+
+/* Get the child of a node reached by a key, 0 if there is none. */
+static uint32_t _events_child(uint32_t node, int key)
+{
+    if(node == 0 && key >= 0 && key < EVENTS_KEYS)
+        return _events_root[key];
+    if(_events_edges_nb == 0)
+        return 0;
+    return _events_edges_find(node, key)->child;
+}
+
+/* Get the child of a node reached by a key, adding it if there is none.
+ * Returns 0 if the allocation failed.
+ */
+static uint32_t _events_child_add(uint32_t node, int key)
 {
-    size_t l = 0;
-    while(sq[l++]);
-    return --l;
+    struct _events_node_t* nnodes;
+    struct _events_edge_t* slot;
+    uint32_t child;
+    size_t ncapa;
+
+    child = _events_child(node, key);
+    if(child != 0)
+        return child;
+
+    if(_events_nodes_nb >= UINT32_MAX)
+        return 0;
+    if(_events_nodes_nb >= _events_nodes_capa) {
+        ncapa  = _events_nodes_capa * 2;
+        nnodes = realloc(_events_nodes, sizeof(struct _events_node_t) * ncapa);
+        if(!nnodes)
+            return 0;
+        _events_nodes      = nnodes;
+        _events_nodes_capa = ncapa;
+    }
+
+    child = _events_nodes_nb;
+    if(node == 0 && key >= 0 && key < EVENTS_KEYS)
+        _events_root[key] = child;
+    else {
+        if(2 * (_events_edges_nb + 1) > _events_edges_capa
+                && !_events_edges_grow())
+            return 0;
+        slot = _events_edges_find(node, key);
+        slot->node  = node;
+        slot->key   = key;
+        slot->child = child;
+        ++_events_edges_nb;
+    }
+
+    _events_nodes[child].prog   = NULL;
+    _events_nodes[child].prefix = NULL;
+    ++_events_nodes_nb;
+    return child;
 }
 
-/* Compare two array of 0-terminated array of keycodes. Same semantic as
- * strcmp.
+/* Get the motion a program is, and store its count in count. Returns
+ * EVENTS_MOTION_NONE if the program isn't only a motion command.
  */
-static int _events_seqcmp(int* sq1, int* sq2)
+static int _events_prog_motion(cmdparser_prog_t* prog, size_t* count)
 {
-    size_t l1, l2, l, i;
-    l1 = _events_seqlen(sq1);
-    l2 = _events_seqlen(sq2);
-    l  = (l1 < l2 ? l1 : l2);
-
-    for(i = 0; i < l; ++i) {
-        if(sq1[i] != sq2[i])
-            return sq1[i] - sq2[i];
+    const char* name;
+    int i;
+
+    name = cmdparser_prog_name(prog);
+    if(!name || !cmdparser_prog_count(prog, count))
+        return EVENTS_MOTION_NONE;
+    for(i = 0; _events_motions_name[i]; ++i) {
+        if(strcmp(name, _events_motions_name[i]) == 0)
+            return i;
     }
-    return l1 - l2;
+    return EVENTS_MOTION_NONE;
 }
 
-/* Parse a complete seq event string and add it. */
+/* Parse a complete seq event string and add it, replacing the event with the
+ * same sequence.
+ */
 static bool _events_parse_seq(char* str, const char* action)
 {
     char* strtokbuf;
-    struct _events_seq_t sq;
+    char* prefix;
+    int* seq;
     size_t i;
-    sq.use_prefix = false;
-    sq.prefix     = NULL;
+    uint32_t node;
+    cmdparser_prog_t* prog;
 
     if(strlen(str) == 0 || str[0] == '<')
         return false;
 
+    prefix = NULL;
     i = strlen(str) - 1;
     if(str[i] == '>') {
         str[i] = '\0';
         str = strtok_r(str, "<", &strtokbuf);
         if(!str || strlen(str) == 0)
             return false;
-        sq.seq = _events_parse_seq_string(str);
+        seq = _events_parse_seq_string(str);
         str = strtok_r(NULL, "", &strtokbuf);
         if(!str) {
-            free(sq.seq);
+            free(seq);
             return false;
         }
-        sq.prefix = strdup(str);
-        sq.use_prefix = true;
+        prefix = strdup(str);
     }
     else
-        sq.seq = _events_parse_seq_string(str);
+        seq = _events_parse_seq_string(str);
+    if(!seq || seq[0] == 0) {
+        free(seq);
+        free(prefix);
+        return false;
+    }
 
-    sq.action = strformat_parse(_events_sbs, action);
-    for(i = 0; i < _events_seqs_size; ++i) {
-        if(_events_seqcmp(sq.seq, _events_seqs[i].seq) < 0)
+    /* The nodes of the sequence stay in the keymap if the allocation fails :
+     * they have no action so they are never triggered.
+     */
+    node = 0;
+    for(i = 0; seq[i]; ++i) {
+        node = _events_child_add(node, seq[i]);
+        if(node == 0)
             break;
     }
-    if(!_events_seq_insert(i, sq)) {
-        if(sq.use_prefix)
-            free(sq.prefix);
-        free(sq.action);
-        free(sq.seq);
+    free(seq);
+    prog = (node != 0 ? cmdparser_compile(action, _events_sbs) : NULL);
+    if(!prog) {
+        free(prefix);
         return false;
-    } else
-        return true;
+    }
+
+    _events_node_unset(&_events_nodes[node]);
+    _events_nodes[node].prog   = prog;
+    _events_nodes[node].prefix = prefix;
+    return true;
 }
 
 /* Clear the buffer of already typed keys. */
 static void _events_cancel()
 {
-    _events_nb_typed = 0;
+    _events_node = 0;
     if(_events_inprompt) {
         curses_command_leave();
         _events_inprompt = false;
     }
-    _events_typ_min = 0;
-    _events_typ_max = _events_seqs_size;
 }
 
 bool events_add(const char* ev, const char* action)
@@ -434,8 +548,7 @@ static void _events_set_list_symbols()
     feeder_iterator_t it;
     char buffer[256];
 
-    it = feeder_begin();
-    feeder_next(&it, curses_list_get());
+    it = curses_list_selected();
     snprintf(buffer, 256, "%lu", it.id);
     strformat_set(_events_sbs, 'i', buffer);
     strformat_set(_events_sbs, 'n', feeder_get_it_name(it));
@@ -454,88 +567,171 @@ static unsigned char _events_modifiers()
     return mods;
 }
 
+/* Perform the motion waiting to be performed. */
+static void _events_flush()
+{
+    switch(_events_motion) {
+        case EVENTS_MOTION_UP:
+            curses_list_up(_events_count);
+            break;
+        case EVENTS_MOTION_DOWN:
+            curses_list_down(_events_count);
+            break;
+        case EVENTS_MOTION_LEFT:
+            curses_list_left(_events_count);
+            break;
+        case EVENTS_MOTION_RIGHT:
+            curses_list_right(_events_count);
+            break;
+    }
+    _events_motion = EVENTS_MOTION_NONE;
+    _events_count  = 0;
+}
+
+/* Add a motion to the one waiting to be performed. The other motions are
+ * performed first.
+ */
+static void _events_move(int motion, size_t count)
+{
+    if(motion != _events_motion)
+        _events_flush();
+    _events_motion = motion;
+    if(_events_count + count < _events_count)
+        _events_count = (size_t)-1;
+    else
+        _events_count += count;
+}
+
 /* Check if the pressed key validate a comp event. */
 static bool _events_process_comp(int ev)
 {
-    unsigned char mods;
-    size_t i;
+    size_t i, count;
+    int motion;
 
     if(ev >= 'A' && ev <= 'Z')
         ev -= 'A';
+    if(ev < 0 || ev >= EVENTS_LETTERS)
+        return false;
 
-    mods = _events_modifiers();
-    for(i = 0; i < _events_comps_size; ++i) {
-        if(_events_comps[i].mods == mods && _events_comps[i].letter == ev) {
-            cmdparser_parse(_events_comps[i].action);
-            return true;
-        }
+    i = _events_comp_index(ev, _events_modifiers());
+    if(!_events_comps[i])
+        return false;
+    motion = _events_prog_motion(_events_comps[i], &count);
+    if(motion != EVENTS_MOTION_NONE)
+        _events_move(motion, count);
+    else {
+        _events_flush();
+        cmdparser_run(_events_comps[i]);
     }
-    return false;
+    return true;
 }
 
 /* Check if the pressed key validate a seq event. */
 static void _events_process_seq(int ev)
 {
-    size_t i;
-    size_t off;
-    struct _events_seq_t sq;
-
-    off = _events_nb_typed;
-    for(i = _events_typ_min; i < _events_typ_max; ++i) {
-        if(_events_seqlen(_events_seqs[i].seq) > off) {
-            if(_events_seqs[i].seq[off] < ev)
-                ++_events_typ_min;
-            else if(_events_seqs[i].seq[off] > ev)
-                --_events_typ_max;
-        }
-        else
-            --_events_typ_max;
-    }
+    struct _events_node_t* nd;
+    size_t count;
+    int motion;
 
+    _events_node = _events_child(_events_node, ev);
     /* No events matching. */
-    if(_events_typ_max - _events_typ_min < 1)
+    if(_events_node == 0) {
+        _events_cancel();
+        return;
+    }
+
+    nd = &_events_nodes[_events_node];
+    if(!nd->prog)
+        return;
+    motion = (nd->prefix ? EVENTS_MOTION_NONE
+            : _events_prog_motion(nd->prog, &count));
+    if(motion != EVENTS_MOTION_NONE) {
+        _events_move(motion, count);
         _events_cancel();
-    /* One event potentially matching. */
+    }
+    else if(nd->prefix) {
+        _events_flush();
+        _events_inprompt = true;
+        curses_command_enter(nd->prefix);
+    }
     else {
-        _events_typed[off]     = ev;
-        _events_typed[off + 1] = 0;
-        ++_events_nb_typed;
-        for(i = _events_typ_min; i < _events_typ_max; ++i) {
-            sq = _events_seqs[i];
-            if(_events_seqcmp(_events_typed, sq.seq) == 0) {
-                if(sq.use_prefix) {
-                    _events_inprompt = true;
-                    curses_command_enter(sq.prefix);
-                    _events_typ_max = _events_typ_min = i;
-                }
-                else {
-                    strformat_set(_events_sbs, 's', "");
-                    _events_set_list_symbols();
-                    cmdparser_parse(strformat_get(sq.action));
-                    _events_cancel();
-                }
-            }
+        _events_flush();
+        /* Nothing is allocated if there is nothing to substitute. */
+        if(!cmdparser_prog_constant(nd->prog)) {
+            strformat_set(_events_sbs, 's', "");
+            _events_set_list_symbols();
         }
+        cmdparser_run(nd->prog);
+        _events_cancel();
     }
 }
 
+void events_jump(const char* prefix)
+{
+    if(_events_inprompt || _events_injump)
+        return;
+    _events_injump = true;
+    curses_command_enter(prefix ? prefix : "Jump : ");
+}
+
+/* Select the first displayed line which name starts with the text typed in
+ * the prompt of the jump.
+ */
+static void _events_jump_update()
+{
+    feeder_iterator_t it;
+    const char* text = curses_command_text();
+    if(text[0] == '\0')
+        return;
+
+    it = feeder_find_prefix(text);
+    curses_list_set_it(it);
+}
+
+/* Leave the prompt of the jump. */
+static void _events_jump_leave()
+{
+    if(!_events_injump)
+        return;
+    curses_command_leave();
+    _events_injump = false;
+}
+
 void events_process()
 {
     int ev;
 
-    ev = getch();
-    if(ev == KEY_CANCEL)
-        _events_cancel();
-    else if(_events_inprompt) {
-        if(!curses_command_parse_event(ev)) {
-            strformat_set(_events_sbs, 's', curses_command_leave());
-            _events_set_list_symbols();
-            cmdparser_parse(
-                strformat_get(_events_seqs[_events_typ_min].action));
+    /* All the pending keys are handled before the screen is drawn, so that
+     * the keys repeated while a frame is drawn don't pile up. The repeated
+     * motions are performed at once.
+     */
+    while((ev = curses_getch()) != ERR) {
+        if(ev == CURSES_KEY_EOF) {
+            /* No more keys will come. */
+            _events_flush();
+            cmdparser_parse("quit");
+            break;
+        }
+        else if(ev == KEY_CANCEL) {
             _events_cancel();
+            _events_jump_leave();
         }
+        else if(_events_injump) {
+            if(!curses_command_parse_event(ev))
+                _events_jump_leave();
+            else
+                _events_jump_update();
+        }
+        else if(_events_inprompt) {
+            if(!curses_command_parse_event(ev)) {
+                strformat_set(_events_sbs, 's', curses_command_leave());
+                _events_set_list_symbols();
+                cmdparser_run(_events_nodes[_events_node].prog);
+                _events_cancel();
+            }
+        }
+        else if(_events_node != 0 || !_events_process_comp(ev))
+            _events_process_seq(ev);
     }
-    else if(_events_nb_typed != 0 || !_events_process_comp(ev))
-        _events_process_seq(ev);
+    _events_flush();
 }
-
@@ -27,10 +27,17 @@ void events_clear();
  *                 queried to the user.
  * If it contains %n, %t or %i, they will be replaced by the line name, text
  * and id (respectively).
- * ev and action will be duplicated, they don't need to remain valid afterward.
+ * An event replaces the previous one with the same keys. ev and action will be
+ * duplicated, they don't need to remain valid afterward.
  */
 bool events_add(const char* ev, const char* action);
 
+/* Open a prompt, with prefix printed before it ("Jump : " if it is NULL) :
+ * while it is typed, the first displayed line which name starts with its text
+ * is selected. It is left with return.
+ */
+void events_jump(const char* prefix);
+
 /* Blocking event processing. */
 void events_process();
 
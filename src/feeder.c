@@ -2,36 +2,199 @@
 #include "feeder.h"
 #include "spawn.h"
 #include "curses.h"
+#include "filter.h"
+#include "fields.h"
+#include "sort.h"
+#include "widths.h"
+#include "ansi.h"
+#include "render.h"
+#include <string.h>
+#include <stdint.h>
+
+/* The number of lines given at once to the filter. */
+#define FEEDER_FILTER_BATCH 1024
+/* The size of the buffer the output of the feeder is read in. A line can't be
+ * longer.
+ */
+#define FEEDER_BUFFER 65536
+/* The number of words of 64 bits holding a bit for each of nb lines. */
+#define FEEDER_WORDS(nb) (((nb) + 63) / 64)
 
 /* The process of the feeder. */
 static spawn_t _feeder_sp;
 /* A read line. */
 struct _feeder_line_t {
-    /* The text of the line. */
+    /* The text of the line, without its escape sequences. */
     char* line;
+    /* The length of the text. */
+    size_t len;
+    /* The attribute runs of the text. They are allocated with the text. */
+    ansi_run_t* runs;
+    size_t nbruns;
     /* The id of the line. */
     char* id;
     /* Is the line shown. */
     bool show;
+    /* Does the line match the filter. */
+    bool match;
 };
 /* The array of all the line read. */
 static struct _feeder_line_t*  _feeder_lines;
 static size_t                  _feeder_nb;
 static size_t                  _feeder_capa;
+/* The number of displayed lines. */
+static size_t                  _feeder_shown;
+/* The display order : the ids of the lines by position, and the position of
+ * each line by id. They are NULL if the lines are displayed in the order they
+ * were read.
+ */
+static size_t*                 _feeder_order;
+static size_t*                 _feeder_rank;
+/* A Fenwick tree counting the displayed lines by position, from 1 : it gives
+ * the number of displayed lines before a position. Only its first
+ * _feeder_ranks_nb nodes are built, the others are added when needed.
+ */
+static size_t*                 _feeder_ranks;
+static size_t                  _feeder_ranks_nb;
+static size_t                  _feeder_ranks_capa;
+/* The ids of the lines in the order of their names, and the index of each
+ * line in it. The lines read since the last time it was used are sorted and
+ * merged into it. _feeder_byname_nb is the number of lines it holds.
+ */
+static size_t*                 _feeder_byname;
+static size_t*                 _feeder_byname_rank;
+static size_t                  _feeder_byname_nb;
+/* The first id of the lines sorted by _feeder_byname_update. */
+static size_t                  _feeder_byname_from;
+/* A segment tree over _feeder_byname : each node holds the smallest display
+ * position of the displayed lines under it, _feeder_nb if there is none. Its
+ * leaves are at [_feeder_bypos_nb, 2 * _feeder_bypos_nb). The changes of a
+ * line are applied to it at once, but it is built again after lines are added
+ * or the display changed as a whole.
+ */
+static size_t*                 _feeder_bypos;
+static size_t                  _feeder_bypos_nb;
+static bool                    _feeder_bypos_valid;
+
+/* The lines marked by the user : a bit by id, in words of 64 bits, allocated
+ * along with _feeder_lines.
+ */
+static uint64_t*               _feeder_marks;
+/* The number of marked lines. */
+static size_t                  _feeder_marked;
+/* The displayed lines, shown and matching the filter, in bits like the
+ * marks. The bits after the last line are cleared.
+ */
+static uint64_t*               _feeder_vis;
+
+/* A slot of the set of the names. */
+struct _feeder_slot_t {
+    /* The hash of the name, so that most of the names which differ are told
+     * apart without reading them.
+     */
+    uint32_t hash;
+    /* The id of the line plus one, 0 if the slot is empty. */
+    uint32_t id;
+};
+/* The handling of the duplicated names. */
+static int                     _feeder_unique;
+/* The set of the names of the lines, used if _feeder_unique isn't
+ * FEEDER_UNIQUE_NONE. It is an open addressing hash table, kept at most half
+ * full.
+ */
+static struct _feeder_slot_t*  _feeder_names;
+static size_t                  _feeder_names_nb;
+static size_t                  _feeder_names_capa;
+
+/* The buffer the output of the feeder is read in. Its first _feeder_rest bytes
+ * are the beginning of a line which end hasn't been read yet.
+ */
+static char                    _feeder_buffer[FEEDER_BUFFER];
+static size_t                  _feeder_rest;
+/* The runs of the line being parsed. */
+static ansi_run_t*             _feeder_runs;
+static size_t                  _feeder_runs_capa;
 
 bool feeder_init()
 {
     _feeder_nb     = 0;
+    _feeder_shown  = 0;
     _feeder_capa   = 50;
     _feeder_lines  = malloc(sizeof(struct _feeder_line_t) * _feeder_capa);
+    _feeder_order  = NULL;
+    _feeder_rank   = NULL;
+    _feeder_ranks  = NULL;
+    _feeder_ranks_nb    = 0;
+    _feeder_ranks_capa  = 0;
+    _feeder_byname = NULL;
+    _feeder_byname_rank = NULL;
+    _feeder_byname_nb   = 0;
+    _feeder_bypos  = NULL;
+    _feeder_bypos_nb    = 0;
+    _feeder_bypos_valid = false;
+    _feeder_marks  = calloc(FEEDER_WORDS(_feeder_capa), sizeof(uint64_t));
+    _feeder_marked = 0;
+    _feeder_vis    = calloc(FEEDER_WORDS(_feeder_capa), sizeof(uint64_t));
+    _feeder_unique = FEEDER_UNIQUE_NONE;
+    _feeder_names  = NULL;
+    _feeder_names_nb   = 0;
+    _feeder_names_capa = 0;
+    _feeder_rest       = 0;
+    _feeder_runs       = NULL;
+    _feeder_runs_capa  = 0;
     _feeder_sp     = spawn_init();
-    return _feeder_lines;
+    return _feeder_lines && _feeder_marks && _feeder_vis;
+}
+
+/* Go back to the order in which the lines were read. */
+static void _feeder_unsort()
+{
+    if(_feeder_order)
+        free(_feeder_order);
+    if(_feeder_rank)
+        free(_feeder_rank);
+    _feeder_order = NULL;
+    _feeder_rank  = NULL;
+    _feeder_ranks_nb    = 0;
+    _feeder_bypos_valid = false;
+}
+
+/* Empty the set of the names and their order. */
+static void _feeder_names_clear()
+{
+    if(_feeder_names)
+        free(_feeder_names);
+    _feeder_names      = NULL;
+    _feeder_names_nb   = 0;
+    _feeder_names_capa = 0;
+    if(_feeder_byname)
+        free(_feeder_byname);
+    if(_feeder_byname_rank)
+        free(_feeder_byname_rank);
+    _feeder_byname      = NULL;
+    _feeder_byname_rank = NULL;
+    _feeder_byname_nb   = 0;
+    if(_feeder_bypos)
+        free(_feeder_bypos);
+    _feeder_bypos       = NULL;
+    _feeder_bypos_nb    = 0;
+    _feeder_bypos_valid = false;
 }
 
 void feeder_quit()
 {
     size_t i;
     spawn_close(&_feeder_sp);
+    _feeder_unsort();
+    _feeder_names_clear();
+    if(_feeder_ranks)
+        free(_feeder_ranks);
+    if(_feeder_runs)
+        free(_feeder_runs);
+    if(_feeder_marks)
+        free(_feeder_marks);
+    if(_feeder_vis)
+        free(_feeder_vis);
     if(_feeder_lines) {
         for(i = 0; i < _feeder_nb; ++i) {
             free(_feeder_lines[i].id);
@@ -51,13 +214,28 @@ bool feeder_set(const char* command)
             free(_feeder_lines[i].line);
         }
     }
-    _feeder_nb = 0;
+    memset(_feeder_marks, 0, sizeof(uint64_t) * FEEDER_WORDS(_feeder_nb));
+    memset(_feeder_vis,   0, sizeof(uint64_t) * FEEDER_WORDS(_feeder_nb));
+    _feeder_marked = 0;
+    _feeder_nb    = 0;
+    _feeder_shown = 0;
+    _feeder_rest  = 0;
+    _feeder_unsort();
+    _feeder_names_clear();
+    filter_clear();
+    fields_clear();
+    widths_clear();
     curses_list_changed(true);
 
     _feeder_sp = spawn_create_shell(command);
     return spawn_ok(_feeder_sp);
 }
 
+void feeder_set_unique(int mode)
+{
+    _feeder_unique = mode;
+}
+
 int feeder_fd()
 {
     if(spawn_ok(_feeder_sp))
@@ -66,79 +244,448 @@ int feeder_fd()
         return -1;
 }
 
-/* Add a new read line to the array. */
-static void _feeder_add_line(char* line)
+/* Get the id of the line at a position of the display order. */
+static size_t _feeder_id(size_t pos)
+{
+    return (_feeder_order ? _feeder_order[pos] : pos);
+}
+
+/* Get the position in the display order of a line. */
+static size_t _feeder_pos(size_t id)
+{
+    return (_feeder_rank ? _feeder_rank[id] : id);
+}
+
+/* Indicates if a line must be displayed. */
+static bool _feeder_visible(size_t id)
+{
+    return (_feeder_vis[id / 64] >> (id % 64)) & 1;
+}
+
+/* Count a line at a position as displayed or not in the built nodes of the
+ * tree of the ranks.
+ */
+static void _feeder_ranks_set(size_t pos, bool visible)
+{
+    size_t i;
+    for(i = pos + 1; i <= _feeder_ranks_nb; i += i & -i) {
+        if(visible)
+            ++_feeder_ranks[i];
+        else
+            --_feeder_ranks[i];
+    }
+}
+
+/* Build the nodes of the tree of the ranks for the lines added since the last
+ * time. Returns false if it couldn't be allocated.
+ */
+static bool _feeder_ranks_update()
+{
+    size_t* nranks;
+    size_t i, j;
+
+    if(_feeder_ranks_capa < _feeder_nb + 1) {
+        nranks = realloc(_feeder_ranks, sizeof(size_t) * (_feeder_capa + 1));
+        if(!nranks)
+            return false;
+        _feeder_ranks      = nranks;
+        _feeder_ranks_capa = _feeder_capa + 1;
+    }
+
+    /* A node sums its line and the nodes under it, which are already built. */
+    for(i = _feeder_ranks_nb + 1; i <= _feeder_nb; ++i) {
+        _feeder_ranks[i] = _feeder_visible(_feeder_id(i - 1));
+        for(j = i - 1; j > i - (i & -i); j -= j & -j)
+            _feeder_ranks[i] += _feeder_ranks[j];
+    }
+    _feeder_ranks_nb = _feeder_nb;
+    return true;
+}
+
+/* Get the number of displayed lines before a position. */
+static size_t _feeder_ranks_get(size_t pos)
+{
+    size_t i, vid = 0;
+
+    if(!_feeder_ranks_update()) {
+        for(i = 0; i < pos; ++i)
+            vid += _feeder_visible(_feeder_id(i));
+        return vid;
+    }
+    for(i = pos; i > 0; i -= i & -i)
+        vid += _feeder_ranks[i];
+    return vid;
+}
+
+/* Set the leaf of a line in the tree of the display positions, and the nodes
+ * above it.
+ */
+static void _feeder_bypos_set(size_t id)
+{
+    size_t i, nb = _feeder_bypos_nb;
+
+    if(!_feeder_bypos_valid || id >= nb)
+        return;
+    i = nb + _feeder_byname_rank[id];
+    _feeder_bypos[i] = (_feeder_visible(id) ? _feeder_pos(id) : _feeder_nb);
+    for(i /= 2; i > 0; i /= 2) {
+        _feeder_bypos[i] = (_feeder_bypos[2 * i] < _feeder_bypos[2 * i + 1]
+                ? _feeder_bypos[2 * i] : _feeder_bypos[2 * i + 1]);
+    }
+}
+
+/* Set the flags deciding if a line is displayed, and count it. */
+static void _feeder_flags(size_t id, bool show, bool match)
+{
+    bool before = _feeder_visible(id);
+    bool after  = show && match;
+    _feeder_lines[id].show  = show;
+    _feeder_lines[id].match = match;
+    if(before == after) {
+        fields_show(id, after);
+        return;
+    }
+
+    _feeder_vis[id / 64] ^= (uint64_t)1 << (id % 64);
+    if(after)
+        ++_feeder_shown;
+    else
+        --_feeder_shown;
+    _feeder_ranks_set(_feeder_pos(id), after);
+    _feeder_bypos_set(id);
+    fields_show(id, after);
+}
+
+/* Apply the filter to the lines with ids in [from, to). */
+static void _feeder_filter_lines(size_t from, size_t to)
+{
+    const char* texts[FEEDER_FILTER_BATCH];
+    size_t lens[FEEDER_FILTER_BATCH];
+    bool out[FEEDER_FILTER_BATCH];
+    size_t i, j, nb;
+
+    for(i = from; i < to; i += nb) {
+        nb = (to - i < FEEDER_FILTER_BATCH ? to - i : FEEDER_FILTER_BATCH);
+        for(j = 0; j < nb; ++j) {
+            texts[j] = _feeder_lines[i + j].line;
+            lens[j]  = _feeder_lines[i + j].len;
+        }
+        filter_eval(i, nb, texts, lens, out);
+        for(j = 0; j < nb; ++j) {
+            _feeder_flags(i + j, _feeder_lines[i + j].show, out[j]);
+        }
+    }
+}
+
+/* Double the capacity of the arrays of lines. */
+static bool _feeder_grow()
+{
+    struct _feeder_line_t* nlines;
+    size_t* norder;
+    uint64_t* nmarks;
+    size_t ncapa = _feeder_capa * 2;
+
+    nlines = realloc(_feeder_lines, sizeof(struct _feeder_line_t) * ncapa);
+    if(!nlines)
+        return false;
+    _feeder_lines = nlines;
+
+    nmarks = realloc(_feeder_marks, sizeof(uint64_t) * FEEDER_WORDS(ncapa));
+    if(!nmarks)
+        return false;
+    memset(nmarks + FEEDER_WORDS(_feeder_capa), 0, sizeof(uint64_t)
+            * (FEEDER_WORDS(ncapa) - FEEDER_WORDS(_feeder_capa)));
+    _feeder_marks = nmarks;
+
+    nmarks = realloc(_feeder_vis, sizeof(uint64_t) * FEEDER_WORDS(ncapa));
+    if(!nmarks)
+        return false;
+    memset(nmarks + FEEDER_WORDS(_feeder_capa), 0, sizeof(uint64_t)
+            * (FEEDER_WORDS(ncapa) - FEEDER_WORDS(_feeder_capa)));
+    _feeder_vis = nmarks;
+
+    if(_feeder_order) {
+        norder = realloc(_feeder_order, sizeof(size_t) * ncapa);
+        if(!norder)
+            return false;
+        _feeder_order = norder;
+        norder = realloc(_feeder_rank, sizeof(size_t) * ncapa);
+        if(!norder)
+            return false;
+        _feeder_rank = norder;
+    }
+
+    _feeder_capa = ncapa;
+    return true;
+}
+
+/* Hash a name (FNV-1a). */
+static uint32_t _feeder_hash(const char* name)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for(; *name; ++name) {
+        h ^= (unsigned char)*name;
+        h *= 1099511628211ULL;
+    }
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+/* Find the slot of a name in the set : either the slot holding it or the
+ * empty slot where it must be inserted.
+ */
+static struct _feeder_slot_t* _feeder_names_find(const char* name,
+        uint32_t hash)
+{
+    struct _feeder_slot_t* slot;
+    size_t mask = _feeder_names_capa - 1;
+    size_t i;
+
+    for(i = hash & mask;; i = (i + 1) & mask) {
+        slot = &_feeder_names[i];
+        if(slot->id == 0)
+            return slot;
+        if(slot->hash == hash
+                && strcmp(_feeder_lines[slot->id - 1].id, name) == 0)
+            return slot;
+    }
+}
+
+/* Double the capacity of the set of the names. */
+static bool _feeder_names_grow()
+{
+    struct _feeder_slot_t* old = _feeder_names;
+    size_t oldcapa = _feeder_names_capa;
+    size_t ncapa   = (oldcapa ? oldcapa * 2 : 1024);
+    size_t i, j, mask;
+
+    _feeder_names = calloc(ncapa, sizeof(struct _feeder_slot_t));
+    if(!_feeder_names) {
+        _feeder_names = old;
+        return false;
+    }
+    _feeder_names_capa = ncapa;
+
+    /* The names don't need to be compared again. */
+    mask = ncapa - 1;
+    for(i = 0; i < oldcapa; ++i) {
+        if(old[i].id == 0)
+            continue;
+        for(j = old[i].hash & mask; _feeder_names[j].id; j = (j + 1) & mask);
+        _feeder_names[j] = old[i];
+    }
+    if(old)
+        free(old);
+    return true;
+}
+
+/* Store the text of a line, without its escape sequences, in ln. The
+ * attribute runs of the escape sequences are allocated after the text. Returns
+ * false if the allocation failed.
+ */
+static bool _feeder_store_text(struct _feeder_line_t* ln, char* text)
+{
+    ansi_run_t* nruns;
+    size_t len, max, nb, size;
+    char* block;
+
+    len = strlen(text);
+    nb  = 0;
+    max = ansi_max_runs(text, len);
+    if(max > 0) {
+        if(max > _feeder_runs_capa) {
+            nruns = realloc(_feeder_runs, sizeof(ansi_run_t) * max);
+            if(!nruns)
+                return false;
+            _feeder_runs      = nruns;
+            _feeder_runs_capa = max;
+        }
+        len = ansi_parse(text, len, _feeder_runs, &nb);
+        text[len] = '\0';
+    }
+
+    /* The runs are aligned after the text. */
+    size  = (len + sizeof(ansi_run_t)) / sizeof(ansi_run_t);
+    size *= sizeof(ansi_run_t);
+    block = malloc(size + sizeof(ansi_run_t) * nb);
+    if(!block)
+        return false;
+    memcpy(block, text, len + 1);
+    ln->line   = block;
+    ln->len    = len;
+    ln->runs   = (nb ? (ansi_run_t*)(block + size) : NULL);
+    ln->nbruns = nb;
+    if(nb)
+        memcpy(ln->runs, _feeder_runs, sizeof(ansi_run_t) * nb);
+    return true;
+}
+
+/* Replace the text of an already read line. */
+static void _feeder_replace_line(size_t id, char* text)
+{
+    struct _feeder_line_t* ln = &_feeder_lines[id];
+    struct _feeder_line_t nln;
+    bool match;
+
+    if(!_feeder_store_text(&nln, text))
+        return;
+    free(ln->line);
+    ln->line   = nln.line;
+    ln->len    = nln.len;
+    ln->runs   = nln.runs;
+    ln->nbruns = nln.nbruns;
+    fields_replace(id, ln->line, ln->len);
+    widths_forget(id);
+    filter_replace(id, ln->line, ln->len);
+    filter_eval(id, 1, (const char* const*)&ln->line, &ln->len, &match);
+    _feeder_flags(id, ln->show, match);
+}
+
+/* Add a new read line to the array. Returns false if the line wasn't added,
+ * and sets replaced if it has replaced the text of a previous line.
+ */
+static bool _feeder_add_line(char* line, bool* replaced)
 {
     struct _feeder_line_t ln;
+    struct _feeder_slot_t* slot = NULL;
+    uint32_t hash = 0;
     char* strtokbuf;
+    char* text;
 
-    ln.id   = strtok_r(line, "\t", &strtokbuf);
-    ln.line = strtok_r(NULL, "",  &strtokbuf);
-    ln.show = true;
-    if(!ln.id || !ln.line)
-        return;
-    ln.id   = strdup(ln.id);
-    ln.line = strdup(ln.line);
-
-    if(_feeder_nb >= _feeder_capa) {
-        _feeder_capa += 50;
-        _feeder_lines = realloc(_feeder_lines,
-                sizeof(struct _feeder_line_t) * _feeder_capa);
-        if(!_feeder_lines) {
-            free(ln.id);
-            free(ln.line);
-            return;
+    ln.id    = strtok_r(line, "\t", &strtokbuf);
+    text     = strtok_r(NULL, "",  &strtokbuf);
+    ln.show  = true;
+    ln.match = true;
+    if(!ln.id || !text)
+        return false;
+
+    if(_feeder_unique != FEEDER_UNIQUE_NONE) {
+        if(_feeder_names_nb * 2 >= _feeder_names_capa && !_feeder_names_grow())
+            return false;
+        hash = _feeder_hash(ln.id);
+        slot = _feeder_names_find(ln.id, hash);
+        if(slot->id != 0) {
+            if(_feeder_unique == FEEDER_UNIQUE_LAST) {
+                _feeder_replace_line(slot->id - 1, text);
+                *replaced = true;
+            }
+            return false;
         }
     }
 
+    if(!_feeder_store_text(&ln, text))
+        return false;
+    ln.id = strdup(ln.id);
+
+    if(!ln.id || (_feeder_nb >= _feeder_capa && !_feeder_grow())) {
+        free(ln.id);
+        free(ln.line);
+        return false;
+    }
+
+    /* A line read after a sort is displayed at the end. */
+    if(_feeder_order) {
+        _feeder_order[_feeder_nb] = _feeder_nb;
+        _feeder_rank[_feeder_nb]  = _feeder_nb;
+    }
+    if(slot) {
+        slot->hash = hash;
+        slot->id   = _feeder_nb + 1;
+        ++_feeder_names_nb;
+    }
     _feeder_lines[_feeder_nb] = ln;
+    _feeder_vis[_feeder_nb / 64] |= (uint64_t)1 << (_feeder_nb % 64);
+    fields_add(_feeder_nb, ln.line, ln.len);
     ++_feeder_nb;
-    curses_list_changed(false);
+    ++_feeder_shown;
+    return true;
 }
 
 void feeder_update()
 {
-    char buffer[4096];
-    size_t cont;
+    size_t cont, used;
     char* line;
-    char* strtokbuf;
+    char* end;
+    size_t first;
+    bool replaced;
 
     if(!spawn_ok(_feeder_sp))
         return;
 
-    if((cont = spawn_read(_feeder_sp, buffer, 4095)) != 0) {
-        buffer[cont] = '\0';
+    cont = spawn_read(_feeder_sp, _feeder_buffer + _feeder_rest,
+            FEEDER_BUFFER - 1 - _feeder_rest);
+    if(cont == (size_t)-1)
+        return;
+
+    first    = _feeder_nb;
+    replaced = false;
+    used     = _feeder_rest + cont;
+    line     = _feeder_buffer;
+    while((end = memchr(line, '\n', _feeder_buffer + used - line))) {
+        *end = '\0';
+        _feeder_add_line(line, &replaced);
+        line = end + 1;
+    }
 
-        line = strtok_r(buffer, "\n", &strtokbuf);
-        while(line) {
-            _feeder_add_line(line);
-            line = strtok_r(NULL, "\n", &strtokbuf);
-        }
+    /* Keeping the beginning of the last line until its end is read, unless it
+     * fills the buffer or there is nothing more to read.
+     */
+    _feeder_rest = _feeder_buffer + used - line;
+    if(cont == 0 || _feeder_rest == FEEDER_BUFFER - 1) {
+        line[_feeder_rest] = '\0';
+        _feeder_add_line(line, &replaced);
+        _feeder_rest = 0;
+    }
+    else
+        memmove(_feeder_buffer, line, _feeder_rest);
+
+    if(cont == 0) {
+        /* The end of the output : the feeder mustn't be watched anymore. */
+        spawn_close(&_feeder_sp);
     }
+
+    if(_feeder_nb != first)
+        _feeder_filter_lines(first, _feeder_nb);
+    if(_feeder_nb != first || replaced)
+        curses_list_changed(replaced);
+}
+
+/* Set the id and validity of an iterator from its position, moving it forward
+ * to the first displayed line.
+ */
+static void _feeder_it_skip(feeder_iterator_t* it)
+{
+    while(it->pos < _feeder_nb && !_feeder_visible(_feeder_id(it->pos)))
+        ++it->pos;
+    it->valid = (it->pos < _feeder_nb);
+    it->id    = (it->valid ? _feeder_id(it->pos) : _feeder_nb);
 }
 
 feeder_iterator_t feeder_begin()
 {
     feeder_iterator_t it;
-    it.id    = 0;
-    it.vid   = it.id;
-    it.valid = (_feeder_nb != 0);
+    it.pos = 0;
+    it.vid = 0;
+    _feeder_it_skip(&it);
     return it;
 }
 
 feeder_iterator_t feeder_end()
 {
-    size_t i;
     feeder_iterator_t it;
     it.id    = _feeder_nb;
+    it.pos   = _feeder_nb;
+    it.vid   = _feeder_shown;
     it.valid = false;
+    return it;
+}
 
-    /* TODO optimize */
-    it.vid   = 0;
-    for(i = 0; i < _feeder_nb; ++i) {
-        if(_feeder_lines[i].show)
-            ++it.vid;
-    }
+feeder_iterator_t feeder_at_id(size_t id)
+{
+    feeder_iterator_t it;
+
+    it.pos = (id < _feeder_nb ? _feeder_pos(id) : _feeder_nb);
+    it.vid = _feeder_ranks_get(it.pos);
+    _feeder_it_skip(&it);
     return it;
 }
 
@@ -150,11 +697,13 @@ feeder_iterator_t feeder_next(feeder_iterator_t* it, size_t n)
 
     count = 0;
     while(count < n) {
-        ++it->id;
-        if(it->id >= _feeder_nb) {
+        ++it->pos;
+        if(it->pos >= _feeder_nb) {
             it->valid = false;
             return *it;
-        } else if(_feeder_lines[it->id].show) {
+        }
+        it->id = _feeder_id(it->pos);
+        if(_feeder_visible(it->id)) {
             ++it->vid;
             ++count;
         }
@@ -171,14 +720,13 @@ feeder_iterator_t feeder_prev(feeder_iterator_t* it, size_t n)
 
     count = 0;
     while(count < n) {
-        if(it->id == 0) {
-            if(count != n) {
-                it->valid = false;
-                return *it;
-            }
+        if(it->pos == 0) {
+            it->valid = false;
+            return *it;
         }
-        --it->id;
-        if(_feeder_lines[it->id].show) {
+        --it->pos;
+        it->id = _feeder_id(it->pos);
+        if(_feeder_visible(it->id)) {
             --it->vid;
             ++count;
         }
@@ -194,6 +742,23 @@ const char* feeder_get_it_text(feeder_iterator_t it)
     return _feeder_lines[it.id].line;
 }
 
+size_t feeder_get_it_length(feeder_iterator_t it)
+{
+    if(!it.valid)
+        return 0;
+    return _feeder_lines[it.id].len;
+}
+
+const ansi_run_t* feeder_get_it_runs(feeder_iterator_t it, size_t* nb)
+{
+    if(!it.valid) {
+        *nb = 0;
+        return NULL;
+    }
+    *nb = _feeder_lines[it.id].nbruns;
+    return _feeder_lines[it.id].runs;
+}
+
 const char* feeder_get_it_name(feeder_iterator_t it)
 {
     if(!it.valid)
@@ -203,7 +768,7 @@ const char* feeder_get_it_name(feeder_iterator_t it)
 
 int feeder_it_cmp(feeder_iterator_t it1, feeder_iterator_t it2)
 {
-    return it1.id - it2.id;
+    return (it1.pos > it2.pos) - (it1.pos < it2.pos);
 }
 
 void feeder_hide(bool hide, size_t id1, size_t id2)
@@ -212,8 +777,9 @@ void feeder_hide(bool hide, size_t id1, size_t id2)
     if(id1 > id2
             || id2 >= _feeder_nb)
         return;
-    for(i = id1; i <= id2; ++i)
-        _feeder_lines[i].show = !hide;
+    for(i = id1; i <= id2; ++i) {
+        _feeder_flags(i, !hide, _feeder_lines[i].match);
+    }
     curses_list_changed(true);
 }
 
@@ -223,8 +789,372 @@ void feeder_hide_toggle(size_t id1, size_t id2)
     if(id1 > id2
             || id2 >= _feeder_nb)
         return;
-    for(i = id1; i <= id2; ++i)
-        _feeder_lines[i].show = !_feeder_lines[i].show;
+    for(i = id1; i <= id2; ++i) {
+        _feeder_flags(i, !_feeder_lines[i].show, _feeder_lines[i].match);
+    }
+    curses_list_changed(true);
+}
+
+bool feeder_filter(const char* expr)
+{
+    if(!filter_set(expr))
+        return false;
+    /* All the lines may change : the trees are built again instead. */
+    _feeder_ranks_nb    = 0;
+    _feeder_bypos_valid = false;
+    _feeder_filter_lines(0, _feeder_nb);
     curses_list_changed(true);
+    return true;
+}
+
+/* Get the text of a line for the sort. */
+static const char* _feeder_sort_text(size_t id, size_t* len)
+{
+    *len = _feeder_lines[id].len;
+    return _feeder_lines[id].line;
+}
+
+/* The rank of the lines of the sort being run, until it is published. */
+static size_t* _feeder_sort_rank;
+
+/* Display the first lines of a sort before its end, the other lines following
+ * them in the order they were read.
+ */
+static void _feeder_sort_first(size_t* order, size_t nb)
+{
+    size_t id, pos;
+
+    for(id = 0; id < _feeder_nb; ++id)
+        _feeder_sort_rank[id] = _feeder_nb;
+    for(pos = 0; pos < nb; ++pos)
+        _feeder_sort_rank[order[pos]] = pos;
+    for(id = 0; id < _feeder_nb; ++id) {
+        if(_feeder_sort_rank[id] == _feeder_nb) {
+            order[pos] = id;
+            _feeder_sort_rank[id] = pos++;
+        }
+    }
+
+    _feeder_unsort();
+    _feeder_order = order;
+    _feeder_rank  = _feeder_sort_rank;
+    curses_list_changed(true);
+    render_input();
+    render_frame();
+}
+
+bool feeder_sort(const char* spec)
+{
+    sort_t* s;
+    size_t* norder;
+    size_t* nrank;
+    size_t i;
+
+    if(spec && strcmp(spec, "off") == 0) {
+        _feeder_unsort();
+        curses_list_changed(true);
+        return true;
+    }
+
+    s = sort_parse(spec);
+    if(!s)
+        return false;
+    norder = malloc(sizeof(size_t) * _feeder_capa);
+    nrank  = malloc(sizeof(size_t) * _feeder_capa);
+    _feeder_sort_rank = nrank;
+    sort_set_first(s, curses_list_height(), &_feeder_sort_first);
+    if(!norder || !nrank || !sort_run(s, _feeder_nb, &_feeder_sort_text,
+                norder)) {
+        /* The first lines may be displayed in the arrays freed. */
+        if(_feeder_order && _feeder_order == norder) {
+            _feeder_order = NULL;
+            _feeder_rank  = NULL;
+            _feeder_unsort();
+            curses_list_changed(true);
+        }
+        free(norder);
+        free(nrank);
+        sort_destroy(s);
+        return false;
+    }
+    sort_destroy(s);
+
+    /* The first lines may already be displayed, in the same arrays. */
+    if(_feeder_order == norder) {
+        _feeder_order = NULL;
+        _feeder_rank  = NULL;
+    }
+    for(i = 0; i < _feeder_nb; ++i)
+        nrank[norder[i]] = i;
+    _feeder_unsort();
+    _feeder_order = norder;
+    _feeder_rank  = nrank;
+    curses_list_changed(true);
+    return true;
+}
+
+/* Get the name of a line for the sort, from its id since
+ * _feeder_byname_from.
+ */
+static const char* _feeder_name_text(size_t id, size_t* len)
+{
+    id  += _feeder_byname_from;
+    *len = strlen(_feeder_lines[id].id);
+    return _feeder_lines[id].id;
+}
+
+/* Sort the lines read since the last time by name, and merge them with the
+ * lines already sorted.
+ */
+static bool _feeder_byname_update()
+{
+    sort_t* s;
+    size_t* added;
+    size_t* nbyname;
+    size_t nb, i, j, k;
+
+    if(_feeder_byname && _feeder_byname_nb == _feeder_nb)
+        return true;
+
+    nb = _feeder_nb - _feeder_byname_nb;
+    s  = sort_parse("0");
+    if(!s)
+        return false;
+    added = malloc(sizeof(size_t) * (nb ? nb : 1));
+    _feeder_byname_from = _feeder_byname_nb;
+    if(!added || !sort_run(s, nb, &_feeder_name_text, added)) {
+        free(added);
+        sort_destroy(s);
+        return false;
+    }
+    sort_destroy(s);
+
+    nbyname = realloc(_feeder_byname,
+            sizeof(size_t) * (_feeder_nb ? _feeder_nb : 1));
+    if(!nbyname) {
+        free(added);
+        return false;
+    }
+    _feeder_byname = nbyname;
+    nbyname = realloc(_feeder_byname_rank,
+            sizeof(size_t) * (_feeder_nb ? _feeder_nb : 1));
+    if(!nbyname) {
+        free(added);
+        return false;
+    }
+    _feeder_byname_rank = nbyname;
+
+    /* The merge is done from the end, the lines read first staying first
+     * among the equal names.
+     */
+    i = _feeder_byname_nb;
+    j = nb;
+    k = _feeder_nb;
+    while(j > 0) {
+        if(i > 0 && strcmp(_feeder_lines[_feeder_byname[i - 1]].id,
+                    _feeder_lines[added[j - 1] + _feeder_byname_from].id) > 0)
+            _feeder_byname[--k] = _feeder_byname[--i];
+        else
+            _feeder_byname[--k] = added[--j] + _feeder_byname_from;
+    }
+    free(added);
+
+    /* The indexes of the lines after the first one merged have moved. */
+    for(; k < _feeder_nb; ++k)
+        _feeder_byname_rank[_feeder_byname[k]] = k;
+    _feeder_byname_nb   = _feeder_nb;
+    _feeder_bypos_valid = false;
+    return true;
+}
+
+size_t feeder_prefix(const char* prefix, size_t* first)
+{
+    size_t len, beg, end, mid;
+
+    *first = 0;
+    if(!_feeder_byname_update())
+        return 0;
+    len = strlen(prefix);
+
+    /* The first name not before the prefix. */
+    beg = 0;
+    end = _feeder_byname_nb;
+    while(beg < end) {
+        mid = beg + (end - beg) / 2;
+        if(strcmp(_feeder_lines[_feeder_byname[mid]].id, prefix) < 0)
+            beg = mid + 1;
+        else
+            end = mid;
+    }
+    *first = beg;
+
+    /* The first name after the ones starting with the prefix. */
+    end = _feeder_byname_nb;
+    while(beg < end) {
+        mid = beg + (end - beg) / 2;
+        if(strncmp(_feeder_lines[_feeder_byname[mid]].id, prefix, len) == 0)
+            beg = mid + 1;
+        else
+            end = mid;
+    }
+    return beg - *first;
+}
+
+const char* feeder_prefix_name(size_t i)
+{
+    if(!_feeder_byname || i >= _feeder_byname_nb)
+        return NULL;
+    return _feeder_lines[_feeder_byname[i]].id;
+}
+
+/* Build the tree of the display positions if lines were added or the display
+ * changed as a whole.
+ */
+static bool _feeder_bypos_update()
+{
+    size_t* nbypos;
+    size_t nb, i, id;
+
+    if(!_feeder_byname_update())
+        return false;
+    nb = _feeder_byname_nb;
+    if(_feeder_bypos_valid && _feeder_bypos_nb == nb)
+        return true;
+
+    if(_feeder_bypos_nb != nb || !_feeder_bypos) {
+        nbypos = realloc(_feeder_bypos, sizeof(size_t) * 2 * (nb ? nb : 1));
+        if(!nbypos)
+            return false;
+        _feeder_bypos    = nbypos;
+        _feeder_bypos_nb = nb;
+    }
+
+    for(i = 0; i < nb; ++i) {
+        id = _feeder_byname[i];
+        _feeder_bypos[nb + i] = (_feeder_visible(id) ? _feeder_pos(id)
+                : _feeder_nb);
+    }
+    for(i = nb - 1; i > 0 && i < nb; --i) {
+        _feeder_bypos[i] = (_feeder_bypos[2 * i] < _feeder_bypos[2 * i + 1]
+                ? _feeder_bypos[2 * i] : _feeder_bypos[2 * i + 1]);
+    }
+    _feeder_bypos_valid = true;
+    return true;
+}
+
+feeder_iterator_t feeder_find_prefix(const char* prefix)
+{
+    size_t first, nb, beg, end, pos;
+
+    nb = feeder_prefix(prefix, &first);
+    if(nb == 0 || !_feeder_bypos_update())
+        return feeder_end();
+
+    /* The smallest position in the range of the names, going up the tree. */
+    pos = _feeder_nb;
+    beg = first + _feeder_bypos_nb;
+    end = first + nb + _feeder_bypos_nb;
+    for(; beg < end; beg /= 2, end /= 2) {
+        if(beg & 1) {
+            if(_feeder_bypos[beg] < pos)
+                pos = _feeder_bypos[beg];
+            ++beg;
+        }
+        if(end & 1) {
+            --end;
+            if(_feeder_bypos[end] < pos)
+                pos = _feeder_bypos[end];
+        }
+    }
+
+    if(pos >= _feeder_nb)
+        return feeder_end();
+    return feeder_at_id(_feeder_id(pos));
+}
+
+/* Apply a mode to the marks of a word of lines : only the bits in mask
+ * change.
+ */
+static void _feeder_mark_word(int mode, size_t w, uint64_t mask)
+{
+    uint64_t old = _feeder_marks[w];
+
+    if(mode == FEEDER_MARK_ON)
+        _feeder_marks[w] |= mask;
+    else if(mode == FEEDER_MARK_OFF)
+        _feeder_marks[w] &= ~mask;
+    else
+        _feeder_marks[w] ^= mask;
+    _feeder_marked += __builtin_popcountll(_feeder_marks[w]);
+    _feeder_marked -= __builtin_popcountll(old);
+}
+
+void feeder_mark(int mode, size_t id1, size_t id2)
+{
+    size_t w;
+    uint64_t mask;
+    if(id1 > id2
+            || id1 >= _feeder_nb)
+        return;
+    /* The range stops at the last line. */
+    if(id2 >= _feeder_nb)
+        id2 = _feeder_nb - 1;
+
+    for(w = id1 / 64; w <= id2 / 64; ++w) {
+        mask = ~(uint64_t)0;
+        if(w == id1 / 64)
+            mask &= ~(uint64_t)0 << (id1 % 64);
+        if(w == id2 / 64)
+            mask &= ~(uint64_t)0 >> (63 - id2 % 64);
+        _feeder_mark_word(mode, w, mask);
+    }
+    curses_list_redraw();
+}
+
+void feeder_mark_shown(int mode)
+{
+    size_t w;
+
+    /* The bits of the displayed lines are the mask of their words. */
+    for(w = 0; w < FEEDER_WORDS(_feeder_nb); ++w)
+        _feeder_mark_word(mode, w, _feeder_vis[w]);
+    curses_list_redraw();
+}
+
+bool feeder_get_it_marked(feeder_iterator_t it)
+{
+    if(!it.valid)
+        return false;
+    return _feeder_marks[it.id / 64] & ((uint64_t)1 << (it.id % 64));
+}
+
+size_t feeder_marked()
+{
+    return _feeder_marked;
+}
+
+size_t feeder_marked_next(size_t id)
+{
+    size_t w;
+    uint64_t bits;
+    if(id >= _feeder_nb)
+        return _feeder_nb;
+
+    /* The words without marks are skipped at once. */
+    w    = id / 64;
+    bits = _feeder_marks[w] & (~(uint64_t)0 << (id % 64));
+    while(bits == 0) {
+        if(++w >= FEEDER_WORDS(_feeder_nb))
+            return _feeder_nb;
+        bits = _feeder_marks[w];
+    }
+    return w * 64 + __builtin_ctzll(bits);
+}
+
+const char* feeder_get_name(size_t id)
+{
+    if(id >= _feeder_nb)
+        return NULL;
+    return _feeder_lines[id].id;
 }
 
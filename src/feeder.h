@@ -4,12 +4,15 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include "ansi.h"
 
 /* This iterator allows going from one line to another one. */
 typedef struct _feeder_iterator_t {
     /* The id of the line it is refering to. */
     size_t id;
-    /* The virtual id of the line it is refering to (same as id for now). */
+    /* The position of the line in the display order. */
+    size_t pos;
+    /* The index of the line among the displayed ones. */
     size_t vid;
     /* Is the iterator valid. */
     bool valid;
@@ -22,6 +25,15 @@ void feeder_quit();
 /* Set the feeding command : clear any previous content. */
 bool feeder_set(const char* command);
 
+/* What is done with a line which name has already been read. */
+#define FEEDER_UNIQUE_NONE  0 /* It is added as another line. */
+#define FEEDER_UNIQUE_FIRST 1 /* It is dropped. */
+#define FEEDER_UNIQUE_LAST  2 /* Its text replaces the one of the first line,
+                               * which keeps its position.
+                               */
+/* Set the handling of the duplicated names for the next feeding command. */
+void feeder_set_unique(int mode);
+
 /* Get the fd to watch. */
 int feeder_fd();
 
@@ -38,6 +50,12 @@ feeder_iterator_t feeder_begin();
  */
 feeder_iterator_t feeder_end();
 
+/* Get the iterator to the line with a specific id or, if it is not displayed,
+ * to the next displayed line in the display order. It is invalid if there is
+ * no such line.
+ */
+feeder_iterator_t feeder_at_id(size_t id);
+
 /* Increment the iterator n times. If it goes after the end, it will be set
  * invalid.
  */
@@ -53,17 +71,86 @@ feeder_iterator_t feeder_prev(feeder_iterator_t* it, size_t n);
  */
 const char* feeder_get_it_text(feeder_iterator_t it);
 
+/* Get the length of the text of the line pointed by an iterator. Returns 0 if
+ * it is invalid.
+ */
+size_t feeder_get_it_length(feeder_iterator_t it);
+
+/* Get the attribute runs of the text of the line pointed by an iterator, and
+ * store their number in nb. Returns NULL if there is none.
+ */
+const ansi_run_t* feeder_get_it_runs(feeder_iterator_t it, size_t* nb);
+
 /* Get the name of the line pointed by an iterator. Returns NULL if it is
  * invalid.
  */
 const char* feeder_get_it_name(feeder_iterator_t it);
 
-/* Compare two iterators. The semantics are the same as strcmp. */
+/* Compare the positions of two iterators. The semantics are the same as
+ * strcmp.
+ */
 int feeder_it_cmp(feeder_iterator_t it1, feeder_iterator_t it2);
 
 /* Hide/unhide lines in [id1,id2]. */
 void feeder_hide(bool hide, size_t id1, size_t id2);
 void feeder_hide_toggle(size_t id1, size_t id2);
 
+/* Only display the lines matching an expression (see filter.h for the
+ * syntax). If expr is NULL, all the lines are displayed again. Returns false
+ * if the expression is invalid.
+ */
+bool feeder_filter(const char* expr);
+
+/* Sort the lines (see sort.h for the syntax of spec). Only the display order
+ * changes : the ids of the lines stay the same, and the lines read afterward
+ * are displayed at the end. If spec is "off", the lines are displayed in the
+ * order they were read again. Returns false if spec is invalid.
+ */
+bool feeder_sort(const char* spec);
+
+/* The ways the marks of the lines can be changed. */
+#define FEEDER_MARK_OFF    0
+#define FEEDER_MARK_ON     1
+#define FEEDER_MARK_TOGGLE 2
+/* Mark, unmark or toggle the marks of the lines in [id1,id2]. The range is
+ * cut at the last line.
+ */
+void feeder_mark(int mode, size_t id1, size_t id2);
+
+/* Mark, unmark or toggle the marks of the displayed lines. */
+void feeder_mark_shown(int mode);
+
+/* Indicates if the line pointed by an iterator is marked. */
+bool feeder_get_it_marked(feeder_iterator_t it);
+
+/* Get the number of marked lines. */
+size_t feeder_marked();
+
+/* Get the id of the first marked line from id, or the number of lines if there
+ * is none.
+ */
+size_t feeder_marked_next(size_t id);
+
+/* Get the name of the line with a specific id. Returns NULL if there is none.
+ */
+const char* feeder_get_name(size_t id);
+
+/* Get the range of the lines which name starts with prefix in the order of
+ * the names : the index of the first one is stored in first, and their number
+ * is returned. The hidden lines are included. The lines are sorted by name
+ * again when lines were read since the last call.
+ */
+size_t feeder_prefix(const char* prefix, size_t* first);
+
+/* Get the name of the line at index i in the order of the names, as given by
+ * feeder_prefix. Returns NULL if i is out of range.
+ */
+const char* feeder_prefix_name(size_t i);
+
+/* Get the iterator to the first displayed line which name starts with prefix.
+ * It is invalid if there is none.
+ */
+feeder_iterator_t feeder_find_prefix(const char* prefix);
+
 #endif
 
@@ -0,0 +1,379 @@
+#include "fields.h"
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <math.h>
+#include <wchar.h>
+
+/* A field of a line. */
+struct _fields_cell_t {
+    /* The offset of the field in the text. */
+    uint32_t off;
+    /* The length in bytes of the field. */
+    uint32_t len;
+    /* The display width of the field, capped to FIELDS_MAX_WIDTH. */
+    uint16_t width;
+};
+
+/* A column : the same field for all the lines. */
+struct _fields_column_t {
+    /* The fields of the lines, by line id. */
+    struct _fields_cell_t* cells;
+    /* The numeric values, by line id. NULL if they are not parsed. */
+    double* nums;
+    /* The number of displayed lines with each width. */
+    size_t widths[FIELDS_MAX_WIDTH + 1];
+    /* The greatest width with a non-zero count. */
+    size_t max;
+};
+
+/* The columns. */
+static struct _fields_column_t* _fields_cols;
+/* The number of declared fields. */
+static size_t _fields_nb;
+/* Are the numeric values parsed. */
+static bool   _fields_numeric;
+/* The number of indexed lines. */
+static size_t _fields_lines;
+/* Are the lines counted in the widths, by line id, and their number. */
+static bool*  _fields_shown;
+static size_t _fields_shown_nb;
+/* The size of the arrays of the columns. */
+static size_t _fields_capa;
+
+bool fields_init()
+{
+    _fields_cols     = NULL;
+    _fields_nb       = 0;
+    _fields_numeric  = false;
+    _fields_lines    = 0;
+    _fields_capa     = 0;
+    _fields_shown    = NULL;
+    _fields_shown_nb = 0;
+    return true;
+}
+
+/* Free the columns. */
+static void _fields_free()
+{
+    size_t i;
+    if(!_fields_cols)
+        return;
+    for(i = 0; i < _fields_nb; ++i) {
+        free(_fields_cols[i].cells);
+        if(_fields_cols[i].nums)
+            free(_fields_cols[i].nums);
+    }
+    free(_fields_cols);
+    free(_fields_shown);
+    _fields_cols  = NULL;
+    _fields_shown = NULL;
+}
+
+void fields_quit()
+{
+    _fields_free();
+}
+
+void fields_set(size_t nb, bool numeric)
+{
+    _fields_free();
+    _fields_nb       = nb;
+    _fields_numeric  = numeric;
+    _fields_lines    = 0;
+    _fields_capa     = 0;
+    _fields_shown_nb = 0;
+    if(nb == 0)
+        return;
+
+    _fields_cols = calloc(nb, sizeof(struct _fields_column_t));
+    if(!_fields_cols)
+        _fields_nb = 0;
+}
+
+void fields_clear()
+{
+    size_t i;
+    _fields_lines    = 0;
+    _fields_shown_nb = 0;
+    for(i = 0; i < _fields_nb; ++i) {
+        memset(_fields_cols[i].widths, 0, sizeof(_fields_cols[i].widths));
+        _fields_cols[i].max = 0;
+    }
+}
+
+size_t fields_nb()
+{
+    return _fields_nb;
+}
+
+bool fields_numeric()
+{
+    return _fields_numeric;
+}
+
+double fields_parse_num(const char* str, size_t len)
+{
+    const char* last = str + len;
+    char* end;
+    double d;
+
+    while(str < last && isspace(*str))
+        ++str;
+    if(str == last)
+        return NAN;
+
+    /* The field is either ended by a tab or by the end of the text, so
+     * strtod won't go past it.
+     */
+    d = strtod(str, &end);
+    if(end == str)
+        return NAN;
+    while(end < last && isspace(*end))
+        ++end;
+    return (end == last ? d : NAN);
+}
+
+/* Get the display width of a string, capped to FIELDS_MAX_WIDTH. */
+static size_t _fields_width(const char* str, size_t len)
+{
+    size_t i, l, width;
+    mbstate_t st;
+    wchar_t wc;
+    int w;
+
+    memset(&st, 0, sizeof(mbstate_t));
+    width = 0;
+    i = 0;
+    while(i < len && width < FIELDS_MAX_WIDTH) {
+        if(!(str[i] & 0x80)) {
+            ++width;
+            ++i;
+            continue;
+        }
+        l = mbrtowc(&wc, str + i, len - i, &st);
+        if(l == (size_t)-1 || l == (size_t)-2 || l == 0) {
+            memset(&st, 0, sizeof(mbstate_t));
+            ++width;
+            ++i;
+            continue;
+        }
+        w = wcwidth(wc);
+        width += (w > 0 ? w : 0);
+        i += l;
+    }
+    return (width < FIELDS_MAX_WIDTH ? width : FIELDS_MAX_WIDTH);
+}
+
+/* Make sure there is room for one more line in the columns. */
+static bool _fields_grow()
+{
+    struct _fields_cell_t* ncells;
+    double* nnums;
+    bool* nshown;
+    size_t ncapa, i;
+
+    if(_fields_lines < _fields_capa)
+        return true;
+
+    ncapa = (_fields_capa ? _fields_capa * 2 : 256);
+    nshown = realloc(_fields_shown, sizeof(bool) * ncapa);
+    if(!nshown)
+        return false;
+    _fields_shown = nshown;
+    for(i = 0; i < _fields_nb; ++i) {
+        ncells = realloc(_fields_cols[i].cells,
+                sizeof(struct _fields_cell_t) * ncapa);
+        if(!ncells)
+            return false;
+        _fields_cols[i].cells = ncells;
+
+        if(!_fields_numeric)
+            continue;
+        nnums = realloc(_fields_cols[i].nums, sizeof(double) * ncapa);
+        if(!nnums)
+            return false;
+        _fields_cols[i].nums = nnums;
+    }
+    _fields_capa = ncapa;
+    return true;
+}
+
+/* Index the fields of a text into the cells of the line id. */
+static void _fields_index(size_t id, const char* text, size_t len)
+{
+    struct _fields_column_t* col;
+    struct _fields_cell_t* cell;
+    const char* field;
+    const char* end;
+    const char* last = text + len;
+    size_t i;
+
+    field = text;
+    for(i = 0; i < _fields_nb; ++i) {
+        col  = &_fields_cols[i];
+        cell = &col->cells[id];
+        if(!field) {
+            cell->off   = len;
+            cell->len   = 0;
+            cell->width = 0;
+        } else {
+            end = memchr(field, '\t', last - field);
+            cell->off   = field - text;
+            cell->len   = (end ? end : last) - field;
+            cell->width = _fields_width(field, cell->len);
+            field = (end ? end + 1 : NULL);
+        }
+
+        if(col->nums)
+            col->nums[id] = fields_parse_num(text + cell->off, cell->len);
+    }
+}
+
+/* Add or remove the widths of the fields of a line to the histograms. */
+static void _fields_count(size_t id, bool add)
+{
+    struct _fields_column_t* col;
+    size_t i, w;
+
+    for(i = 0; i < _fields_nb; ++i) {
+        col = &_fields_cols[i];
+        w   = col->cells[id].width;
+        if(add) {
+            ++col->widths[w];
+            if(w > col->max)
+                col->max = w;
+        } else {
+            --col->widths[w];
+            while(col->max > 0 && col->widths[col->max] == 0)
+                --col->max;
+        }
+    }
+    _fields_shown[id] = add;
+    if(add)
+        ++_fields_shown_nb;
+    else
+        --_fields_shown_nb;
+}
+
+bool fields_add(size_t id, const char* text, size_t len)
+{
+    if(_fields_nb == 0 || id != _fields_lines)
+        return false;
+    if(!_fields_grow())
+        return false;
+
+    _fields_index(id, text, len);
+    _fields_count(id, true);
+    ++_fields_lines;
+    return true;
+}
+
+void fields_replace(size_t id, const char* text, size_t len)
+{
+    bool shown;
+
+    if(id >= _fields_lines)
+        return;
+
+    /* The previous widths are removed from the histograms. */
+    shown = _fields_shown[id];
+    if(shown)
+        _fields_count(id, false);
+    _fields_index(id, text, len);
+    if(shown)
+        _fields_count(id, true);
+}
+
+void fields_show(size_t id, bool shown)
+{
+    if(id < _fields_lines && _fields_shown[id] != shown)
+        _fields_count(id, shown);
+}
+
+bool fields_get(size_t id, size_t k, size_t* off, size_t* len)
+{
+    struct _fields_cell_t* cell;
+    if(k == 0 || k > _fields_nb || id >= _fields_lines)
+        return false;
+    cell = &_fields_cols[k - 1].cells[id];
+    *off = cell->off;
+    *len = cell->len;
+    return true;
+}
+
+void fields_split(const char* text, size_t len, size_t k,
+        size_t* off, size_t* flen)
+{
+    const char* field = text;
+    const char* last  = text + len;
+    const char* end;
+
+    *off  = 0;
+    *flen = len;
+    if(k == 0)
+        return;
+
+    for(; k > 1 && field; --k) {
+        field = memchr(field, '\t', last - field);
+        if(field)
+            ++field;
+    }
+    if(!field) {
+        *off  = len;
+        *flen = 0;
+        return;
+    }
+    end   = memchr(field, '\t', last - field);
+    *off  = field - text;
+    *flen = (end ? end : last) - field;
+}
+
+void fields_locate(size_t id, const char* text, size_t len, size_t k,
+        size_t* off, size_t* flen)
+{
+    if(!fields_get(id, k, off, flen))
+        fields_split(text, len, k, off, flen);
+}
+
+double fields_num(size_t id, size_t k)
+{
+    if(k == 0 || k > _fields_nb || id >= _fields_lines
+            || !_fields_cols[k - 1].nums)
+        return NAN;
+    return _fields_cols[k - 1].nums[id];
+}
+
+size_t fields_width(size_t id, size_t k)
+{
+    if(k == 0 || k > _fields_nb || id >= _fields_lines)
+        return 0;
+    return _fields_cols[k - 1].cells[id].width;
+}
+
+size_t fields_width_max(size_t k)
+{
+    if(k == 0 || k > _fields_nb)
+        return 0;
+    return _fields_cols[k - 1].max;
+}
+
+size_t fields_width_percentile(size_t k, unsigned int pct)
+{
+    struct _fields_column_t* col;
+    size_t w, count, target;
+
+    if(k == 0 || k > _fields_nb || _fields_shown_nb == 0)
+        return 0;
+    col = &_fields_cols[k - 1];
+
+    target = (_fields_shown_nb * pct + 99) / 100;
+    count  = 0;
+    for(w = 0; w < col->max; ++w) {
+        count += col->widths[w];
+        if(count >= target)
+            break;
+    }
+    return w;
+}
+
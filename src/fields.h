@@ -0,0 +1,90 @@
+#ifndef DEF_FIELDS
+#define DEF_FIELDS
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* The fields index is a side table of the feeder. When a feed declares that
+ * the text of its lines is made of tab-separated fields, the offsets of the
+ * fields (and optionally their numeric values) are recorded once when the
+ * lines are read, so that the field k of a line can be reached without
+ * splitting its text again. The fields are numbered from 1, like in the where
+ * command.
+ */
+
+/* Init and free the fields index. */
+bool fields_init();
+void fields_quit();
+
+/* Declare the number of fields of the next lines, and if their numeric values
+ * must be parsed. If nb is 0, the lines won't be indexed. It clears the index.
+ */
+void fields_set(size_t nb, bool numeric);
+
+/* Forget all the indexed lines, but keep the declaration. */
+void fields_clear();
+
+/* Get the number of declared fields. */
+size_t fields_nb();
+
+/* Indicates if the numeric values are parsed. */
+bool fields_numeric();
+
+/* Index the text of a line. The lines must be added in the order of their
+ * ids, starting from 0. Returns false if the allocation failed.
+ */
+bool fields_add(size_t id, const char* text, size_t len);
+
+/* Index again the text of a line which has been replaced. */
+void fields_replace(size_t id, const char* text, size_t len);
+
+/* Set if a line is displayed : only the displayed lines are counted in the
+ * widths of the columns. The lines are displayed when they are added.
+ */
+void fields_show(size_t id, bool shown);
+
+/* Get the offset and the length in the text of the field k of a line. Returns
+ * false if the line or the field aren't indexed.
+ */
+bool fields_get(size_t id, size_t k, size_t* off, size_t* len);
+
+/* Find the field k of a text without using the index. If k is 0, it is the
+ * whole text. The field is empty if the text has less than k fields.
+ */
+void fields_split(const char* text, size_t len, size_t k,
+        size_t* off, size_t* flen);
+
+/* Find the field k of the text of a line, using the index if possible. */
+void fields_locate(size_t id, const char* text, size_t len, size_t k,
+        size_t* off, size_t* flen);
+
+/* Get the numeric value of the field k of a line. Returns NAN if it is not a
+ * number, or if it hasn't been parsed.
+ */
+double fields_num(size_t id, size_t k);
+
+/* Get the width of the field k of a line. The widths are capped to
+ * FIELDS_MAX_WIDTH.
+ */
+#define FIELDS_MAX_WIDTH 1023
+size_t fields_width(size_t id, size_t k);
+
+/* Get the maximum width of the field k among the displayed lines. It is kept
+ * up to date with a histogram of the widths, so it is never computed again
+ * from the lines.
+ */
+size_t fields_width_max(size_t k);
+
+/* Get the width under which are pct percents of the field k of the displayed
+ * lines.
+ */
+size_t fields_width_percentile(size_t k, unsigned int pct);
+
+/* Parse the len bytes of str as a number. Spaces around it are ignored.
+ * Returns NAN if it is not a number. The number must be followed by a tab or
+ * the end of the string after the len bytes.
+ */
+double fields_parse_num(const char* str, size_t len);
+
+#endif
+
@@ -0,0 +1,893 @@
+#include "filter.h"
+#include "strmatch.h"
+#include "fields.h"
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <regex.h>
+
+/* The number of lines evaluated at once by the program. */
+#define FILTER_BATCH      256
+/* The maximum depth of the stack of the program. */
+#define FILTER_MAX_STACK  32
+/* The maximum number of fields that can be refered to. */
+#define FILTER_MAX_FIELDS 64
+
+/* The types of values handled by the program. FILTER_ANY is the type of a
+ * field, which can be both a string and a number.
+ */
+enum {
+    FILTER_NUM,
+    FILTER_STR,
+    FILTER_ANY
+};
+
+/* The instructions of the program. */
+enum {
+    /* Push a number, a string or a field. */
+    OP_NUM,
+    OP_STR,
+    OP_FIELD,
+    /* Arithmetic. */
+    OP_NEG,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    /* Comparison of the two values on top of the stack. */
+    OP_CMP,
+    /* Match the value on top of the stack against a pattern. */
+    OP_MATCH,
+    /* Logic. */
+    OP_NOT,
+    OP_AND,
+    OP_OR
+};
+
+/* The relations for OP_CMP. */
+enum {
+    REL_LT,
+    REL_LE,
+    REL_GT,
+    REL_GE,
+    REL_EQ,
+    REL_NE
+};
+
+/* An instruction. */
+struct _filter_ins_t {
+    /* The operation. */
+    unsigned char op;
+    /* The type of the operands for OP_FIELD and OP_CMP. */
+    unsigned char mode;
+    /* The relation for OP_CMP, or true if the match must fail for OP_MATCH. */
+    unsigned char rel;
+    /* The field for OP_FIELD, the index of the string for OP_STR or of the
+     * pattern for OP_MATCH.
+     */
+    size_t idx;
+    /* The number for OP_NUM. */
+    double num;
+};
+
+/* A pattern used by the ~ operator. Patterns without special characters are
+ * handled by strmatch, the others by the regex library.
+ */
+struct _filter_pattern_t {
+    enum {
+        PAT_SEARCH,
+        PAT_PREFIX,
+        PAT_SUFFIX,
+        PAT_EXACT,
+        PAT_REGEX
+    } type;
+    /* For PAT_SEARCH and PAT_PREFIX. */
+    strmatch_t* m;
+    /* For PAT_SUFFIX and PAT_EXACT. */
+    char* str;
+    size_t len;
+    /* For PAT_REGEX. */
+    regex_t re;
+};
+
+/* A compiled program. */
+struct _filter_prog_t {
+    struct _filter_ins_t* code;
+    size_t nb;
+    size_t capa;
+    /* The string literals. */
+    char** strs;
+    size_t nbstrs;
+    /* The patterns. */
+    struct _filter_pattern_t* pats;
+    size_t nbpats;
+};
+
+/* A value on the stack of the program. */
+struct _filter_val_t {
+    /* The string, or NULL if it is a number. It is not 0-terminated. */
+    const char* str;
+    size_t len;
+    /* The numeric value, NAN if it is not a number. */
+    double num;
+};
+
+/* The state of the parser. */
+struct _filter_parser_t {
+    /* What is left to parse. */
+    const char* str;
+    /* The program being compiled. */
+    struct _filter_prog_t* prog;
+    /* The depth of the stack at this point of the program. */
+    size_t depth;
+    /* Has an error been met. */
+    bool error;
+};
+
+/* A parsed sub-expression. */
+struct _filter_expr_t {
+    /* Its type. */
+    int type;
+    /* If the expression is only a field, the index of its OP_FIELD
+     * instruction, so that its mode can be set when it is used. -1 otherwise.
+     */
+    long field;
+};
+
+/* The program actually used. */
+static struct _filter_prog_t* _filter_prog;
+/* The numeric values of the fields, cached by line id. _filter_nums_nb[k] is
+ * the number of lines for which the field k has been parsed.
+ */
+static double* _filter_nums[FILTER_MAX_FIELDS];
+static size_t  _filter_nums_nb[FILTER_MAX_FIELDS];
+static size_t  _filter_nums_capa[FILTER_MAX_FIELDS];
+/* A buffer to 0-terminate the values matched by regexs. */
+static char*  _filter_scratch;
+static size_t _filter_scratch_capa;
+
+bool filter_init()
+{
+    size_t i;
+    _filter_prog = NULL;
+    for(i = 0; i < FILTER_MAX_FIELDS; ++i) {
+        _filter_nums[i]      = NULL;
+        _filter_nums_nb[i]   = 0;
+        _filter_nums_capa[i] = 0;
+    }
+    _filter_scratch      = NULL;
+    _filter_scratch_capa = 0;
+    return true;
+}
+
+/* Free a compiled program. */
+static void _filter_prog_destroy(struct _filter_prog_t* prog)
+{
+    size_t i;
+    if(!prog)
+        return;
+
+    for(i = 0; i < prog->nbstrs; ++i)
+        free(prog->strs[i]);
+    for(i = 0; i < prog->nbpats; ++i) {
+        if(prog->pats[i].type == PAT_REGEX)
+            regfree(&prog->pats[i].re);
+        if(prog->pats[i].m)
+            strmatch_destroy(prog->pats[i].m);
+        if(prog->pats[i].str)
+            free(prog->pats[i].str);
+    }
+    free(prog->strs);
+    free(prog->pats);
+    free(prog->code);
+    free(prog);
+}
+
+void filter_quit()
+{
+    _filter_prog_destroy(_filter_prog);
+    filter_clear();
+    if(_filter_scratch)
+        free(_filter_scratch);
+}
+
+void filter_clear()
+{
+    size_t i;
+    for(i = 0; i < FILTER_MAX_FIELDS; ++i) {
+        if(_filter_nums[i])
+            free(_filter_nums[i]);
+        _filter_nums[i]      = NULL;
+        _filter_nums_nb[i]   = 0;
+        _filter_nums_capa[i] = 0;
+    }
+}
+
+void filter_replace(size_t id, const char* text, size_t len)
+{
+    size_t i, off, flen;
+    for(i = 0; i < FILTER_MAX_FIELDS; ++i) {
+        if(id >= _filter_nums_nb[i])
+            continue;
+        fields_locate(id, text, len, i, &off, &flen);
+        _filter_nums[i][id] = fields_parse_num(text + off, flen);
+    }
+}
+
+bool filter_enabled()
+{
+    return _filter_prog != NULL;
+}
+
+/********************* Compilation *******************************************/
+/* Append an instruction to the program and update the depth of the stack.
+ * Returns the index of the instruction.
+ */
+static long _filter_emit(struct _filter_parser_t* p,
+        struct _filter_ins_t ins, int push)
+{
+    struct _filter_prog_t* prog = p->prog;
+    struct _filter_ins_t* ncode;
+
+    if(p->error)
+        return -1;
+    if(prog->nb >= prog->capa) {
+        ncode = realloc(prog->code,
+                sizeof(struct _filter_ins_t) * (prog->capa + 16));
+        if(!ncode) {
+            p->error = true;
+            return -1;
+        }
+        prog->code  = ncode;
+        prog->capa += 16;
+    }
+
+    p->depth += push;
+    if(p->depth > FILTER_MAX_STACK) {
+        p->error = true;
+        return -1;
+    }
+    prog->code[prog->nb] = ins;
+    return prog->nb++;
+}
+
+/* Emit an instruction without operands. */
+static void _filter_emit_op(struct _filter_parser_t* p, int op, int push)
+{
+    struct _filter_ins_t ins;
+    memset(&ins, 0, sizeof(struct _filter_ins_t));
+    ins.op = op;
+    _filter_emit(p, ins, push);
+}
+
+/* Use a sub-expression as a value of a specific type. Returns false if it
+ * can't be.
+ */
+static bool _filter_use(struct _filter_parser_t* p,
+        struct _filter_expr_t ex, int type)
+{
+    if(p->error)
+        return false;
+    if(ex.field >= 0)
+        p->prog->code[ex.field].mode = type;
+    else if(ex.type != type)
+        return false;
+    return true;
+}
+
+static void _filter_skip(struct _filter_parser_t* p)
+{
+    while(isspace(*p->str))
+        ++p->str;
+}
+
+/* Consume tok if it is the next token. */
+static bool _filter_accept(struct _filter_parser_t* p, const char* tok)
+{
+    _filter_skip(p);
+    if(strncmp(p->str, tok, strlen(tok)) != 0)
+        return false;
+    p->str += strlen(tok);
+    return true;
+}
+
+/* Parse a string literal. Returns it as a new string, or NULL. */
+static char* _filter_parse_string(struct _filter_parser_t* p)
+{
+    char* ret;
+    size_t i;
+
+    _filter_skip(p);
+    if(*p->str != '"')
+        return NULL;
+    ++p->str;
+
+    ret = malloc(strlen(p->str) + 1);
+    if(!ret)
+        return NULL;
+    for(i = 0; *p->str && *p->str != '"'; ++p->str) {
+        if(*p->str == '\\' && (p->str[1] == '"' || p->str[1] == '\\'))
+            ++p->str;
+        ret[i++] = *p->str;
+    }
+    ret[i] = '\0';
+
+    if(*p->str != '"') {
+        free(ret);
+        return NULL;
+    }
+    ++p->str;
+    return ret;
+}
+
+/* Add a string literal to the program. Returns its index. */
+static size_t _filter_add_string(struct _filter_parser_t* p, char* str)
+{
+    struct _filter_prog_t* prog = p->prog;
+    char** nstrs;
+
+    nstrs = realloc(prog->strs, sizeof(char*) * (prog->nbstrs + 1));
+    if(!nstrs) {
+        free(str);
+        p->error = true;
+        return 0;
+    }
+    prog->strs = nstrs;
+    prog->strs[prog->nbstrs] = str;
+    return prog->nbstrs++;
+}
+
+/* Indicates if a pattern doesn't need the regex library. */
+static bool _filter_plain(const char* str, size_t len)
+{
+    size_t i;
+    for(i = 0; i < len; ++i) {
+        if(strchr(".[]()*+?{}|\\^$", str[i]))
+            return false;
+    }
+    return true;
+}
+
+/* Compile a pattern and add it to the program. Returns its index. str is
+ * consumed.
+ */
+static size_t _filter_add_pattern(struct _filter_parser_t* p, char* str)
+{
+    struct _filter_prog_t* prog = p->prog;
+    struct _filter_pattern_t pat;
+    struct _filter_pattern_t* npats;
+    const char* body;
+    size_t len;
+    bool start, end;
+
+    memset(&pat, 0, sizeof(struct _filter_pattern_t));
+    len   = strlen(str);
+    start = (len > 0 && str[0] == '^');
+    end   = (len > (start ? 1 : 0) && str[len - 1] == '$'
+            && (len < 2 || str[len - 2] != '\\'));
+    body  = str + (start ? 1 : 0);
+    len  -= (start ? 1 : 0) + (end ? 1 : 0);
+
+    if(!_filter_plain(body, len)) {
+        pat.type = PAT_REGEX;
+        if(regcomp(&pat.re, str, REG_EXTENDED | REG_NOSUB) != 0) {
+            free(str);
+            p->error = true;
+            return 0;
+        }
+    } else if(start && end) {
+        pat.type = PAT_EXACT;
+        pat.str  = strndup(body, len);
+        pat.len  = len;
+    } else if(end) {
+        pat.type = PAT_SUFFIX;
+        pat.str  = strndup(body, len);
+        pat.len  = len;
+    } else {
+        pat.type = (start ? PAT_PREFIX : PAT_SEARCH);
+        str[len + (start ? 1 : 0)] = '\0';
+        pat.m    = strmatch_compile(body, 0);
+    }
+    free(str);
+
+    npats = realloc(prog->pats,
+            sizeof(struct _filter_pattern_t) * (prog->nbpats + 1));
+    if(!npats || (pat.type != PAT_REGEX && !pat.str && !pat.m)) {
+        if(pat.type == PAT_REGEX)
+            regfree(&pat.re);
+        p->error = true;
+        return 0;
+    }
+    prog->pats = npats;
+    prog->pats[prog->nbpats] = pat;
+    return prog->nbpats++;
+}
+
+static struct _filter_expr_t _filter_parse_or(struct _filter_parser_t* p);
+
+static struct _filter_expr_t _filter_parse_primary(struct _filter_parser_t* p)
+{
+    struct _filter_expr_t ex;
+    struct _filter_ins_t ins;
+    char* str;
+    char* end;
+
+    ex.type  = FILTER_NUM;
+    ex.field = -1;
+    memset(&ins, 0, sizeof(struct _filter_ins_t));
+    _filter_skip(p);
+
+    if(_filter_accept(p, "(")) {
+        ex = _filter_parse_or(p);
+        if(!_filter_accept(p, ")"))
+            p->error = true;
+    } else if(_filter_accept(p, "$")) {
+        ins.op   = OP_FIELD;
+        ins.mode = FILTER_ANY;
+        ins.idx  = strtoul(p->str, &end, 10);
+        if(end == p->str || ins.idx >= FILTER_MAX_FIELDS)
+            p->error = true;
+        p->str   = end;
+        ex.type  = FILTER_ANY;
+        ex.field = _filter_emit(p, ins, 1);
+    } else if(*p->str == '"') {
+        str = _filter_parse_string(p);
+        if(!str)
+            p->error = true;
+        else {
+            ins.op  = OP_STR;
+            ins.idx = _filter_add_string(p, str);
+            _filter_emit(p, ins, 1);
+        }
+        ex.type = FILTER_STR;
+    } else if(isdigit(*p->str) || *p->str == '.') {
+        ins.op  = OP_NUM;
+        ins.num = strtod(p->str, &end);
+        if(end == p->str)
+            p->error = true;
+        p->str  = end;
+        _filter_emit(p, ins, 1);
+    } else
+        p->error = true;
+
+    return ex;
+}
+
+static struct _filter_expr_t _filter_parse_unary(struct _filter_parser_t* p)
+{
+    struct _filter_expr_t ex;
+    if(!_filter_accept(p, "-"))
+        return _filter_parse_primary(p);
+
+    ex = _filter_parse_unary(p);
+    if(!_filter_use(p, ex, FILTER_NUM))
+        p->error = true;
+    _filter_emit_op(p, OP_NEG, 0);
+    ex.type  = FILTER_NUM;
+    ex.field = -1;
+    return ex;
+}
+
+/* Parse a chain of binary arithmetic operators. ops are the tokens and codes
+ * their instructions.
+ */
+static struct _filter_expr_t _filter_parse_arith(struct _filter_parser_t* p,
+        struct _filter_expr_t (*sub)(struct _filter_parser_t*),
+        const char* ops[2], const int codes[2])
+{
+    struct _filter_expr_t ex, rhs;
+    size_t i;
+
+    ex = sub(p);
+    while(!p->error) {
+        for(i = 0; i < 2; ++i) {
+            if(_filter_accept(p, ops[i]))
+                break;
+        }
+        if(i == 2)
+            break;
+        rhs = sub(p);
+        if(!_filter_use(p, ex, FILTER_NUM) || !_filter_use(p, rhs, FILTER_NUM))
+            p->error = true;
+        _filter_emit_op(p, codes[i], -1);
+        ex.type  = FILTER_NUM;
+        ex.field = -1;
+    }
+    return ex;
+}
+
+static struct _filter_expr_t _filter_parse_prod(struct _filter_parser_t* p)
+{
+    const char* ops[2]  = { "*", "/" };
+    const int codes[2]  = { OP_MUL, OP_DIV };
+    return _filter_parse_arith(p, &_filter_parse_unary, ops, codes);
+}
+
+static struct _filter_expr_t _filter_parse_sum(struct _filter_parser_t* p)
+{
+    const char* ops[2]  = { "+", "-" };
+    const int codes[2]  = { OP_ADD, OP_SUB };
+    return _filter_parse_arith(p, &_filter_parse_prod, ops, codes);
+}
+
+static struct _filter_expr_t _filter_parse_cmp(struct _filter_parser_t* p)
+{
+    /* Longest tokens first. */
+    const char* ops[6] = { "<=", ">=", "==", "!=", "<", ">" };
+    const int rels[6]  = { REL_LE, REL_GE, REL_EQ, REL_NE, REL_LT, REL_GT };
+    struct _filter_expr_t ex, rhs;
+    struct _filter_ins_t ins;
+    bool negate;
+    char* str;
+    size_t i;
+
+    ex = _filter_parse_sum(p);
+    memset(&ins, 0, sizeof(struct _filter_ins_t));
+
+    negate = _filter_accept(p, "!~");
+    if(negate || _filter_accept(p, "~")) {
+        if(!_filter_use(p, ex, FILTER_STR))
+            p->error = true;
+        str = _filter_parse_string(p);
+        if(!str)
+            p->error = true;
+        else {
+            ins.op  = OP_MATCH;
+            ins.rel = negate;
+            ins.idx = _filter_add_pattern(p, str);
+            _filter_emit(p, ins, 0);
+        }
+        ex.type  = FILTER_NUM;
+        ex.field = -1;
+        return ex;
+    }
+
+    for(i = 0; i < 6; ++i) {
+        if(_filter_accept(p, ops[i]))
+            break;
+    }
+    if(i == 6)
+        return ex;
+
+    rhs = _filter_parse_sum(p);
+    if(ex.type == FILTER_ANY && rhs.type == FILTER_ANY)
+        ins.mode = FILTER_ANY;
+    else if(ex.type == FILTER_STR || rhs.type == FILTER_STR)
+        ins.mode = FILTER_STR;
+    else
+        ins.mode = FILTER_NUM;
+    if(!_filter_use(p, ex, ins.mode) || !_filter_use(p, rhs, ins.mode))
+        p->error = true;
+
+    ins.op  = OP_CMP;
+    ins.rel = rels[i];
+    _filter_emit(p, ins, -1);
+    ex.type  = FILTER_NUM;
+    ex.field = -1;
+    return ex;
+}
+
+static struct _filter_expr_t _filter_parse_not(struct _filter_parser_t* p)
+{
+    struct _filter_expr_t ex;
+    _filter_skip(p);
+    if(p->str[0] != '!' || p->str[1] == '=' || p->str[1] == '~')
+        return _filter_parse_cmp(p);
+
+    ++p->str;
+    ex = _filter_parse_not(p);
+    _filter_emit_op(p, OP_NOT, 0);
+    ex.type  = FILTER_NUM;
+    ex.field = -1;
+    return ex;
+}
+
+static struct _filter_expr_t _filter_parse_and(struct _filter_parser_t* p)
+{
+    struct _filter_expr_t ex;
+    ex = _filter_parse_not(p);
+    while(!p->error && _filter_accept(p, "&&")) {
+        _filter_parse_not(p);
+        _filter_emit_op(p, OP_AND, -1);
+        ex.type  = FILTER_NUM;
+        ex.field = -1;
+    }
+    return ex;
+}
+
+static struct _filter_expr_t _filter_parse_or(struct _filter_parser_t* p)
+{
+    struct _filter_expr_t ex;
+    ex = _filter_parse_and(p);
+    while(!p->error && _filter_accept(p, "||")) {
+        _filter_parse_and(p);
+        _filter_emit_op(p, OP_OR, -1);
+        ex.type  = FILTER_NUM;
+        ex.field = -1;
+    }
+    return ex;
+}
+
+bool filter_set(const char* expr)
+{
+    struct _filter_parser_t p;
+
+    if(!expr || strlen(expr) == 0) {
+        _filter_prog_destroy(_filter_prog);
+        _filter_prog = NULL;
+        return true;
+    }
+
+    p.prog = malloc(sizeof(struct _filter_prog_t));
+    if(!p.prog)
+        return false;
+    memset(p.prog, 0, sizeof(struct _filter_prog_t));
+    p.str   = expr;
+    p.depth = 0;
+    p.error = false;
+
+    _filter_parse_or(&p);
+    _filter_skip(&p);
+    if(p.error || *p.str != '\0') {
+        _filter_prog_destroy(p.prog);
+        return false;
+    }
+
+    _filter_prog_destroy(_filter_prog);
+    _filter_prog = p.prog;
+    return true;
+}
+
+/********************* Evaluation ********************************************/
+/* Get the numeric value of a field, using the cache. */
+static double _filter_field_num(size_t id, size_t field,
+        const char* str, size_t len)
+{
+    double* nnums;
+    size_t ncapa;
+    double d;
+
+    if(id < _filter_nums_nb[field])
+        return _filter_nums[field][id];
+
+    d = fields_parse_num(str, len);
+    if(id != _filter_nums_nb[field])
+        return d;
+
+    if(id >= _filter_nums_capa[field]) {
+        ncapa = (_filter_nums_capa[field] ? _filter_nums_capa[field] * 2 : 256);
+        nnums = realloc(_filter_nums[field], sizeof(double) * ncapa);
+        if(!nnums)
+            return d;
+        _filter_nums[field]      = nnums;
+        _filter_nums_capa[field] = ncapa;
+    }
+    _filter_nums[field][id] = d;
+    ++_filter_nums_nb[field];
+    return d;
+}
+
+static bool _filter_pattern_match(struct _filter_pattern_t* pat,
+        const char* str, size_t len)
+{
+    char* nscratch;
+
+    switch(pat->type) {
+        case PAT_SEARCH:
+            return strmatch_search(pat->m, str, len) != NULL;
+        case PAT_PREFIX:
+            return strmatch_prefix(pat->m, str, len);
+        case PAT_SUFFIX:
+            return len >= pat->len
+                && memcmp(str + len - pat->len, pat->str, pat->len) == 0;
+        case PAT_EXACT:
+            return len == pat->len && memcmp(str, pat->str, len) == 0;
+        default:
+            break;
+    }
+
+    if(len + 1 > _filter_scratch_capa) {
+        nscratch = realloc(_filter_scratch, len + 1);
+        if(!nscratch)
+            return false;
+        _filter_scratch      = nscratch;
+        _filter_scratch_capa = len + 1;
+    }
+    memcpy(_filter_scratch, str, len);
+    _filter_scratch[len] = '\0';
+    return regexec(&pat->re, _filter_scratch, 0, NULL, 0) == 0;
+}
+
+static bool _filter_truth(const struct _filter_val_t* val)
+{
+    if(val->str && isnan(val->num))
+        return val->len > 0;
+    return !isnan(val->num) && val->num != 0;
+}
+
+static int _filter_strcmp(const struct _filter_val_t* a,
+        const struct _filter_val_t* b)
+{
+    int cmp;
+    cmp = memcmp(a->str, b->str, (a->len < b->len ? a->len : b->len));
+    if(cmp != 0)
+        return cmp;
+    return (a->len > b->len) - (a->len < b->len);
+}
+
+static double _filter_compare(const struct _filter_ins_t* ins,
+        const struct _filter_val_t* a, const struct _filter_val_t* b)
+{
+    int cmp;
+    if(ins->mode == FILTER_STR
+            || (ins->mode == FILTER_ANY && (isnan(a->num) || isnan(b->num))))
+        cmp = _filter_strcmp(a, b);
+    else if(isnan(a->num) || isnan(b->num))
+        return 0;
+    else
+        cmp = (a->num > b->num) - (a->num < b->num);
+
+    switch(ins->rel) {
+        case REL_LT: return cmp <  0;
+        case REL_LE: return cmp <= 0;
+        case REL_GT: return cmp >  0;
+        case REL_GE: return cmp >= 0;
+        case REL_EQ: return cmp == 0;
+        default:     return cmp != 0;
+    }
+}
+
+/* Run the program over at most FILTER_BATCH lines. Each instruction is
+ * applied to all the lines before going to the next one.
+ */
+static void _filter_run(size_t id, size_t nb,
+        const char* const* texts, const size_t* lens, bool* out)
+{
+    static struct _filter_val_t stack[FILTER_MAX_STACK][FILTER_BATCH];
+    struct _filter_ins_t* ins;
+    struct _filter_val_t* a;
+    struct _filter_val_t* b;
+    size_t pc, sp, i;
+    size_t off, len;
+    bool indexed;
+
+    sp = 0;
+    for(pc = 0; pc < _filter_prog->nb; ++pc) {
+        ins = &_filter_prog->code[pc];
+        /* The top of the stack and the value under it. */
+        a = (sp > 0 ? stack[sp - 1] : NULL);
+        b = (sp > 1 ? stack[sp - 2] : NULL);
+
+        switch(ins->op) {
+            case OP_NUM:
+                a = stack[sp++];
+                for(i = 0; i < nb; ++i) {
+                    a[i].str = NULL;
+                    a[i].num = ins->num;
+                }
+                break;
+
+            case OP_STR:
+                a = stack[sp++];
+                for(i = 0; i < nb; ++i) {
+                    a[i].str = _filter_prog->strs[ins->idx];
+                    a[i].len = strlen(a[i].str);
+                    a[i].num = NAN;
+                }
+                break;
+
+            case OP_FIELD:
+                a = stack[sp++];
+                for(i = 0; i < nb; ++i) {
+                    /* Use the fields index if the field is declared. */
+                    indexed = fields_get(id + i, ins->idx, &off, &len);
+                    if(!indexed)
+                        fields_split(texts[i], lens[i], ins->idx, &off, &len);
+                    a[i].str = texts[i] + off;
+                    a[i].len = len;
+
+                    if(ins->mode == FILTER_STR)
+                        a[i].num = NAN;
+                    else if(indexed && fields_numeric())
+                        a[i].num = fields_num(id + i, ins->idx);
+                    else {
+                        a[i].num = _filter_field_num(id + i, ins->idx,
+                                a[i].str, a[i].len);
+                    }
+                    if(ins->mode == FILTER_NUM)
+                        a[i].str = NULL;
+                }
+                break;
+
+            case OP_NEG:
+                for(i = 0; i < nb; ++i)
+                    a[i].num = -a[i].num;
+                break;
+
+            case OP_ADD:
+                for(i = 0; i < nb; ++i)
+                    b[i].num += a[i].num;
+                --sp;
+                break;
+
+            case OP_SUB:
+                for(i = 0; i < nb; ++i)
+                    b[i].num -= a[i].num;
+                --sp;
+                break;
+
+            case OP_MUL:
+                for(i = 0; i < nb; ++i)
+                    b[i].num *= a[i].num;
+                --sp;
+                break;
+
+            case OP_DIV:
+                for(i = 0; i < nb; ++i)
+                    b[i].num /= a[i].num;
+                --sp;
+                break;
+
+            case OP_CMP:
+                for(i = 0; i < nb; ++i) {
+                    b[i].num = _filter_compare(ins, &b[i], &a[i]);
+                    b[i].str = NULL;
+                }
+                --sp;
+                break;
+
+            case OP_MATCH:
+                for(i = 0; i < nb; ++i) {
+                    a[i].num = (_filter_pattern_match(
+                                &_filter_prog->pats[ins->idx],
+                                a[i].str, a[i].len) != ins->rel);
+                    a[i].str = NULL;
+                }
+                break;
+
+            case OP_NOT:
+                for(i = 0; i < nb; ++i) {
+                    a[i].num = !_filter_truth(&a[i]);
+                    a[i].str = NULL;
+                }
+                break;
+
+            case OP_AND:
+                for(i = 0; i < nb; ++i) {
+                    b[i].num = _filter_truth(&b[i]) && _filter_truth(&a[i]);
+                    b[i].str = NULL;
+                }
+                --sp;
+                break;
+
+            case OP_OR:
+                for(i = 0; i < nb; ++i) {
+                    b[i].num = _filter_truth(&b[i]) || _filter_truth(&a[i]);
+                    b[i].str = NULL;
+                }
+                --sp;
+                break;
+        }
+    }
+
+    for(i = 0; i < nb; ++i)
+        out[i] = _filter_truth(&stack[0][i]);
+}
+
+void filter_eval(size_t id, size_t nb,
+        const char* const* texts, const size_t* lens, bool* out)
+{
+    size_t i, n;
+
+    if(!_filter_prog) {
+        for(i = 0; i < nb; ++i)
+            out[i] = true;
+        return;
+    }
+
+    for(i = 0; i < nb; i += FILTER_BATCH) {
+        n = (nb - i < FILTER_BATCH ? nb - i : FILTER_BATCH);
+        _filter_run(id + i, n, texts + i, lens + i, out + i);
+    }
+}
+
@@ -0,0 +1,49 @@
+#ifndef DEF_FILTER
+#define DEF_FILTER
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* The filter evaluates an expression over the tab-separated fields of the
+ * lines text. The syntax of the expressions is close to awk's :
+ *  - $0 is the whole text, $1 its first field, $2 the second ...
+ *  - numbers (42, -1.5) and strings ("err") literals.
+ *  - arithmetic operators : + - * /.
+ *  - comparisons : < <= > >= == !=. They are numeric if one of the operands
+ *    is a number, textual if one is a string. If both are fields, they are
+ *    numeric only if both fields are numbers.
+ *  - $k ~ "re" and $k !~ "re" : the field matches (doesn't match) the extended
+ *    regular expression re.
+ *  - logical operators : && || ! and parenthesis.
+ */
+
+/* Init and free the filter. */
+bool filter_init();
+void filter_quit();
+
+/* Set the expression to filter with. If expr is NULL or empty, the filter is
+ * disabled. Returns false if expr couldn't be compiled, in which case the
+ * previous filter is kept.
+ */
+bool filter_set(const char* expr);
+
+/* Indicates if there is a filter set. */
+bool filter_enabled();
+
+/* Evaluate the filter over the lines with ids in [id, id + nb). texts and
+ * lens are the texts of the lines and their lengths, and out will receive the
+ * result for each line. If there is no filter, all the lines match.
+ */
+void filter_eval(size_t id, size_t nb,
+        const char* const* texts, const size_t* lens, bool* out);
+
+/* Update what has been cached about a line which text has been replaced. */
+void filter_replace(size_t id, const char* text, size_t len);
+
+/* Forget what has been cached about the lines. Must be called when the lines
+ * are cleared.
+ */
+void filter_clear();
+
+#endif
+
@@ -12,6 +12,13 @@
 #include "feeder.h"
 #include "commands.h"
 #include "bars.h"
+#include "strmatch.h"
+#include "filter.h"
+#include "fields.h"
+#include "render.h"
+#include "widths.h"
+#include "wrap.h"
+#include "columns.h"
 
 static int _set_fds(fd_set* fds)
 {
@@ -33,12 +40,14 @@ int main(int argc, char *argv[])
     char cmd[4096];
     size_t i, size;
     fd_set fds;
+    struct timeval tv;
 
     if(argc < 2) {
         printf("Too few arguments.\n");
         return 1;
     }
     setlocale(LC_ALL, "");
+    strmatch_init();
 
     cmd[0] = '\0';
     size = 4095;
@@ -76,6 +85,31 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    if(!filter_init()) {
+        printf("Couldn't init filter.\n");
+        return 1;
+    }
+
+    if(!fields_init()) {
+        printf("Couldn't init fields.\n");
+        return 1;
+    }
+
+    if(!widths_init()) {
+        printf("Couldn't init widths.\n");
+        return 1;
+    }
+
+    if(!wrap_init()) {
+        printf("Couldn't init wrap.\n");
+        return 1;
+    }
+
+    if(!columns_init()) {
+        printf("Couldn't init columns.\n");
+        return 1;
+    }
+
     if(!feeder_init()) {
         printf("Couldn't init feeder.\n");
         return 1;
@@ -86,21 +120,43 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    curses_draw();
+    if(!render_init()) {
+        printf("Couldn't init render.\n");
+        return 1;
+    }
+
+    render_frame();
     while(cont) {
-        select(_set_fds(&fds), &fds, NULL, NULL, NULL);
-        if(FD_ISSET(0, &fds))
+        if(select(_set_fds(&fds), &fds, NULL, NULL, render_timeout(&tv)) < 0) {
+            /* Interrupted by a signal, like a resize of the terminal : the
+             * signals received until the next frame are handled together.
+             */
+            FD_ZERO(&fds);
+            render_mark();
+        }
+        if(FD_ISSET(0, &fds)) {
             events_process();
-        if(FD_ISSET(cmdlifo_fd(), &fds))
+            render_input();
+        }
+        if(FD_ISSET(cmdlifo_fd(), &fds)) {
             cmdlifo_update();
-        if(FD_ISSET(feeder_fd(), &fds))
+            render_mark();
+        }
+        if(feeder_fd() > 0 && FD_ISSET(feeder_fd(), &fds)) {
             feeder_update();
-        bars_update();
-        curses_draw();
+            render_mark();
+        }
+        render_frame();
     }
 
+    render_quit();
     events_quit();
     feeder_quit();
+    columns_quit();
+    wrap_quit();
+    widths_quit();
+    fields_quit();
+    filter_quit();
     cmdlifo_quit();
     cmdparser_quit();
     bars_quit();
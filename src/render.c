@@ -0,0 +1,118 @@
+
+#include "render.h"
+#include "bars.h"
+#include "curses.h"
+#include <time.h>
+
+/* The minimum time between two frames, in nanoseconds. 0 if there is no
+ * limit.
+ */
+static long long _render_interval;
+/* The time the last frame was drawn at, in nanoseconds. */
+static long long _render_last;
+/* Is there a change to draw. */
+static bool      _render_pending;
+/* Must the next frame be drawn at once. */
+static bool      _render_now;
+/* The number of holds on the frames. */
+static size_t    _render_held;
+/* The counters. */
+static size_t    _render_drawn;
+static size_t    _render_skipped;
+
+/* Get the current time in nanoseconds. */
+static long long _render_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+bool render_init()
+{
+    render_set_fps(RENDER_DEFAULT_FPS);
+    _render_last    = 0;
+    _render_pending = true;
+    _render_now     = true;
+    _render_held    = 0;
+    _render_drawn   = 0;
+    _render_skipped = 0;
+    return true;
+}
+
+void render_quit()
+{
+    /* Nothing to do. */
+}
+
+void render_set_fps(unsigned int fps)
+{
+    _render_interval = (fps ? 1000000000LL / fps : 0);
+}
+
+void render_mark()
+{
+    _render_pending = true;
+}
+
+void render_input()
+{
+    _render_pending = true;
+    _render_now     = true;
+}
+
+void render_hold()
+{
+    ++_render_held;
+}
+
+void render_release()
+{
+    if(_render_held > 0)
+        --_render_held;
+}
+
+struct timeval* render_timeout(struct timeval* tv)
+{
+    long long wait;
+    if(!_render_pending || _render_held > 0)
+        return NULL;
+
+    wait = (_render_now ? 0 : _render_last + _render_interval - _render_time());
+    if(wait < 0)
+        wait = 0;
+    tv->tv_sec  = wait / 1000000000LL;
+    tv->tv_usec = (wait % 1000000000LL) / 1000;
+    return tv;
+}
+
+void render_frame()
+{
+    long long now;
+    if(!_render_pending || _render_held > 0)
+        return;
+
+    now = _render_time();
+    if(!_render_now && now < _render_last + _render_interval) {
+        ++_render_skipped;
+        return;
+    }
+
+    bars_update();
+    curses_draw();
+    _render_last    = now;
+    _render_pending = false;
+    _render_now     = false;
+    ++_render_drawn;
+}
+
+size_t render_drawn()
+{
+    return _render_drawn;
+}
+
+size_t render_skipped()
+{
+    return _render_skipped;
+}
+
@@ -0,0 +1,55 @@
+
+#ifndef DEF_RENDER
+#define DEF_RENDER
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+/* The render scheduler decides when the screen is drawn. The changes only
+ * mark the screen as dirty, and it is drawn at most a fixed number of times
+ * per second, the changes which happen in between being drawn together. A
+ * frame is drawn at once after a user input, so that the interface stays
+ * responsive.
+ */
+
+/* The default maximum number of frames per second. */
+#define RENDER_DEFAULT_FPS 60
+
+/* Init and free the scheduler. */
+bool render_init();
+void render_quit();
+
+/* Set the maximum number of frames per second. 0 disables the limit. */
+void render_set_fps(unsigned int fps);
+
+/* Mark the screen as dirty. */
+void render_mark();
+
+/* Mark the screen as dirty after a user input : the next frame won't wait. */
+void render_input();
+
+/* Hold the frames : none is drawn until render_release has been called as
+ * many times as render_hold. The changes made in between are drawn together
+ * in the next frame.
+ */
+void render_hold();
+void render_release();
+
+/* Get the timeout to give to select so that a pending frame is drawn in time.
+ * Returns NULL if there is no pending frame, otherwise tv is filled and
+ * returned.
+ */
+struct timeval* render_timeout(struct timeval* tv);
+
+/* Draw the pending frame if it is due. */
+void render_frame();
+
+/* Get the number of frames drawn, and the number of times a frame has been
+ * delayed to be drawn with later changes.
+ */
+size_t render_drawn();
+size_t render_skipped();
+
+#endif
+
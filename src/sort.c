@@ -0,0 +1,660 @@
+#include "sort.h"
+#include "fields.h"
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/* The maximum number of keys of a sort. */
+#define SORT_MAX_KEYS    8
+/* The maximum number of threads used to sort. */
+#define SORT_MAX_THREADS 16
+/* The number of lines under which the sort isn't spread over threads. */
+#define SORT_PARALLEL    65536
+/* The length of the runs sorted by insertion before being merged. */
+#define SORT_RUN         16
+
+/* The ways of comparing keys. */
+enum {
+    SORT_TEXT,
+    SORT_NUMERIC,
+    SORT_NATURAL,
+    SORT_LOCALE
+};
+
+/* A string key. */
+struct _sort_str_t {
+    const char* str;
+    size_t len;
+};
+
+/* A key of the sort. */
+struct _sort_key_t {
+    /* How to compare the key. */
+    int type;
+    /* Is the order reversed. */
+    bool reverse;
+    /* The field used as key. */
+    size_t field;
+    /* The values of the key by line id, for the secondary keys. nums is used
+     * by SORT_NUMERIC keys, strs by the others.
+     */
+    double* nums;
+    struct _sort_str_t* strs;
+    /* The storage of the collation keys of a SORT_LOCALE key. */
+    char* arena;
+};
+
+struct _sort_t {
+    struct _sort_key_t keys[SORT_MAX_KEYS];
+    size_t nb;
+    /* The number of lines to give to first before the end of the sort. */
+    size_t nbfirst;
+    sort_first_t first;
+};
+
+/* The elements which are actually sorted : the primary key is copied in it
+ * so that most of the comparisons don't need to look elsewhere. The first
+ * bytes of a string key are copied too, as a big-endian number, so that the
+ * strings which differ early are compared without reading them.
+ */
+struct _sort_item_t {
+    union {
+        double num;
+        const char* str;
+    } key;
+    uint64_t prefix;
+    uint32_t len;
+    uint32_t id;
+};
+
+/* The work of a thread : sort items[begin, end) if mid is 0, or merge
+ * src[begin, mid) and src[mid, end) into dst.
+ */
+struct _sort_job_t {
+    const sort_t* s;
+    struct _sort_item_t* src;
+    struct _sort_item_t* dst;
+    size_t begin;
+    size_t mid;
+    size_t end;
+};
+
+/* The number of threads set by sort_set_threads, 0 for one by cpu. */
+static size_t _sort_threads = 0;
+
+/********************* Parsing ***********************************************/
+sort_t* sort_parse(const char* spec)
+{
+    sort_t* s;
+    struct _sort_key_t* key;
+    char* used;
+    char* keystr;
+    char* word;
+    char* end;
+    char* strtokbuf1;
+    char* strtokbuf2;
+
+    s = malloc(sizeof(sort_t));
+    if(!s)
+        return NULL;
+    memset(s, 0, sizeof(sort_t));
+    used = strdup(spec ? spec : "");
+    if(!used) {
+        free(s);
+        return NULL;
+    }
+
+    keystr = strtok_r(used, ",", &strtokbuf1);
+    while(keystr) {
+        if(s->nb >= SORT_MAX_KEYS)
+            goto error;
+        key = &s->keys[s->nb++];
+
+        word = strtok_r(keystr, " ", &strtokbuf2);
+        while(word) {
+            if(isdigit((unsigned char)word[0])) {
+                key->field = strtoul(word, &end, 10);
+                if(*end != '\0')
+                    goto error;
+            }
+            else if(strcmp(word, "numeric") == 0)
+                key->type = SORT_NUMERIC;
+            else if(strcmp(word, "natural") == 0)
+                key->type = SORT_NATURAL;
+            else if(strcmp(word, "locale") == 0)
+                key->type = SORT_LOCALE;
+            else if(strcmp(word, "reverse") == 0)
+                key->reverse = true;
+            else
+                goto error;
+            word = strtok_r(NULL, " ", &strtokbuf2);
+        }
+        keystr = strtok_r(NULL, ",", &strtokbuf1);
+    }
+
+    /* Without any key, the lines are sorted by their text. */
+    if(s->nb == 0)
+        s->nb = 1;
+    free(used);
+    return s;
+
+error:
+    free(used);
+    free(s);
+    return NULL;
+}
+
+/* Free the values computed for the keys. */
+static void _sort_free_keys(sort_t* s)
+{
+    size_t i;
+    for(i = 0; i < s->nb; ++i) {
+        if(s->keys[i].nums)
+            free(s->keys[i].nums);
+        if(s->keys[i].strs)
+            free(s->keys[i].strs);
+        if(s->keys[i].arena)
+            free(s->keys[i].arena);
+        s->keys[i].nums  = NULL;
+        s->keys[i].strs  = NULL;
+        s->keys[i].arena = NULL;
+    }
+}
+
+void sort_destroy(sort_t* s)
+{
+    if(!s)
+        return;
+    _sort_free_keys(s);
+    free(s);
+}
+
+void sort_set_threads(size_t nb)
+{
+    _sort_threads = nb;
+}
+
+void sort_set_first(sort_t* s, size_t nb, sort_first_t first)
+{
+    s->nbfirst = nb;
+    s->first   = first;
+}
+
+/********************* Keys **************************************************/
+/* Compute the collation keys of a field for all the lines. They are stored
+ * one after the other in the arena, and their offsets are replaced by
+ * pointers once the arena won't move anymore.
+ */
+static bool _sort_locale_keys(struct _sort_key_t* key, size_t nb,
+        sort_text_t text)
+{
+    size_t id, len, off, flen, used, capa, need;
+    const char* txt;
+    char* ncopy;
+    char* narena;
+    char* copy;
+    size_t copycapa;
+
+    used = 0;
+    capa = nb * 16 + 16;
+    key->arena = malloc(capa);
+    copycapa = 256;
+    copy = malloc(copycapa);
+    if(!key->arena || !copy) {
+        free(copy);
+        return false;
+    }
+
+    for(id = 0; id < nb; ++id) {
+        txt = text(id, &len);
+        fields_locate(id, txt, len, key->field, &off, &flen);
+
+        /* strxfrm needs a 0-terminated string. */
+        if(flen + 1 > copycapa) {
+            ncopy = realloc(copy, flen + 1);
+            if(!ncopy)
+                break;
+            copy     = ncopy;
+            copycapa = flen + 1;
+        }
+        memcpy(copy, txt + off, flen);
+        copy[flen] = '\0';
+
+        need = strxfrm(key->arena + used, copy, capa - used);
+        if(need >= capa - used) {
+            capa = (capa + need + 1) * 2;
+            narena = realloc(key->arena, capa);
+            if(!narena)
+                break;
+            key->arena = narena;
+            strxfrm(key->arena + used, copy, capa - used);
+        }
+        key->strs[id].str = (const char*)(uintptr_t)used;
+        key->strs[id].len = need;
+        used += need + 1;
+    }
+    free(copy);
+    if(id != nb)
+        return false;
+
+    for(id = 0; id < nb; ++id)
+        key->strs[id].str = key->arena + (uintptr_t)key->strs[id].str;
+    return true;
+}
+
+/* Compute the values of a key for all the lines. */
+static bool _sort_compute_key(struct _sort_key_t* key, size_t nb,
+        sort_text_t text)
+{
+    size_t id, len, off, flen;
+    const char* txt;
+
+    if(key->type == SORT_NUMERIC) {
+        key->nums = malloc(sizeof(double) * (nb ? nb : 1));
+        if(!key->nums)
+            return false;
+        for(id = 0; id < nb; ++id) {
+            txt = text(id, &len);
+            if(fields_numeric() && fields_get(id, key->field, &off, &flen))
+                key->nums[id] = fields_num(id, key->field);
+            else {
+                fields_locate(id, txt, len, key->field, &off, &flen);
+                key->nums[id] = fields_parse_num(txt + off, flen);
+            }
+        }
+        return true;
+    }
+
+    key->strs = malloc(sizeof(struct _sort_str_t) * (nb ? nb : 1));
+    if(!key->strs)
+        return false;
+    if(key->type == SORT_LOCALE)
+        return _sort_locale_keys(key, nb, text);
+
+    for(id = 0; id < nb; ++id) {
+        txt = text(id, &len);
+        fields_locate(id, txt, len, key->field, &off, &flen);
+        key->strs[id].str = txt + off;
+        key->strs[id].len = flen;
+    }
+    return true;
+}
+
+/********************* Comparison ********************************************/
+static int _sort_cmp_num(double a, double b)
+{
+    return (a > b) - (a < b);
+}
+
+static int _sort_cmp_text(const char* a, size_t la, const char* b, size_t lb)
+{
+    int cmp = memcmp(a, b, (la < lb ? la : lb));
+    if(cmp != 0)
+        return cmp;
+    return (la > lb) - (la < lb);
+}
+
+/* Compare two strings, the sequences of digits being compared by their
+ * numeric values.
+ */
+static int _sort_cmp_natural(const char* a, size_t la,
+        const char* b, size_t lb)
+{
+    size_t i, j, si, sj, ni, nj;
+    int cmp;
+
+    i = j = 0;
+    while(i < la && j < lb) {
+        if(!isdigit((unsigned char)a[i]) || !isdigit((unsigned char)b[j])) {
+            if(a[i] != b[j])
+                return (unsigned char)a[i] - (unsigned char)b[j];
+            ++i;
+            ++j;
+            continue;
+        }
+
+        /* Skip the leading zeros, then the longest number is the greatest. */
+        while(i < la && a[i] == '0')
+            ++i;
+        while(j < lb && b[j] == '0')
+            ++j;
+        for(si = i; i < la && isdigit((unsigned char)a[i]); ++i);
+        for(sj = j; j < lb && isdigit((unsigned char)b[j]); ++j);
+        ni = i - si;
+        nj = j - sj;
+        if(ni != nj)
+            return (ni > nj) - (ni < nj);
+        cmp = memcmp(a + si, b + sj, ni);
+        if(cmp != 0)
+            return cmp;
+    }
+    return (la - i > lb - j) - (la - i < lb - j);
+}
+
+/* Compare two lines for one key. */
+static int _sort_cmp_key(const struct _sort_key_t* key,
+        const char* sa, size_t la, double na,
+        const char* sb, size_t lb, double nb)
+{
+    int cmp;
+    /* The lines which aren't numbers are after the others, even reversed. */
+    if(key->type == SORT_NUMERIC && (isnan(na) || isnan(nb)))
+        return isnan(na) - isnan(nb);
+    if(key->type == SORT_NUMERIC)
+        cmp = _sort_cmp_num(na, nb);
+    else if(key->type == SORT_NATURAL)
+        cmp = _sort_cmp_natural(sa, la, sb, lb);
+    else
+        cmp = _sort_cmp_text(sa, la, sb, lb);
+    return (key->reverse ? -cmp : cmp);
+}
+
+static int _sort_cmp(const sort_t* s,
+        const struct _sort_item_t* a, const struct _sort_item_t* b)
+{
+    const struct _sort_key_t* key;
+    size_t i;
+    int cmp;
+
+    /* The prefixes of the natural keys aren't compared as bytes. */
+    if(a->prefix != b->prefix && s->keys[0].type != SORT_NATURAL) {
+        cmp = (a->prefix > b->prefix) - (a->prefix < b->prefix);
+        return (s->keys[0].reverse ? -cmp : cmp);
+    }
+    cmp = _sort_cmp_key(&s->keys[0], a->key.str, a->len, a->key.num,
+            b->key.str, b->len, b->key.num);
+    for(i = 1; cmp == 0 && i < s->nb; ++i) {
+        key = &s->keys[i];
+        if(key->type == SORT_NUMERIC)
+            cmp = _sort_cmp_key(key, NULL, 0, key->nums[a->id],
+                    NULL, 0, key->nums[b->id]);
+        else {
+            cmp = _sort_cmp_key(key,
+                    key->strs[a->id].str, key->strs[a->id].len, 0,
+                    key->strs[b->id].str, key->strs[b->id].len, 0);
+        }
+    }
+
+    /* Keep the order of the ids. */
+    if(cmp == 0)
+        cmp = (a->id > b->id) - (a->id < b->id);
+    return cmp;
+}
+
+/* Get the first bytes of a string as a big-endian number, padded with zeros :
+ * the numbers compare like the strings, unless they are equal.
+ */
+static uint64_t _sort_prefix(const char* str, size_t len)
+{
+    uint64_t prefix = 0;
+    size_t i;
+    for(i = 0; i < 8; ++i)
+        prefix = (prefix << 8) | (i < len ? (unsigned char)str[i] : 0);
+    return prefix;
+}
+
+/********************* Merge sort ********************************************/
+/* Merge two sorted arrays into dst. */
+static void _sort_merge(const sort_t* s,
+        const struct _sort_item_t* a, size_t na,
+        const struct _sort_item_t* b, size_t nb,
+        struct _sort_item_t* dst)
+{
+    size_t i, j, k;
+    i = j = k = 0;
+    while(i < na && j < nb) {
+        if(_sort_cmp(s, &b[j], &a[i]) < 0)
+            dst[k++] = b[j++];
+        else
+            dst[k++] = a[i++];
+    }
+    memcpy(dst + k, a + i, sizeof(struct _sort_item_t) * (na - i));
+    k += na - i;
+    memcpy(dst + k, b + j, sizeof(struct _sort_item_t) * (nb - j));
+}
+
+/* Move down the item at i of a heap of n items, where each item is greater
+ * than the ones under it.
+ */
+static void _sort_sift(const sort_t* s, struct _sort_item_t* heap,
+        size_t n, size_t i)
+{
+    struct _sort_item_t it = heap[i];
+    size_t child;
+
+    for(child = 2 * i + 1; child < n; child = 2 * i + 1) {
+        if(child + 1 < n && _sort_cmp(s, &heap[child], &heap[child + 1]) < 0)
+            ++child;
+        if(_sort_cmp(s, &it, &heap[child]) >= 0)
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = it;
+}
+
+/* Select the n smallest of nb items into heap, in order. */
+static void _sort_select(const sort_t* s, const struct _sort_item_t* items,
+        size_t nb, struct _sort_item_t* heap, size_t n)
+{
+    struct _sort_item_t it;
+    size_t i;
+
+    memcpy(heap, items, sizeof(struct _sort_item_t) * n);
+    for(i = n / 2; i > 0; --i)
+        _sort_sift(s, heap, n, i - 1);
+    for(i = n; i < nb; ++i) {
+        if(_sort_cmp(s, &items[i], &heap[0]) < 0) {
+            heap[0] = items[i];
+            _sort_sift(s, heap, n, 0);
+        }
+    }
+
+    /* The greatest one is moved to the end until the heap is empty. */
+    for(i = n; i > 1; --i) {
+        it          = heap[0];
+        heap[0]     = heap[i - 1];
+        heap[i - 1] = it;
+        _sort_sift(s, heap, i - 1, 0);
+    }
+}
+
+/* Sort n items, using tmp which must be as big as items. */
+static void _sort_sequential(const sort_t* s,
+        struct _sort_item_t* items, struct _sort_item_t* tmp, size_t n)
+{
+    struct _sort_item_t* src = items;
+    struct _sort_item_t* dst = tmp;
+    struct _sort_item_t* swp;
+    struct _sort_item_t it;
+    size_t i, j, width, mid, end;
+
+    /* Insertion sort of the small runs. */
+    for(i = 0; i < n; i += SORT_RUN) {
+        end = (i + SORT_RUN < n ? i + SORT_RUN : n);
+        for(j = i + 1; j < end; ++j) {
+            it = items[j];
+            for(mid = j; mid > i && _sort_cmp(s, &it, &items[mid - 1]) < 0;
+                    --mid)
+                items[mid] = items[mid - 1];
+            items[mid] = it;
+        }
+    }
+
+    /* Bottom-up merges, going back and forth between items and tmp. */
+    for(width = SORT_RUN; width < n; width *= 2) {
+        for(i = 0; i < n; i += 2 * width) {
+            mid = (i + width < n ? i + width : n);
+            end = (i + 2 * width < n ? i + 2 * width : n);
+            _sort_merge(s, src + i, mid - i, src + mid, end - mid, dst + i);
+        }
+        swp = src;
+        src = dst;
+        dst = swp;
+    }
+
+    if(src != items)
+        memcpy(items, src, sizeof(struct _sort_item_t) * n);
+}
+
+static void* _sort_thread(void* data)
+{
+    struct _sort_job_t* job = data;
+    if(job->mid == 0) {
+        _sort_sequential(job->s, job->src + job->begin,
+                job->dst + job->begin, job->end - job->begin);
+    } else {
+        _sort_merge(job->s, job->src + job->begin, job->mid - job->begin,
+                job->src + job->mid, job->end - job->mid,
+                job->dst + job->begin);
+    }
+    return NULL;
+}
+
+/* Run the jobs, in threads if there are several. */
+static void _sort_run_jobs(struct _sort_job_t* jobs, size_t nb)
+{
+    pthread_t threads[SORT_MAX_THREADS];
+    bool started[SORT_MAX_THREADS];
+    size_t i;
+
+    for(i = 1; i < nb; ++i)
+        started[i] = (pthread_create(&threads[i], NULL,
+                    &_sort_thread, &jobs[i]) == 0);
+    /* The first job is done by this thread. */
+    _sort_thread(&jobs[0]);
+    for(i = 1; i < nb; ++i) {
+        if(started[i])
+            pthread_join(threads[i], NULL);
+        else
+            _sort_thread(&jobs[i]);
+    }
+}
+
+/* Sort the items : each thread sorts a chunk, then the chunks are merged by
+ * pairs until there is only one left.
+ */
+static void _sort_parallel(const sort_t* s,
+        struct _sort_item_t* items, struct _sort_item_t* tmp, size_t n)
+{
+    struct _sort_job_t jobs[SORT_MAX_THREADS];
+    size_t bounds[SORT_MAX_THREADS + 1];
+    struct _sort_item_t* src = items;
+    struct _sort_item_t* dst = tmp;
+    struct _sort_item_t* swp;
+    size_t nbthreads, nbchunks, i, j;
+    long cpus;
+
+    cpus = (_sort_threads ? (long)_sort_threads
+            : sysconf(_SC_NPROCESSORS_ONLN));
+    nbthreads = (cpus > 1 ? (size_t)cpus : 1);
+    if(nbthreads > SORT_MAX_THREADS)
+        nbthreads = SORT_MAX_THREADS;
+    if(n < SORT_PARALLEL || nbthreads == 1) {
+        _sort_sequential(s, items, tmp, n);
+        return;
+    }
+
+    for(i = 0; i <= nbthreads; ++i)
+        bounds[i] = n * i / nbthreads;
+    for(i = 0; i < nbthreads; ++i) {
+        jobs[i].s     = s;
+        jobs[i].src   = items;
+        jobs[i].dst   = tmp;
+        jobs[i].begin = bounds[i];
+        jobs[i].mid   = 0;
+        jobs[i].end   = bounds[i + 1];
+    }
+    _sort_run_jobs(jobs, nbthreads);
+
+    for(nbchunks = nbthreads; nbchunks > 1; nbchunks = (nbchunks + 1) / 2) {
+        for(i = 0, j = 0; i + 1 < nbchunks; i += 2, ++j) {
+            jobs[j].s     = s;
+            jobs[j].src   = src;
+            jobs[j].dst   = dst;
+            jobs[j].begin = bounds[i];
+            jobs[j].mid   = bounds[i + 1];
+            jobs[j].end   = bounds[i + 2];
+        }
+        _sort_run_jobs(jobs, j);
+
+        /* An odd chunk is copied as is. */
+        if(i < nbchunks) {
+            memcpy(dst + bounds[i], src + bounds[i],
+                    sizeof(struct _sort_item_t) * (bounds[i + 1] - bounds[i]));
+        }
+        for(i = 0; 2 * i < nbchunks; ++i)
+            bounds[i] = bounds[2 * i];
+        bounds[i] = n;
+
+        swp = src;
+        src = dst;
+        dst = swp;
+    }
+
+    if(src != items)
+        memcpy(items, src, sizeof(struct _sort_item_t) * n);
+}
+
+bool sort_run(sort_t* s, size_t nb, sort_text_t text, size_t* order)
+{
+    struct _sort_item_t* items;
+    struct _sort_item_t* tmp;
+    struct _sort_key_t* key;
+    size_t i;
+
+    if(nb > UINT32_MAX)
+        return false;
+
+    for(i = 0; i < s->nb; ++i) {
+        if(!_sort_compute_key(&s->keys[i], nb, text)) {
+            _sort_free_keys(s);
+            return false;
+        }
+    }
+
+    items = malloc(sizeof(struct _sort_item_t) * (nb ? nb : 1));
+    tmp   = malloc(sizeof(struct _sort_item_t) * (nb ? nb : 1));
+    if(!items || !tmp) {
+        free(items);
+        free(tmp);
+        _sort_free_keys(s);
+        return false;
+    }
+
+    key = &s->keys[0];
+    for(i = 0; i < nb; ++i) {
+        items[i].id = i;
+        if(key->type == SORT_NUMERIC) {
+            items[i].key.num = key->nums[i];
+            items[i].len     = 0;
+            items[i].prefix  = 0;
+        } else {
+            items[i].key.str = key->strs[i].str;
+            items[i].len     = key->strs[i].len;
+            items[i].prefix  = _sort_prefix(key->strs[i].str,
+                    key->strs[i].len);
+        }
+    }
+
+    /* The first lines are selected in tmp, which isn't used yet. */
+    if(s->first && s->nbfirst > 0 && s->nbfirst < nb) {
+        _sort_select(s, items, nb, tmp, s->nbfirst);
+        for(i = 0; i < s->nbfirst; ++i)
+            order[i] = tmp[i].id;
+        s->first(order, s->nbfirst);
+    }
+
+    _sort_parallel(s, items, tmp, nb);
+    for(i = 0; i < nb; ++i)
+        order[i] = items[i].id;
+
+    free(items);
+    free(tmp);
+    _sort_free_keys(s);
+    return true;
+}
+
@@ -0,0 +1,54 @@
+#ifndef DEF_SORT
+#define DEF_SORT
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* A parsed sort specification. */
+struct _sort_t;
+typedef struct _sort_t sort_t;
+
+/* The function used by the sort to get the text of a line from its id. It must
+ * store the length of the text in len.
+ */
+typedef const char* (*sort_text_t)(size_t id, size_t* len);
+
+/* The function given the first nb ids of the order before the end of the
+ * sort.
+ */
+typedef void (*sort_first_t)(size_t* order, size_t nb);
+
+/* Parse a sort specification. It is a comma-separated list of keys, the first
+ * one being the most significant. Each key has the syntax
+ * 'field [numeric|natural|locale] [reverse]', where field is the number of the
+ * tab-separated field of the text to sort by (0 for the whole text, which is
+ * the default). Without any mode, the fields are compared byte by byte.
+ * Returns NULL if the specification is invalid.
+ */
+sort_t* sort_parse(const char* spec);
+
+/* Free a sort specification. */
+void sort_destroy(sort_t* s);
+
+/* Set the number of threads the sorts are spread over. 0, the default, uses
+ * one thread by cpu.
+ */
+void sort_set_threads(size_t nb);
+
+/* Make sort_run select the first nb lines of the order before sorting the
+ * others, and give them to first, so that they can be displayed early. They
+ * are stored at the beginning of the order given to sort_run, which can be
+ * used until the end of the sort, and the sort can't fail anymore once first
+ * is called. It isn't called if there are no more than nb lines.
+ */
+void sort_set_first(sort_t* s, size_t nb, sort_first_t first);
+
+/* Sort the ids of nb lines. order will receive the ids in sorted order. Lines
+ * which compare equal keep the order of their ids. The keys are computed once
+ * for each line, and the sort is spread over the available cpus. Returns
+ * false if the allocation failed.
+ */
+bool sort_run(sort_t* s, size_t nb, sort_text_t text, size_t* order);
+
+#endif
+
@@ -7,7 +7,8 @@
 #include <signal.h>
 #include <sys/wait.h>
 
-spawn_t spawn_create(char* const prog[])
+/* Spawn a program with its stdin read from input, if it isn't -1. */
+static spawn_t _spawn_create(char* const prog[], int input)
 {
     spawn_t sp;
     sp.process = -1;
@@ -28,6 +29,8 @@ spawn_t spawn_create(char* const prog[])
     if(sp.process == 0) {
         close(sp.pipe[0]);
         dup2(sp.pipe[1], 1); /* Connecting stdout to pipe. */
+        if(input >= 0)
+            dup2(input, 0);
         execvp(prog[0], prog);
         close(sp.pipe[1]);
         exit(EXIT_SUCCESS);
@@ -38,6 +41,11 @@ spawn_t spawn_create(char* const prog[])
     return sp;
 }
 
+spawn_t spawn_create(char* const prog[])
+{
+    return _spawn_create(prog, -1);
+}
+
 /* Get the value of the $SHELL environment variable or /bin/sh if $SHELL is not
  * setted.
  */
@@ -48,6 +56,11 @@ static const char* _spawn_get_shell()
 }
 
 spawn_t spawn_create_shell(const char* command)
+{
+    return spawn_create_shell_input(command, -1);
+}
+
+spawn_t spawn_create_shell_input(const char* command, int input)
 {
     char* argv[4];
     spawn_t sp;
@@ -56,20 +69,25 @@ spawn_t spawn_create_shell(const char* command)
     argv[1] = "-c";
     argv[2] = strdup(command);
     argv[3] = NULL;
-    sp = spawn_create(argv);
+    sp = _spawn_create(argv, input);
 
     free(argv[0]);
     free(argv[2]);
     return sp;
 }
 
-bool spawn_exec(char* const prog[])
+/* Spawn a program with its stdin read from input, if it isn't -1, and wait for
+ * it to end.
+ */
+static bool _spawn_exec(char* const prog[], int input)
 {
     pid_t pid = vfork();
 
     if(pid < 0)
         return false;
     else if(pid == 0) {
+        if(input >= 0)
+            dup2(input, 0);
         execv(prog[0], prog);
         exit(0);
     }
@@ -79,7 +97,17 @@ bool spawn_exec(char* const prog[])
     return true;
 }
 
+bool spawn_exec(char* const prog[])
+{
+    return _spawn_exec(prog, -1);
+}
+
 bool spawn_exec_shell(const char* command)
+{
+    return spawn_exec_shell_input(command, -1);
+}
+
+bool spawn_exec_shell_input(const char* command, int input)
 {
     bool ret;
     char* argv[4];
@@ -88,7 +116,7 @@ bool spawn_exec_shell(const char* command)
     argv[1] = "-c";
     argv[2] = strdup(command);
     argv[3] = NULL;
-    ret = spawn_exec(argv);
+    ret = _spawn_exec(argv, input);
 
     free(argv[0]);
     free(argv[2]);
@@ -30,9 +30,15 @@ spawn_t spawn_init();
  */
 spawn_t spawn_create_shell(const char* command);
 
+/* Same as spawn_create_shell, but the stdin of the program is read from the
+ * input file descriptor.
+ */
+spawn_t spawn_create_shell_input(const char* command, int input);
+
 /* Spawn a process and wait for it to end. */
 bool spawn_exec(char* const prog[]);
 bool spawn_exec_shell(const char* command);
+bool spawn_exec_shell_input(const char* command, int input);
 
 /* Check if the spawn could be created. */
 bool spawn_ok(spawn_t sp);
@@ -1,10 +1,20 @@
-
 #include "strformat.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
 
-#define STRFORMAT_BUFFER_LENGTH 512
+/* The value of a symbol. */
+struct _strformat_value_t {
+    /* The value is copied in a buffer kept between the changes, so that the
+     * values never refer to a memory freed by the caller and setting a value
+     * of the same size doesn't allocate.
+     */
+    char*  text;
+    size_t len;
+    size_t capa;
+    /* The time the value was last changed at. */
+    unsigned long version;
+};
 
 /* A set of symbols to be parsed. */
 struct _strformat_symbs_t {
@@ -12,10 +22,14 @@ struct _strformat_symbs_t {
      * character.
      */
     char*  symbols;
-    /* The values of the symbols. It is an array of strings of the same size
-     * than the symbols string.
+    /* The values of the symbols. It is an array of the same size than the
+     * symbols string.
      */
-    char** contents;
+    struct _strformat_value_t* values;
+    /* The clock giving their versions to the values : it is incremented each
+     * time a value changes.
+     */
+    unsigned long clock;
 };
 
 /* The basic elem in which the string parsed are decomposed. It is an internal
@@ -30,29 +44,34 @@ struct _strformat_elem_t {
         FMT_TEXT,
         FMT_SYMB,
     } type;
-    /* The value, must be interpreted depending on type :
-     *  - if it is FMT_TEXT, value is a (const char*) which value is the text
-     *    to print. It must be free'd.
-     *  - if it is FMT_SYMB, value is a (const char**) pointing to the value of
-     *    the symbol. It mustn't be free'd, because it is a memory managed by
-     *    the strformat_symb_t object.
-     */
-    void* value;
+    /* The text of a FMT_TEXT elem, which must be free'd, and its length. */
+    char*  text;
+    size_t len;
+    /* The index of the symbol of a FMT_SYMB elem. */
+    size_t symbol;
 };
 
 struct _strformat_t {
-    /* The buffer for the string returned by strformat_get. */
-    char buffer[STRFORMAT_BUFFER_LENGTH];
+    /* The symbols attached to the object. */
+    strformat_symbs_t* sbs;
     /* The array of the elems of the parsed string. */
     struct _strformat_elem_t* elems;
     /* The number of elems. */
     size_t nbelems;
+    /* The string returned by strformat_get, built again only when one of the
+     * symbols it refers to changes.
+     */
+    char*  buffer;
+    size_t len;
+    size_t capa;
+    /* Has the string been built, and the time of the clock it was built at. */
+    bool built;
+    unsigned long stamp;
 };
 
 strformat_symbs_t* strformat_symbols(char* symbols)
 {
     strformat_symbs_t* smb;
-    size_t i;
 
     smb = malloc(sizeof(strformat_symbs_t));
     if(!smb)
@@ -64,14 +83,15 @@ strformat_symbs_t* strformat_symbols(char* symbols)
         return NULL;
     }
 
-    smb->contents = malloc(sizeof(char*) * strlen(symbols));
-    if(!smb->contents) {
+    /* The values start empty, with no buffer. */
+    smb->values = calloc(strlen(symbols) + 1,
+            sizeof(struct _strformat_value_t));
+    if(!smb->values) {
         free(smb->symbols);
         free(smb);
         return NULL;
     }
-    for(i = 0; i < strlen(symbols); ++i)
-        smb->contents[i] = strdup("");
+    smb->clock = 0;
 
     return smb;
 }
@@ -83,50 +103,91 @@ void strformat_symbols_destroy(strformat_symbs_t* sbs)
         return;
 
     for(i = 0; i < strlen(sbs->symbols); ++i)
-        free(sbs->contents[i]);
-    free(sbs->contents);
+        free(sbs->values[i].text);
+    free(sbs->values);
     free(sbs->symbols);
     free(sbs);
 }
 
 void strformat_set(strformat_symbs_t* sbs, char symbol, const char* value)
 {
-    size_t i;
+    struct _strformat_value_t* val;
+    size_t len, ncapa;
     char* ch;
-    if(!sbs)
+    if(!sbs || symbol == '\0')
         return;
 
     ch = strchr(sbs->symbols, symbol);
     if(!ch)
         return;
-    i = ch - sbs->symbols;
-
-    if(sbs->contents[i])
-        free(sbs->contents[i]);
-    if(value)
-        sbs->contents[i] = strdup(value);
-    else
-        sbs->contents[i] = strdup("");
+    val = &sbs->values[ch - sbs->symbols];
+
+    if(!value)
+        value = "";
+    len = strlen(value);
+    if(len == val->len && (len == 0 || memcmp(val->text, value, len) == 0))
+        return;
+
+    if(len + 1 > val->capa) {
+        ncapa = (val->capa ? val->capa * 2 : 16);
+        while(ncapa < len + 1)
+            ncapa *= 2;
+        ch = realloc(val->text, ncapa);
+        /* The previous value is kept if the allocation failed. */
+        if(!ch)
+            return;
+        val->text = ch;
+        val->capa = ncapa;
+    }
+    memcpy(val->text, value, len + 1);
+    val->len     = len;
+    val->version = ++sbs->clock;
 }
 
-/* Return the new capacity. Returns 0 and free sbs->elems if an error happened.
- * TODO free all of the elems in case of error.
+/* Add an elem. Returns false if the allocation failed : the elem isn't added,
+ * but its text is free'd.
  */
-static size_t _strformat_add_elem(strformat_t* fmt,
+static bool _strformat_add_elem(strformat_t* fmt,
         struct _strformat_elem_t elem,
-        size_t capacity)
+        size_t* capacity)
 {
-    if(fmt->nbelems >= capacity) {
-        capacity += 10;
-        fmt->elems = realloc(fmt->elems, capacity);
-        if(!fmt->elems)
-            return 0;
+    struct _strformat_elem_t* nelems;
+    size_t ncapa;
+
+    if(fmt->nbelems >= *capacity) {
+        ncapa  = *capacity * 2;
+        nelems = realloc(fmt->elems, ncapa * sizeof(struct _strformat_elem_t));
+        if(!nelems) {
+            if(elem.type == FMT_TEXT)
+                free(elem.text);
+            return false;
+        }
+        fmt->elems = nelems;
+        *capacity  = ncapa;
     }
 
     fmt->elems[fmt->nbelems] = elem;
     ++fmt->nbelems;
+    return true;
+}
+
+/* Add the size bytes of text at str as a FMT_TEXT elem. */
+static bool _strformat_add_text(strformat_t* fmt, const char* str,
+        size_t size, size_t* capacity)
+{
+    struct _strformat_elem_t elem;
 
-    return capacity;
+    if(size == 0)
+        return true;
+    elem.type   = FMT_TEXT;
+    elem.len    = size;
+    elem.symbol = 0;
+    elem.text   = malloc(size + 1);
+    if(!elem.text)
+        return false;
+    memcpy(elem.text, str, size);
+    elem.text[size] = '\0';
+    return _strformat_add_elem(fmt, elem, capacity);
 }
 
 strformat_t* strformat_parse(strformat_symbs_t* sbs, const char* str)
@@ -134,10 +195,10 @@ strformat_t* strformat_parse(strformat_symbs_t* sbs, const char* str)
     strformat_t* fmt;
     struct _strformat_elem_t elem;
     size_t capacity;
-    size_t i, size;
+    size_t i;
     const char* tbg;
-    bool insymb;
-    char c;
+    const char* ch;
+    bool ok;
 
     if(!sbs || !str)
         return NULL;
@@ -146,70 +207,46 @@ strformat_t* strformat_parse(strformat_symbs_t* sbs, const char* str)
     fmt = malloc(sizeof(strformat_t));
     if(!fmt)
         return NULL;
-    fmt->elems = malloc(sizeof(struct _strformat_elem_t) * 10);
+    capacity = 8;
+    fmt->elems = malloc(sizeof(struct _strformat_elem_t) * capacity);
     if(!fmt->elems) {
         free(fmt);
         return NULL;
     }
-    capacity = 10;
+    fmt->sbs     = sbs;
     fmt->nbelems = 0;
-
-    /* Parsing. */
-    insymb = false;
+    fmt->buffer  = NULL;
+    fmt->len     = 0;
+    fmt->capa    = 0;
+    fmt->built   = false;
+    fmt->stamp   = 0;
+
+    /* Parsing : the % not followed by a symbol are kept as is. */
+    ok  = true;
     tbg = str;
-    for(i = 0; i < strlen(str); ++i) {
-        c = str[i];
-
-        if(insymb) {
-            insymb = false;
-            elem.type = FMT_SYMB;
-            tbg = strchr(sbs->symbols, c);
-            if(!tbg)
-                continue;
-            elem.value = &(sbs->contents[tbg - sbs->symbols]);
-
-            capacity = _strformat_add_elem(fmt, elem, capacity);
-            if(capacity == 0) {
-                free(fmt);
-                return NULL;
-            }
-
-            tbg = str + i + 1;
-        }
-
-        else if(c == '%') {
-            insymb = true;
-            if(tbg == (str + i))
-                continue;
-
-            size = str + i - tbg;
-            elem.type  = FMT_TEXT;
-            elem.value = malloc(size + 1);
-            memcpy(elem.value, tbg, size);
-            ((char*)elem.value)[size] = '\0';
-
-            capacity = _strformat_add_elem(fmt, elem, capacity);
-            if(capacity == 0) {
-                free(fmt);
-                return NULL;
-            }
-        }
+    for(i = 0; ok && str[i]; ++i) {
+        if(str[i] != '%' || str[i + 1] == '\0')
+            continue;
+        ch = strchr(sbs->symbols, str[i + 1]);
+        if(!ch)
+            continue;
+
+        ok = _strformat_add_text(fmt, tbg, str + i - tbg, &capacity);
+        elem.type   = FMT_SYMB;
+        elem.text   = NULL;
+        elem.len    = 0;
+        elem.symbol = ch - sbs->symbols;
+        ok  = ok && _strformat_add_elem(fmt, elem, &capacity);
+        tbg = str + i + 2;
+        ++i;
     }
+    if(ok)
+        ok = _strformat_add_text(fmt, tbg, strlen(tbg), &capacity);
 
-    if(tbg < (str + i)) {
-        size = str + i - tbg;
-        elem.type  = FMT_TEXT;
-        elem.value = malloc(size + 1);
-        memcpy(elem.value, tbg, size);
-        ((char*)elem.value)[size] = '\0';
-
-        capacity = _strformat_add_elem(fmt, elem, capacity);
-        if(capacity == 0) {
-            free(fmt);
-            return NULL;
-        }
+    if(!ok) {
+        strformat_destroy(fmt);
+        return NULL;
     }
-
     return fmt;
 }
 
@@ -221,33 +258,93 @@ void strformat_destroy(strformat_t* fmt)
 
     for(i = 0; i < fmt->nbelems; ++i) {
         if(fmt->elems[i].type == FMT_TEXT)
-            free(fmt->elems[i].value);
+            free(fmt->elems[i].text);
     }
     free(fmt->elems);
+    free(fmt->buffer);
     free(fmt);
 }
 
-const char* strformat_get(strformat_t* fmt)
+bool strformat_dirty(strformat_t* fmt)
 {
-    size_t length;
-    char* str;
-    const char* txt;
     size_t i;
+    if(!fmt)
+        return false;
+    if(!fmt->built)
+        return true;
+
+    for(i = 0; i < fmt->nbelems; ++i) {
+        if(fmt->elems[i].type == FMT_SYMB
+                && fmt->sbs->values[fmt->elems[i].symbol].version > fmt->stamp)
+            return true;
+    }
+    return false;
+}
+
+const char* strformat_get(strformat_t* fmt)
+{
+    struct _strformat_elem_t* elem;
+    struct _strformat_value_t* val;
+    size_t len, i, ncapa;
+    char* nbuffer;
     if(!fmt)
         return "";
+    if(!strformat_dirty(fmt))
+        return fmt->buffer;
 
-    str = fmt->buffer;
-    str[0] = '\0';
-    length = STRFORMAT_BUFFER_LENGTH - 1;
+    /* The length of the string is known before it is built. */
+    len = 0;
     for(i = 0; i < fmt->nbelems; ++i) {
-        if(fmt->elems[i].type == FMT_TEXT)
-            txt = fmt->elems[i].value;
+        elem = &fmt->elems[i];
+        if(elem->type == FMT_TEXT)
+            len += elem->len;
         else
-            txt = *((char**)fmt->elems[i].value);
-        strncat(str, txt, length);
-        length -= strlen(txt);
+            len += fmt->sbs->values[elem->symbol].len;
     }
+    if(len + 1 > fmt->capa) {
+        ncapa = (len + 1 > fmt->capa * 2 ? len + 1 : fmt->capa * 2);
+        nbuffer = realloc(fmt->buffer, ncapa);
+        if(!nbuffer)
+            return "";
+        fmt->buffer = nbuffer;
+        fmt->capa   = ncapa;
+    }
+
+    len = 0;
+    for(i = 0; i < fmt->nbelems; ++i) {
+        elem = &fmt->elems[i];
+        if(elem->type == FMT_TEXT) {
+            memcpy(fmt->buffer + len, elem->text, elem->len);
+            len += elem->len;
+        } else {
+            val = &fmt->sbs->values[elem->symbol];
+            if(val->len > 0)
+                memcpy(fmt->buffer + len, val->text, val->len);
+            len += val->len;
+        }
+    }
+    fmt->buffer[len] = '\0';
+    fmt->len   = len;
+    fmt->built = true;
+    fmt->stamp = fmt->sbs->clock;
+    return fmt->buffer;
+}
 
-    return str;
+bool strformat_uses(strformat_t* fmt, char symbol)
+{
+    size_t i;
+    const char* ch;
+    if(!fmt || symbol == '\0')
+        return false;
+
+    ch = strchr(fmt->sbs->symbols, symbol);
+    if(!ch)
+        return false;
+    for(i = 0; i < fmt->nbelems; ++i) {
+        if(fmt->elems[i].type == FMT_SYMB
+                && fmt->elems[i].symbol == (size_t)(ch - fmt->sbs->symbols))
+            return true;
+    }
+    return false;
 }
 
@@ -2,6 +2,8 @@
 #ifndef DEF_STRFORMAT
 #define DEF_STRFORMAT
 
+#include <stdbool.h>
+
 struct _strformat_symbs_t;
 typedef struct _strformat_symbs_t strformat_symbs_t;
 struct _strformat_t;
@@ -17,7 +19,10 @@ strformat_symbs_t* strformat_symbols(char* symbols);
 /* Destroy an strformat symbols object. */
 void strformat_symbols_destroy(strformat_symbs_t* sbs);
 
-/* Set a value for a symbol. */
+/* Set a value for a symbol. The value is copied, so it doesn't need to remain
+ * valid afterward. The strings referring to the symbol are only built again if
+ * the value differs from the previous one.
+ */
 void strformat_set(strformat_symbs_t* sbs, char symbol, const char* value);
 
 /* Parse a string to prepare the symbols to be placed on it. The
@@ -34,9 +39,18 @@ void strformat_destroy(strformat_t* fmt);
 /* Get the string with the symbols replaced from an strformat_t object. The
  * string belong to the object, so it mustn't be free'd. It will remain valid
  * until the next call to this function or until the destruction of the object.
- * It will return an empty but valid string in cse of errors.
+ * It is only built again if one of the symbols it refers to changed. It will
+ * return an empty but valid string in cse of errors.
  */
 const char* strformat_get(strformat_t* fmt);
 
+/* Indicates if one of the symbols an strformat_t object refers to changed
+ * since the last call to strformat_get, or if it has never been called.
+ */
+bool strformat_dirty(strformat_t* fmt);
+
+/* Indicates if an strformat_t object refers to a symbol. */
+bool strformat_uses(strformat_t* fmt, char symbol);
+
 #endif
 
@@ -0,0 +1,540 @@
+#include "strmatch.h"
+#include <string.h>
+#include <limits.h>
+#include <wchar.h>
+#include <wctype.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define STRMATCH_SIMD
+#endif
+
+/* The number of needles above which strmatch_multi_search stops searching
+ * each needle separately and scans for their first bytes at once.
+ */
+#define STRMATCH_MULTI_SCAN 8
+
+/* A compiled needle. */
+struct _strmatch_t {
+    /* The needle, folded if flags contains STRMATCH_ICASE. */
+    char* needle;
+    /* The length of the needle. */
+    size_t len;
+    /* The flags given at compile time. */
+    int flags;
+    /* Is the needle pure ASCII. If so, an icase search can be done without
+     * folding the hay.
+     */
+    bool ascii;
+    /* A buffer in which the hay is folded when needed. */
+    char* scratch;
+    size_t scratch_capa;
+};
+
+struct _strmatch_multi_t {
+    /* The compiled needles. */
+    strmatch_t** needles;
+    size_t nb;
+    /* The flags given at compile time. */
+    int flags;
+    /* Are all the needles pure ASCII. */
+    bool ascii;
+    /* For each first byte (folded if icase), is there a needle starting with
+     * it. Only used when there are more than STRMATCH_MULTI_SCAN needles.
+     */
+    bool first[256];
+    /* A buffer in which the hay is folded when needed. */
+    char* scratch;
+    size_t scratch_capa;
+};
+
+/* The implementations selected by strmatch_init. The find function expects
+ * the needle to be already folded if icase is true, and only handle ASCII
+ * folding.
+ */
+static const char* (*_strmatch_find)(const char* hay, size_t len,
+        const char* ndl, size_t n, bool icase);
+static bool (*_strmatch_isascii)(const char* str, size_t len);
+
+/********************* Scalar implementation *********************************/
+static char _strmatch_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+}
+
+/* Compare n bytes, the needle being already folded. */
+static bool _strmatch_eq(const char* hay, const char* ndl, size_t n,
+        bool icase)
+{
+    size_t i;
+    if(!icase)
+        return memcmp(hay, ndl, n) == 0;
+    for(i = 0; i < n; ++i) {
+        if(_strmatch_lower(hay[i]) != ndl[i])
+            return false;
+    }
+    return true;
+}
+
+static const char* _strmatch_find_scalar(const char* hay, size_t len,
+        const char* ndl, size_t n, bool icase)
+{
+    size_t i;
+    const char* ch;
+
+    if(n == 0)
+        return hay;
+    if(n > len)
+        return NULL;
+
+    if(!icase) {
+        ch = hay;
+        while((ch = memchr(ch, ndl[0], len - n + 1 - (ch - hay)))) {
+            if(memcmp(ch, ndl, n) == 0)
+                return ch;
+            ++ch;
+        }
+        return NULL;
+    }
+
+    for(i = 0; i + n <= len; ++i) {
+        if(_strmatch_lower(hay[i]) == ndl[0]
+                && _strmatch_eq(hay + i, ndl, n, true))
+            return hay + i;
+    }
+    return NULL;
+}
+
+static bool _strmatch_isascii_scalar(const char* str, size_t len)
+{
+    size_t i;
+    for(i = 0; i < len; ++i) {
+        if(str[i] & 0x80)
+            return false;
+    }
+    return true;
+}
+
+#ifdef STRMATCH_SIMD
+/********************* SSE2 implementation ***********************************/
+/* Fold the ASCII upper case letters of a vector. */
+static __m128i _strmatch_lower_sse2(__m128i v)
+{
+    __m128i up;
+    up = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+            _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), v));
+    return _mm_or_si128(v, _mm_and_si128(up, _mm_set1_epi8(0x20)));
+}
+
+/* Compare the first and the last bytes of the needle at 16 positions at once,
+ * and only verify the candidates.
+ */
+static const char* _strmatch_find_sse2(const char* hay, size_t len,
+        const char* ndl, size_t n, bool icase)
+{
+    size_t i;
+    unsigned int mask, bit;
+    __m128i first, last, a, b;
+
+    if(n == 0)
+        return hay;
+    if(n > len)
+        return NULL;
+
+    first = _mm_set1_epi8(ndl[0]);
+    last  = _mm_set1_epi8(ndl[n - 1]);
+    for(i = 0; i + n - 1 + 16 <= len; i += 16) {
+        a = _mm_loadu_si128((const __m128i*)(hay + i));
+        b = _mm_loadu_si128((const __m128i*)(hay + i + n - 1));
+        if(icase) {
+            a = _strmatch_lower_sse2(a);
+            b = _strmatch_lower_sse2(b);
+        }
+        mask = _mm_movemask_epi8(_mm_and_si128(
+                    _mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while(mask) {
+            bit = __builtin_ctz(mask);
+            if(_strmatch_eq(hay + i + bit, ndl, n, icase))
+                return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return _strmatch_find_scalar(hay + i, len - i, ndl, n, icase);
+}
+
+static bool _strmatch_isascii_sse2(const char* str, size_t len)
+{
+    size_t i;
+    __m128i acc = _mm_setzero_si128();
+    for(i = 0; i + 16 <= len; i += 16)
+        acc = _mm_or_si128(acc, _mm_loadu_si128((const __m128i*)(str + i)));
+    if(_mm_movemask_epi8(acc))
+        return false;
+    return _strmatch_isascii_scalar(str + i, len - i);
+}
+
+/********************* AVX2 implementation ***********************************/
+__attribute__((target("avx2")))
+static __m256i _strmatch_lower_avx2(__m256i v)
+{
+    __m256i up;
+    up = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1)),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v));
+    return _mm256_or_si256(v, _mm256_and_si256(up, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+static const char* _strmatch_find_avx2(const char* hay, size_t len,
+        const char* ndl, size_t n, bool icase)
+{
+    size_t i;
+    unsigned int mask, bit;
+    __m256i first, last, a, b;
+
+    if(n == 0)
+        return hay;
+    if(n > len)
+        return NULL;
+
+    first = _mm256_set1_epi8(ndl[0]);
+    last  = _mm256_set1_epi8(ndl[n - 1]);
+    for(i = 0; i + n - 1 + 32 <= len; i += 32) {
+        a = _mm256_loadu_si256((const __m256i*)(hay + i));
+        b = _mm256_loadu_si256((const __m256i*)(hay + i + n - 1));
+        if(icase) {
+            a = _strmatch_lower_avx2(a);
+            b = _strmatch_lower_avx2(b);
+        }
+        mask = _mm256_movemask_epi8(_mm256_and_si256(
+                    _mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while(mask) {
+            bit = __builtin_ctz(mask);
+            if(_strmatch_eq(hay + i + bit, ndl, n, icase))
+                return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return _strmatch_find_sse2(hay + i, len - i, ndl, n, icase);
+}
+
+__attribute__((target("avx2")))
+static bool _strmatch_isascii_avx2(const char* str, size_t len)
+{
+    size_t i;
+    __m256i acc = _mm256_setzero_si256();
+    for(i = 0; i + 32 <= len; i += 32) {
+        acc = _mm256_or_si256(acc,
+                _mm256_loadu_si256((const __m256i*)(str + i)));
+    }
+    if(_mm256_movemask_epi8(acc))
+        return false;
+    return _strmatch_isascii_sse2(str + i, len - i);
+}
+#endif
+
+/********************* Public interface **************************************/
+bool strmatch_init()
+{
+    if(strmatch_use(STRMATCH_AVX2))
+        return true;
+    if(strmatch_use(STRMATCH_SSE2))
+        return true;
+    return strmatch_use(STRMATCH_SCALAR);
+}
+
+bool strmatch_use(int impl)
+{
+    if(impl == STRMATCH_SCALAR) {
+        _strmatch_find    = &_strmatch_find_scalar;
+        _strmatch_isascii = &_strmatch_isascii_scalar;
+        return true;
+    }
+#ifdef STRMATCH_SIMD
+    /* SSE2 is part of x86_64. */
+    if(impl == STRMATCH_SSE2) {
+        _strmatch_find    = &_strmatch_find_sse2;
+        _strmatch_isascii = &_strmatch_isascii_sse2;
+        return true;
+    }
+    __builtin_cpu_init();
+    if(impl == STRMATCH_AVX2 && __builtin_cpu_supports("avx2")) {
+        _strmatch_find    = &_strmatch_find_avx2;
+        _strmatch_isascii = &_strmatch_isascii_avx2;
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool strmatch_ascii(const char* str, size_t len)
+{
+    return _strmatch_isascii(str, len);
+}
+
+void strmatch_fold(const char* str, size_t len, char* out)
+{
+    size_t i, l;
+    mbstate_t st;
+    wchar_t wc;
+    char buffer[MB_LEN_MAX];
+
+    memset(&st, 0, sizeof(mbstate_t));
+    i = 0;
+    while(i < len) {
+        /* ASCII fast path. */
+        if(!(str[i] & 0x80)) {
+            out[i] = _strmatch_lower(str[i]);
+            ++i;
+            continue;
+        }
+
+        l = mbrtowc(&wc, str + i, len - i, &st);
+        if(l == (size_t)-1 || l == (size_t)-2 || l == 0) {
+            memset(&st, 0, sizeof(mbstate_t));
+            out[i] = str[i];
+            ++i;
+            continue;
+        }
+
+        if(wcrtomb(buffer, towlower(wc), &st) == l)
+            memcpy(out + i, buffer, l);
+        else
+            memcpy(out + i, str + i, l);
+        i += l;
+    }
+}
+
+strmatch_t* strmatch_compile(const char* needle, int flags)
+{
+    strmatch_t* m;
+
+    m = malloc(sizeof(strmatch_t));
+    if(!m)
+        return NULL;
+
+    m->len    = strlen(needle);
+    m->flags  = flags;
+    m->ascii  = strmatch_ascii(needle, m->len);
+    m->needle = malloc(m->len + 1);
+    if(!m->needle) {
+        free(m);
+        return NULL;
+    }
+    if(flags & STRMATCH_ICASE)
+        strmatch_fold(needle, m->len, m->needle);
+    else
+        memcpy(m->needle, needle, m->len);
+    m->needle[m->len] = '\0';
+
+    m->scratch      = NULL;
+    m->scratch_capa = 0;
+    return m;
+}
+
+void strmatch_destroy(strmatch_t* m)
+{
+    if(!m)
+        return;
+    free(m->needle);
+    if(m->scratch)
+        free(m->scratch);
+    free(m);
+}
+
+size_t strmatch_length(strmatch_t* m)
+{
+    return m->len;
+}
+
+/* Fold len bytes of hay into a scratch buffer, growing it if necessary.
+ * Returns NULL if the allocation failed.
+ */
+static const char* _strmatch_fold_hay(char** scratch, size_t* capa,
+        const char* hay, size_t len)
+{
+    char* nscratch;
+    if(len == 0)
+        return hay;
+    if(len > *capa) {
+        nscratch = realloc(*scratch, len);
+        if(!nscratch)
+            return NULL;
+        *scratch = nscratch;
+        *capa    = len;
+    }
+    strmatch_fold(hay, len, *scratch);
+    return *scratch;
+}
+
+const char* strmatch_search(strmatch_t* m, const char* hay, size_t len)
+{
+    const char* folded;
+    const char* found;
+
+    if(!(m->flags & STRMATCH_ICASE))
+        return _strmatch_find(hay, len, m->needle, m->len, false);
+    /* An ASCII needle can only match ASCII bytes. */
+    if(m->ascii)
+        return _strmatch_find(hay, len, m->needle, m->len, true);
+    if(_strmatch_isascii(hay, len))
+        return NULL;
+
+    folded = _strmatch_fold_hay(&m->scratch, &m->scratch_capa, hay, len);
+    if(!folded)
+        return NULL;
+    found = _strmatch_find(folded, len, m->needle, m->len, false);
+    return (found ? hay + (found - folded) : NULL);
+}
+
+bool strmatch_prefix(strmatch_t* m, const char* hay, size_t len)
+{
+    const char* folded;
+
+    if(len < m->len)
+        return false;
+    if(!(m->flags & STRMATCH_ICASE))
+        return memcmp(hay, m->needle, m->len) == 0;
+    if(m->ascii)
+        return _strmatch_eq(hay, m->needle, m->len, true);
+
+    folded = _strmatch_fold_hay(&m->scratch, &m->scratch_capa,
+            hay, m->len);
+    return folded && memcmp(folded, m->needle, m->len) == 0;
+}
+
+strmatch_multi_t* strmatch_multi_compile(const char* const* needles,
+        size_t nb, int flags)
+{
+    strmatch_multi_t* m;
+    strmatch_t* ndl;
+
+    m = malloc(sizeof(strmatch_multi_t));
+    if(!m)
+        return NULL;
+    m->needles = malloc(sizeof(strmatch_t*) * (nb ? nb : 1));
+    if(!m->needles) {
+        free(m);
+        return NULL;
+    }
+
+    m->flags        = flags;
+    m->ascii        = true;
+    m->scratch      = NULL;
+    m->scratch_capa = 0;
+    memset(m->first, 0, sizeof(m->first));
+    for(m->nb = 0; m->nb < nb; ++m->nb) {
+        ndl = strmatch_compile(needles[m->nb], flags);
+        if(!ndl) {
+            strmatch_multi_destroy(m);
+            return NULL;
+        }
+        m->needles[m->nb] = ndl;
+        m->ascii = m->ascii && ndl->ascii;
+        /* An empty needle matches everywhere. */
+        if(ndl->len == 0)
+            memset(m->first, true, sizeof(m->first));
+        else
+            m->first[(unsigned char)ndl->needle[0]] = true;
+    }
+    return m;
+}
+
+void strmatch_multi_destroy(strmatch_multi_t* m)
+{
+    size_t i;
+    if(!m)
+        return;
+    for(i = 0; i < m->nb; ++i)
+        strmatch_destroy(m->needles[i]);
+    free(m->needles);
+    if(m->scratch)
+        free(m->scratch);
+    free(m);
+}
+
+/* Scan hay once, and only check the needles at the positions where one of
+ * them could start.
+ */
+static const char* _strmatch_multi_scan(strmatch_multi_t* m,
+        const char* hay, size_t len, size_t* which)
+{
+    size_t i, j, n;
+    unsigned char c;
+    const char* scan;
+    bool icase;
+
+    scan  = hay;
+    icase = (m->flags & STRMATCH_ICASE);
+    if(icase && !m->ascii) {
+        scan = _strmatch_fold_hay(&m->scratch, &m->scratch_capa, hay, len);
+        if(!scan)
+            return NULL;
+        icase = false;
+    }
+
+    for(i = 0; i <= len; ++i) {
+        c = (i < len ? scan[i] : '\0');
+        if(icase)
+            c = _strmatch_lower(c);
+        if(i < len && !m->first[c])
+            continue;
+        for(j = 0; j < m->nb; ++j) {
+            n = m->needles[j]->len;
+            if(n <= len - i
+                    && _strmatch_eq(scan + i, m->needles[j]->needle, n, icase)) {
+                if(which)
+                    *which = j;
+                return hay + i;
+            }
+        }
+    }
+    return NULL;
+}
+
+const char* strmatch_multi_search(strmatch_multi_t* m,
+        const char* hay, size_t len, size_t* which)
+{
+    const char* best;
+    const char* found;
+    const char* scan;
+    size_t i, lim;
+
+    if(m->nb > STRMATCH_MULTI_SCAN)
+        return _strmatch_multi_scan(m, hay, len, which);
+
+    /* The hay is folded at once for all the needles. It is folded as a whole,
+     * so that the characters cut by the limits below are folded as in hay.
+     */
+    scan = hay;
+    if((m->flags & STRMATCH_ICASE) && !m->ascii) {
+        scan = _strmatch_fold_hay(&m->scratch, &m->scratch_capa, hay, len);
+        if(!scan)
+            return NULL;
+    }
+
+    /* Each needle is only searched in the part of hay where it could start
+     * before the best occurence found so far.
+     */
+    best = NULL;
+    for(i = 0; i < m->nb; ++i) {
+        lim = len;
+        if(best) {
+            lim = best - hay + m->needles[i]->len;
+            lim = (lim > 0 ? lim - 1 : 0);
+            lim = (lim < len ? lim : len);
+        }
+        if(scan != hay) {
+            found = _strmatch_find(scan, lim, m->needles[i]->needle,
+                    m->needles[i]->len, false);
+            found = (found ? hay + (found - scan) : NULL);
+        }
+        else
+            found = strmatch_search(m->needles[i], hay, lim);
+        if(found && (!best || found < best)) {
+            best = found;
+            if(which)
+                *which = i;
+        }
+    }
+    return best;
+}
+
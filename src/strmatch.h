@@ -0,0 +1,81 @@
+#ifndef DEF_STRMATCH
+#define DEF_STRMATCH
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* Flags for the matchers. */
+/* The matching is case insensitive. */
+#define STRMATCH_ICASE (1<<0)
+
+/* A compiled needle. */
+struct _strmatch_t;
+typedef struct _strmatch_t strmatch_t;
+
+/* A compiled set of needles. */
+struct _strmatch_multi_t;
+typedef struct _strmatch_multi_t strmatch_multi_t;
+
+/* Select the fastest implementation available on the running cpu (AVX2, SSE2
+ * or scalar). Must be called once before any other function of this module.
+ */
+bool strmatch_init();
+
+/* The implementations of the matchers. */
+#define STRMATCH_SCALAR 0
+#define STRMATCH_SSE2   1
+#define STRMATCH_AVX2   2
+/* Use a specific implementation, so that they can be compared. Returns false
+ * if the running cpu doesn't support it.
+ */
+bool strmatch_use(int impl);
+
+/* Returns true if the len bytes of str are all ASCII. */
+bool strmatch_ascii(const char* str, size_t len);
+
+/* Fold the case of the len bytes of str into out, which must be at least len
+ * bytes long. The folding uses the current locale for UTF-8 characters. A
+ * character which folded form doesn't have the same length is left as is, so
+ * that an offset in out is also an offset in str.
+ */
+void strmatch_fold(const char* str, size_t len, char* out);
+
+/* Compile a needle. It will be duplicated (and folded if flags contains
+ * STRMATCH_ICASE). Returns NULL if the allocation failed.
+ */
+strmatch_t* strmatch_compile(const char* needle, int flags);
+
+/* Destroy a compiled needle. */
+void strmatch_destroy(strmatch_t* m);
+
+/* Get the length in bytes of the needle. */
+size_t strmatch_length(strmatch_t* m);
+
+/* Search the first occurence of the needle in the len first bytes of hay,
+ * which doesn't need to be 0-terminated. Returns a pointer to the occurence in
+ * hay, or NULL if there is none.
+ */
+const char* strmatch_search(strmatch_t* m, const char* hay, size_t len);
+
+/* Returns true if the len first bytes of hay start with the needle. */
+bool strmatch_prefix(strmatch_t* m, const char* hay, size_t len);
+
+/* Compile a set of nb needles. They all share the same flags. Returns NULL if
+ * the allocation failed.
+ */
+strmatch_multi_t* strmatch_multi_compile(const char* const* needles,
+        size_t nb, int flags);
+
+/* Destroy a compiled set of needles. */
+void strmatch_multi_destroy(strmatch_multi_t* m);
+
+/* Search the leftmost occurence of any of the needles in hay. Returns a
+ * pointer to it or NULL. If which is not NULL, it will be set to the index of
+ * the matched needle (the first one given to strmatch_multi_compile if
+ * several match at the same place).
+ */
+const char* strmatch_multi_search(strmatch_multi_t* m,
+        const char* hay, size_t len, size_t* which);
+
+#endif
+
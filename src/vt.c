@@ -0,0 +1,277 @@
+
+#include "vt.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+
+#define VT_SYNC_BEGIN "\033[?2026h"
+#define VT_SYNC_END   "\033[?2026l"
+
+/* The colors of a pair. */
+struct _vt_pair_t {
+    int fg;
+    int bg;
+};
+
+/* The file descriptor of the terminal. */
+static int    _vt_fd;
+/* The size of the terminal. */
+static unsigned int _vt_width;
+static unsigned int _vt_height;
+/* The frame being built. The synchronized output begin marker is always at
+ * its beginning.
+ */
+static char*  _vt_buffer;
+static size_t _vt_len;
+static size_t _vt_capa;
+/* The color pairs. */
+static struct _vt_pair_t _vt_pairs[VT_PAIRS];
+/* The position of the cursor, -1 if unknown. */
+static long   _vt_y;
+static long   _vt_x;
+/* The current colors and style flags, -1 if unknown. */
+static int    _vt_fg;
+static int    _vt_bg;
+static int    _vt_flags;
+/* The counters of written bytes. */
+static size_t _vt_frame;
+static size_t _vt_total;
+
+bool vt_init(int fd)
+{
+    int i;
+    _vt_fd     = fd;
+    _vt_width  = 0;
+    _vt_height = 0;
+    _vt_capa   = 4096;
+    _vt_buffer = malloc(_vt_capa);
+    _vt_frame  = 0;
+    _vt_total  = 0;
+    for(i = 0; i < VT_PAIRS; ++i) {
+        _vt_pairs[i].fg = 7;
+        _vt_pairs[i].bg = 0;
+    }
+    vt_invalidate();
+    return _vt_buffer;
+}
+
+void vt_quit()
+{
+    if(_vt_buffer)
+        free(_vt_buffer);
+    _vt_buffer = NULL;
+}
+
+void vt_resize(unsigned int width, unsigned int height)
+{
+    _vt_width  = width;
+    _vt_height = height;
+    vt_invalidate();
+}
+
+void vt_invalidate()
+{
+    _vt_len = 0;
+    _vt_y   = -1;
+    _vt_x     = -1;
+    _vt_fg    = -1;
+    _vt_bg    = -1;
+    _vt_flags = -1;
+}
+
+void vt_colors(int cp, int fg, int bg)
+{
+    if(cp < 0 || cp >= VT_PAIRS)
+        return;
+    _vt_pairs[cp].fg = fg;
+    _vt_pairs[cp].bg = bg;
+}
+
+/* Append bytes to the frame. */
+static void _vt_put(const char* str, size_t len)
+{
+    char* nbuffer;
+    size_t ncapa;
+
+    if(_vt_len == 0) {
+        /* Starting a new frame. */
+        _vt_len = strlen(VT_SYNC_BEGIN);
+        memcpy(_vt_buffer, VT_SYNC_BEGIN, _vt_len);
+    }
+
+    if(_vt_len + len > _vt_capa) {
+        ncapa = _vt_capa * 2;
+        while(_vt_len + len > ncapa)
+            ncapa *= 2;
+        nbuffer = realloc(_vt_buffer, ncapa);
+        if(!nbuffer)
+            return;
+        _vt_buffer = nbuffer;
+        _vt_capa   = ncapa;
+    }
+    memcpy(_vt_buffer + _vt_len, str, len);
+    _vt_len += len;
+}
+
+/* Append a formatted escape sequence to the frame. */
+static void _vt_seq(const char* format, long a, long b)
+{
+    char seq[64];
+    int len = snprintf(seq, 64, format, a, b);
+    if(len > 0)
+        _vt_put(seq, len);
+}
+
+/* Move the cursor to the beginning of a row. */
+static void _vt_move_row(unsigned int y)
+{
+    if(_vt_y == (long)y && _vt_x == 0)
+        return;
+    if(_vt_y == (long)y)
+        _vt_put("\r", 1);
+    else if(_vt_y >= 0 && _vt_y + 1 == (long)y)
+        _vt_put("\r\n", 2);
+    else
+        _vt_seq("\033[%ldH", y + 1, 0);
+    _vt_y = y;
+    _vt_x = 0;
+}
+
+/* Use colors and style flags. Nothing is written if they are already used. */
+static void _vt_attr(int fg, int bg, int flags)
+{
+    char seq[32];
+    int len;
+
+    if(fg == _vt_fg && bg == _vt_bg && flags == _vt_flags)
+        return;
+    len = snprintf(seq, 32, "\033[0%s%s%s;%d;%dm",
+            (flags & ANSI_BOLD      ? ";1" : ""),
+            (flags & ANSI_UNDERLINE ? ";4" : ""),
+            (flags & ANSI_REVERSE   ? ";7" : ""),
+            30 + fg, 40 + bg);
+    if(len > 0)
+        _vt_put(seq, len);
+    _vt_fg    = fg;
+    _vt_bg    = bg;
+    _vt_flags = flags;
+}
+
+/* Use the colors of a pair, changed by an attribute of the ansi module. */
+static void _vt_pair(int cp, uint16_t attr)
+{
+    int fg, bg;
+
+    if(cp < 0 || cp >= VT_PAIRS)
+        cp = 0;
+    fg = ANSI_FG(attr);
+    bg = ANSI_BG(attr);
+    _vt_attr(fg == ANSI_DEFAULT ? _vt_pairs[cp].fg : fg,
+            bg == ANSI_DEFAULT ? _vt_pairs[cp].bg : bg,
+            attr & (ANSI_BOLD | ANSI_UNDERLINE | ANSI_REVERSE));
+}
+
+void vt_row(unsigned int y, int cp, const char* text, size_t len,
+        const ansi_run_t* runs, size_t nbruns, size_t cols)
+{
+    size_t i, off, end;
+
+    if(y >= _vt_height)
+        return;
+    _vt_move_row(y);
+    off = (nbruns > 0 ? runs[0].off : len);
+    if(off > 0) {
+        _vt_pair(cp, ANSI_PLAIN);
+        _vt_put(text, off);
+    }
+    for(i = 0; i < nbruns; ++i) {
+        end = (i + 1 < nbruns ? runs[i + 1].off : len);
+        _vt_pair(cp, runs[i].attr);
+        _vt_put(text + off, end - off);
+        off = end;
+    }
+
+    /* Clearing the end of the row with the background of the pair. A full
+     * row mustn't be cleared : the cursor is still on its last column.
+     */
+    if(cols < _vt_width) {
+        _vt_pair(cp, ANSI_PLAIN);
+        _vt_put("\033[K", 3);
+        _vt_x = cols;
+    } else
+        _vt_x = -1;
+}
+
+void vt_scroll(unsigned int top, unsigned int bot, long k)
+{
+    if(k == 0 || top > bot || bot >= _vt_height)
+        return;
+    _vt_seq("\033[%ld;%ldr", top + 1, bot + 1);
+    if(k > 0)
+        _vt_seq("\033[%ldS", k, 0);
+    else
+        _vt_seq("\033[%ldT", -k, 0);
+    _vt_put("\033[r", 3);
+    /* Setting the scroll region homes the cursor. */
+    _vt_y = 0;
+    _vt_x = 0;
+}
+
+void vt_cursor(unsigned int y, unsigned int x)
+{
+    if(_vt_y == (long)y && _vt_x == (long)x)
+        return;
+    _vt_seq("\033[%ld;%ldH", y + 1, x + 1);
+    _vt_y = y;
+    _vt_x = x;
+}
+
+bool vt_flush()
+{
+    struct pollfd pfd;
+    size_t done;
+    ssize_t l;
+
+    if(_vt_len == 0)
+        return false;
+    _vt_put(VT_SYNC_END, strlen(VT_SYNC_END));
+
+    /* Without a file descriptor, the frame is only counted. */
+    done = (_vt_fd >= 0 ? 0 : _vt_len);
+    while(done < _vt_len) {
+        l = write(_vt_fd, _vt_buffer + done, _vt_len - done);
+        if(l < 0) {
+            if(errno == EINTR)
+                continue;
+            if(errno != EAGAIN && errno != EWOULDBLOCK)
+                break;
+            /* The terminal is full : wait for it to drain instead of
+             * spinning on write.
+             */
+            pfd.fd     = _vt_fd;
+            pfd.events = POLLOUT;
+            if(poll(&pfd, 1, -1) < 0 && errno != EINTR)
+                break;
+            continue;
+        }
+        done += l;
+    }
+
+    _vt_frame  = _vt_len;
+    _vt_total += _vt_len;
+    _vt_len    = 0;
+    return true;
+}
+
+size_t vt_frame_bytes()
+{
+    return _vt_frame;
+}
+
+size_t vt_total_bytes()
+{
+    return _vt_total;
+}
+
@@ -0,0 +1,61 @@
+
+#ifndef DEF_VT
+#define DEF_VT
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "ansi.h"
+
+/* The vt backend draws the screen by writing the escape sequences to the
+ * terminal itself instead of going through ncurses, which is still used to
+ * read the keys and to set the terminal modes. A frame is built in a single
+ * buffer, using the shortest cursor moves and only changing the colors when
+ * they differ, and it is written at once. The frames are enclosed in the
+ * synchronized output mode (DEC private mode 2026), which the terminals that
+ * don't support it ignore, so that they aren't displayed half drawn.
+ */
+
+/* The number of color pairs. */
+#define VT_PAIRS 16
+
+/* Init and free the backend. The frames are written to fd. If it is negative,
+ * they are only built and counted.
+ */
+bool vt_init(int fd);
+void vt_quit();
+
+/* Set the size of the terminal. The content of the screen is forgotten. */
+void vt_resize(unsigned int width, unsigned int height);
+
+/* Forget the state of the terminal, which has been modified by someone else. */
+void vt_invalidate();
+
+/* Set the colors of a pair. */
+void vt_colors(int cp, int fg, int bg);
+
+/* Draw a row of the screen : len bytes of text, which span over cols
+ * columns, followed by spaces until the end of the row. The colors of the
+ * text are changed by the nbruns runs of attributes.
+ */
+void vt_row(unsigned int y, int cp, const char* text, size_t len,
+        const ansi_run_t* runs, size_t nbruns, size_t cols);
+
+/* Scroll the rows in [top, bot] by k rows : upward if k is positive, downward
+ * otherwise. The exposed rows are cleared.
+ */
+void vt_scroll(unsigned int top, unsigned int bot, long k);
+
+/* Place the cursor. */
+void vt_cursor(unsigned int y, unsigned int x);
+
+/* Write the frame to the terminal. Returns false if it was empty, in which
+ * case nothing is written.
+ */
+bool vt_flush();
+
+/* Get the number of bytes written by the last frame, and by all of them. */
+size_t vt_frame_bytes();
+size_t vt_total_bytes();
+
+#endif
+
@@ -0,0 +1,262 @@
+
+#include "widths.h"
+#include <string.h>
+#include <stdint.h>
+#include <wchar.h>
+
+/* A checkpoint : the first character displayed at a multiple of WIDTHS_STEP
+ * columns or after it.
+ */
+struct _widths_check_t {
+    /* Its offset in the text. */
+    uint32_t off;
+    /* The column it is displayed at. */
+    uint32_t col;
+};
+
+/* The state of the index of a line. */
+enum {
+    WIDTHS_UNKNOWN = 0,
+    WIDTHS_SIMPLE,
+    WIDTHS_INDEXED
+};
+
+/* The index of a line. */
+struct _widths_line_t {
+    /* The checkpoints, NULL if the line is simple or not indexed. */
+    struct _widths_check_t* checks;
+    /* The number of checkpoints. */
+    uint32_t nb;
+    /* The number of columns of the whole text. */
+    uint32_t width;
+    /* The state of the index. */
+    uint8_t  state;
+};
+
+/* The indexes of the lines, by line id. */
+static struct _widths_line_t* _widths_lines;
+static size_t                 _widths_capa;
+
+bool widths_init()
+{
+    _widths_lines = NULL;
+    _widths_capa  = 0;
+    return true;
+}
+
+void widths_quit()
+{
+    widths_clear();
+}
+
+void widths_clear()
+{
+    size_t i;
+    if(!_widths_lines)
+        return;
+    for(i = 0; i < _widths_capa; ++i) {
+        if(_widths_lines[i].checks)
+            free(_widths_lines[i].checks);
+    }
+    free(_widths_lines);
+    _widths_lines = NULL;
+    _widths_capa  = 0;
+}
+
+void widths_forget(size_t id)
+{
+    if(id >= _widths_capa)
+        return;
+    if(_widths_lines[id].checks)
+        free(_widths_lines[id].checks);
+    _widths_lines[id].checks = NULL;
+    _widths_lines[id].nb     = 0;
+    _widths_lines[id].width  = 0;
+    _widths_lines[id].state  = WIDTHS_UNKNOWN;
+}
+
+size_t widths_char(const char* str, size_t len, size_t col, int* w)
+{
+    unsigned char c = *str;
+    mbstate_t st;
+    wchar_t wc;
+    size_t l;
+
+    if(c < 0x80) {
+        if(c == '\t')
+            *w = WIDTHS_TAB - col % WIDTHS_TAB;
+        else if(c < 0x20 || c == 0x7f)
+            *w = -1;
+        else
+            *w = 1;
+        return 1;
+    }
+
+    memset(&st, 0, sizeof(mbstate_t));
+    l = mbrtowc(&wc, str, len, &st);
+    if(l == (size_t)-1 || l == (size_t)-2 || l == 0) {
+        *w = -1;
+        return 1;
+    }
+    *w = wcwidth(wc);
+    if(*w < 0)
+        *w = -1;
+    return l;
+}
+
+/* Get the index of a line, making room for it. Returns NULL if the allocation
+ * failed.
+ */
+static struct _widths_line_t* _widths_get(size_t id)
+{
+    struct _widths_line_t* nlines;
+    size_t ncapa;
+
+    if(id >= _widths_capa) {
+        ncapa = (_widths_capa ? _widths_capa : 256);
+        while(ncapa <= id)
+            ncapa *= 2;
+        nlines = realloc(_widths_lines, sizeof(struct _widths_line_t) * ncapa);
+        if(!nlines)
+            return NULL;
+        memset(nlines + _widths_capa, 0,
+                sizeof(struct _widths_line_t) * (ncapa - _widths_capa));
+        _widths_lines = nlines;
+        _widths_capa  = ncapa;
+    }
+    return &_widths_lines[id];
+}
+
+/* Compute the index of a line. */
+static void _widths_index(struct _widths_line_t* ln,
+        const char* text, size_t len)
+{
+    struct _widths_check_t* nchecks;
+    size_t i, l, col, capa;
+    int w;
+
+    for(i = 0; i < len; ++i) {
+        if((unsigned char)text[i] < 0x20 || (unsigned char)text[i] >= 0x7f)
+            break;
+    }
+    if(i == len) {
+        ln->state = WIDTHS_SIMPLE;
+        ln->width = len;
+        return;
+    }
+
+    capa = 0;
+    col  = 0;
+    for(i = 0; i < len; i += l) {
+        l = widths_char(text + i, len - i, col, &w);
+        /* The zero width characters belong to the previous one. */
+        if(w != 0) {
+            while(col >= (size_t)ln->nb * WIDTHS_STEP) {
+                if(ln->nb >= capa) {
+                    capa = (capa ? capa * 2 : 4);
+                    nchecks = realloc(ln->checks,
+                            sizeof(struct _widths_check_t) * capa);
+                    if(!nchecks) {
+                        /* The line stays unknown : it starts over from an
+                         * empty index the next time.
+                         */
+                        free(ln->checks);
+                        ln->checks = NULL;
+                        ln->nb     = 0;
+                        return;
+                    }
+                    ln->checks = nchecks;
+                }
+                ln->checks[ln->nb].off = i;
+                ln->checks[ln->nb].col = col;
+                ++ln->nb;
+            }
+        }
+        col += (w < 0 ? -w : w);
+    }
+    ln->state = WIDTHS_INDEXED;
+    ln->width = col;
+}
+
+bool widths_simple(size_t id, const char* text, size_t len)
+{
+    struct _widths_line_t* ln = _widths_get(id);
+    if(!ln)
+        return false;
+    if(ln->state == WIDTHS_UNKNOWN)
+        _widths_index(ln, text, len);
+    return ln->state == WIDTHS_SIMPLE;
+}
+
+/* Find the first character displayed at column col or after it, starting
+ * from the character at offset off displayed at column c.
+ */
+static size_t _widths_scan(const char* text, size_t len, size_t off,
+        size_t c, size_t col, size_t* start)
+{
+    size_t l;
+    int w;
+
+    while(off < len) {
+        l = widths_char(text + off, len - off, c, &w);
+        if(c >= col && w != 0)
+            break;
+        c   += (w < 0 ? -w : w);
+        off += l;
+    }
+    *start = (c > col ? c : col);
+    return off;
+}
+
+size_t widths_total(size_t id, const char* text, size_t len)
+{
+    struct _widths_line_t* ln = _widths_get(id);
+    size_t i, l, col;
+    int w;
+
+    if(ln && ln->state == WIDTHS_UNKNOWN)
+        _widths_index(ln, text, len);
+    if(ln && ln->state != WIDTHS_UNKNOWN)
+        return ln->width;
+
+    /* The index couldn't be allocated. */
+    col = 0;
+    for(i = 0; i < len; i += l) {
+        l = widths_char(text + i, len - i, col, &w);
+        col += (w < 0 ? -w : w);
+    }
+    return col;
+}
+
+size_t widths_locate(size_t id, const char* text, size_t len,
+        size_t col, size_t* start)
+{
+    struct _widths_line_t* ln = _widths_get(id);
+    size_t k, off, c;
+
+    if(ln && ln->state == WIDTHS_UNKNOWN)
+        _widths_index(ln, text, len);
+    if(ln && ln->state == WIDTHS_SIMPLE) {
+        *start = col;
+        return (col < len ? col : len);
+    }
+
+    /* Start from the last checkpoint before col. */
+    off = 0;
+    c   = 0;
+    if(ln && ln->state == WIDTHS_INDEXED && ln->nb > 0) {
+        k = col / WIDTHS_STEP;
+        if(k >= ln->nb)
+            k = ln->nb - 1;
+        off = ln->checks[k].off;
+        c   = ln->checks[k].col;
+    }
+
+    return _widths_scan(text, len, off, c, col, start);
+}
+
+size_t widths_scan(const char* text, size_t len, size_t col, size_t* start)
+{
+    return _widths_scan(text, len, 0, 0, col, start);
+}
+
@@ -0,0 +1,59 @@
+
+#ifndef DEF_WIDTHS
+#define DEF_WIDTHS
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* The widths index is a side table of the feeder which gives, for the text of
+ * a line, the byte at which a display column starts. It keeps a checkpoint
+ * every WIDTHS_STEP columns, so that the part of a line shown in a window of
+ * columns is found by decoding at most WIDTHS_STEP columns of text. The lines
+ * made only of printable ASCII characters, for which a column is a byte, are
+ * only flagged. A line is indexed the first time it is needed.
+ */
+#define WIDTHS_STEP 32
+
+/* The tabulations move to the next multiple of WIDTHS_TAB columns. */
+#define WIDTHS_TAB 8
+
+/* Init and free the widths index. */
+bool widths_init();
+void widths_quit();
+
+/* Forget all the indexed lines. Must be called when the lines are cleared. */
+void widths_clear();
+
+/* Forget the index of a line which text has been replaced. */
+void widths_forget(size_t id);
+
+/* Decode the character at the beginning of str, which has len bytes and is
+ * displayed at column col. Returns its length in bytes and stores its width
+ * in w. The width is negative if the character can't be printed as is, in
+ * which case it must be replaced by -w replacement characters.
+ */
+size_t widths_char(const char* str, size_t len, size_t col, int* w);
+
+/* Indicates if the text of a line is only made of printable ASCII
+ * characters.
+ */
+bool widths_simple(size_t id, const char* text, size_t len);
+
+/* Get the number of columns the text of a line spans over. */
+size_t widths_total(size_t id, const char* text, size_t len);
+
+/* Find the first character of the text of a line displayed at column col or
+ * after it. Returns its offset in the text, and stores in start the column at
+ * which it is displayed : it is greater than col if a wide character spans
+ * over col. If the text is narrower than col, len is returned.
+ */
+size_t widths_locate(size_t id, const char* text, size_t len,
+        size_t col, size_t* start);
+
+/* Find the first character of a text displayed at column col or after it,
+ * like widths_locate, but without an index.
+ */
+size_t widths_scan(const char* text, size_t len, size_t col, size_t* start);
+
+#endif
+
@@ -0,0 +1,201 @@
+
+#include "wrap.h"
+#include <stdint.h>
+#include <string.h>
+
+/* The number of groups of lines : the lines of group k span over [2^k,
+ * 2^(k+1)) columns.
+ */
+#define WRAP_GROUPS 32
+
+/* The vids of the lines of a group. */
+struct _wrap_group_t {
+    size_t* vids;
+    size_t  nb;
+    size_t  capa;
+};
+
+/* The width at which the lines are wrapped. */
+static size_t   _wrap_width;
+/* The number of columns of the lines, by vid. */
+static uint32_t* _wrap_cols;
+/* The Fenwick tree of the numbers of rows : _wrap_tree[i] is the number of
+ * rows of the lines in [i - lowbit(i), i), i starting at 1.
+ */
+static size_t*  _wrap_tree;
+static size_t   _wrap_nb;
+static size_t   _wrap_capa;
+/* The groups of the lines spanning over more than one column. */
+static struct _wrap_group_t _wrap_groups[WRAP_GROUPS];
+
+bool wrap_init()
+{
+    _wrap_width = 1;
+    _wrap_cols  = NULL;
+    _wrap_tree  = NULL;
+    _wrap_nb    = 0;
+    _wrap_capa  = 0;
+    memset(_wrap_groups, 0, sizeof(_wrap_groups));
+    return true;
+}
+
+void wrap_quit()
+{
+    size_t k;
+    free(_wrap_cols);
+    free(_wrap_tree);
+    for(k = 0; k < WRAP_GROUPS; ++k)
+        free(_wrap_groups[k].vids);
+    wrap_init();
+}
+
+void wrap_clear(size_t width)
+{
+    size_t k;
+    _wrap_width = (width > 0 ? width : 1);
+    _wrap_nb    = 0;
+    for(k = 0; k < WRAP_GROUPS; ++k)
+        _wrap_groups[k].nb = 0;
+}
+
+/* Get the number of rows of a line of cols columns wrapped at width. */
+static size_t _wrap_rows(size_t cols, size_t width)
+{
+    if(cols <= width)
+        return 1;
+    return (cols + width - 1) / width;
+}
+
+/* Get the number of rows of the first n lines. */
+static size_t _wrap_prefix(size_t n)
+{
+    size_t sum = 0;
+    for(; n > 0; n &= n - 1)
+        sum += _wrap_tree[n];
+    return sum;
+}
+
+/* Add delta to the number of rows of a line. The unsigned overflow makes the
+ * negative deltas work.
+ */
+static void _wrap_add(size_t vid, size_t delta)
+{
+    size_t i;
+    for(i = vid + 1; i <= _wrap_nb; i += i & -i)
+        _wrap_tree[i] += delta;
+}
+
+/* Add a line to its group. */
+static bool _wrap_group_push(size_t vid, size_t cols)
+{
+    struct _wrap_group_t* g;
+    size_t* nvids;
+    size_t k;
+
+    if(cols < 2)
+        return true;
+    for(k = 0; k + 1 < WRAP_GROUPS && (cols >> (k + 1)) > 0; ++k);
+    g = &_wrap_groups[k];
+    if(g->nb >= g->capa) {
+        nvids = realloc(g->vids, sizeof(size_t) * (g->capa ? g->capa * 2 : 64));
+        if(!nvids)
+            return false;
+        g->vids = nvids;
+        g->capa = (g->capa ? g->capa * 2 : 64);
+    }
+    g->vids[g->nb++] = vid;
+    return true;
+}
+
+bool wrap_push(size_t cols)
+{
+    uint32_t* ncols;
+    size_t* ntree;
+    size_t ncapa, i;
+
+    if(_wrap_nb >= _wrap_capa) {
+        ncapa = (_wrap_capa ? _wrap_capa * 2 : 256);
+        ncols = realloc(_wrap_cols, sizeof(uint32_t) * ncapa);
+        if(!ncols)
+            return false;
+        _wrap_cols = ncols;
+        ntree = realloc(_wrap_tree, sizeof(size_t) * (ncapa + 1));
+        if(!ntree)
+            return false;
+        _wrap_tree = ntree;
+        _wrap_capa = ncapa;
+    }
+    if(cols > UINT32_MAX)
+        cols = UINT32_MAX;
+    if(!_wrap_group_push(_wrap_nb, cols))
+        return false;
+
+    /* The new node covers the lines in [i - lowbit(i), i). */
+    _wrap_cols[_wrap_nb] = cols;
+    i = ++_wrap_nb;
+    _wrap_tree[i] = _wrap_rows(cols, _wrap_width)
+        + _wrap_prefix(i - 1) - _wrap_prefix(i - (i & -i));
+    return true;
+}
+
+size_t wrap_count()
+{
+    return _wrap_nb;
+}
+
+void wrap_resize(size_t width)
+{
+    struct _wrap_group_t* g;
+    size_t k, i, least, before, after;
+
+    if(width == 0)
+        width = 1;
+    if(width == _wrap_width)
+        return;
+
+    /* The lines narrower than both widths keep one row. */
+    least = (width < _wrap_width ? width : _wrap_width);
+    for(k = 0; k < WRAP_GROUPS; ++k) {
+        if(((size_t)2 << k) - 1 <= least)
+            continue;
+        g = &_wrap_groups[k];
+        for(i = 0; i < g->nb; ++i) {
+            before = _wrap_rows(_wrap_cols[g->vids[i]], _wrap_width);
+            after  = _wrap_rows(_wrap_cols[g->vids[i]], width);
+            if(before != after)
+                _wrap_add(g->vids[i], after - before);
+        }
+    }
+    _wrap_width = width;
+}
+
+size_t wrap_rows(size_t vid)
+{
+    if(vid >= _wrap_nb)
+        return 1;
+    return _wrap_rows(_wrap_cols[vid], _wrap_width);
+}
+
+size_t wrap_row(size_t vid)
+{
+    if(vid >= _wrap_nb)
+        return _wrap_prefix(_wrap_nb) + vid - _wrap_nb;
+    return _wrap_prefix(vid);
+}
+
+size_t wrap_find(size_t row, size_t* skip)
+{
+    size_t pos, step;
+
+    /* Going down the tree from the largest power of two. */
+    for(step = 1; step * 2 <= _wrap_nb; step *= 2);
+    for(pos = 0; _wrap_nb > 0 && step > 0; step /= 2) {
+        if(pos + step <= _wrap_nb && _wrap_tree[pos + step] <= row) {
+            pos += step;
+            row -= _wrap_tree[pos];
+        }
+    }
+    *skip = row;
+    return pos;
+}
+
@@ -0,0 +1,50 @@
+
+#ifndef DEF_WRAP
+#define DEF_WRAP
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* The wrap index gives the number of rows the displayed lines span over when
+ * they are wrapped at the width of the screen, and the row at which each of
+ * them starts. The lines are refered to by their index among the displayed
+ * ones (their vid). The numbers of rows are kept in a Fenwick tree, so that
+ * both the row of a line and the line at a row are found in O(log n). The
+ * number of columns of each line is kept too, and the lines are grouped by
+ * their order of magnitude, so that when the width changes only the lines
+ * wide enough for their number of rows to change are updated.
+ */
+
+/* Init and free the wrap index. */
+bool wrap_init();
+void wrap_quit();
+
+/* Forget all the lines, and set the width at which they are wrapped. */
+void wrap_clear(size_t width);
+
+/* Add a line spanning over cols columns after the last one. Returns false if
+ * the allocation failed.
+ */
+bool wrap_push(size_t cols);
+
+/* Get the number of lines in the index. */
+size_t wrap_count();
+
+/* Change the width at which the lines are wrapped. */
+void wrap_resize(size_t width);
+
+/* Get the number of rows of a line. The lines after the last one are counted
+ * as one row.
+ */
+size_t wrap_rows(size_t vid);
+
+/* Get the row at which a line starts. */
+size_t wrap_row(size_t vid);
+
+/* Get the line displayed at a row, and store in skip the number of rows of
+ * the line before it. Returns wrap_count() if the row is after the last line.
+ */
+size_t wrap_find(size_t row, size_t* skip);
+
+#endif
+
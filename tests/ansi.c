@@ -0,0 +1,111 @@
+
+#include "ansi.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TESTS_BOLD_RED  (ANSI_BOLD | 1 | (ANSI_DEFAULT << 4))
+#define TESTS_RED       (1 | (ANSI_DEFAULT << 4))
+#define TESTS_GREEN     (2 | (ANSI_DEFAULT << 4))
+#define TESTS_BOLD      (ANSI_BOLD | ANSI_PLAIN)
+
+/* A text to parse, and the plain text and runs expected. */
+struct _tests_case_t {
+    const char* what;
+    const char* text;
+    const char* plain;
+    size_t nb;
+    ansi_run_t runs[4];
+};
+
+static const struct _tests_case_t _tests_cases[] = {
+    { "no sequence", "plain", "plain", 0, { { 0, 0 } } },
+    { "strip", "a\033[31mb\033[0mc", "abc", 2,
+        { { 1, TESTS_RED }, { 2, ANSI_PLAIN } } },
+    { "params", "\033[1;31mab", "ab", 1, { { 0, TESTS_BOLD_RED } } },
+    { "same offset", "a\033[31m\033[32mb\033[39mc", "abc", 2,
+        { { 1, TESTS_GREEN }, { 2, ANSI_PLAIN } } },
+    { "unchanged", "a\033[31mb\033[31mc", "abc", 1, { { 1, TESTS_RED } } },
+    { "trailing run", "ab\033[31m", "ab", 0, { { 0, 0 } } },
+    { "trailing reset", "\033[31mab\033[0m", "ab", 1,
+        { { 0, TESTS_RED } } },
+    { "all plain", "\033[1m\033[0mab", "ab", 0, { { 0, 0 } } },
+    { "empty reset", "\033[1ma\033[mb", "ab", 2,
+        { { 0, TESTS_BOLD }, { 1, ANSI_PLAIN } } },
+    { "256 colors", "\033[1;38;5;4;7mab", "ab", 1, { { 0, TESTS_BOLD } } },
+    { "true colors", "a\033[48;2;1;2;3mb", "ab", 0, { { 0, 0 } } },
+    { "bright", "\033[91ma", "a", 1, { { 0, TESTS_BOLD_RED } } },
+    { "not sgr", "a\033[2Kb\033[3Ac", "abc", 0, { { 0, 0 } } },
+    { "cut csi", "ab\033[1;3", "ab", 0, { { 0, 0 } } },
+    { "cut after run", "\033[31mab\033[1", "ab", 1, { { 0, TESTS_RED } } },
+    { "lone escape", "ab\033", "ab", 0, { { 0, 0 } } },
+    { "charset", "a\033(Bb\033)0c", "abc", 0, { { 0, 0 } } },
+    { "two bytes", "a\033Mb\033=c", "abc", 0, { { 0, 0 } } },
+    { "cut charset", "ab\033(", "ab", 0, { { 0, 0 } } },
+};
+#define TESTS_CASES (sizeof(_tests_cases) / sizeof(_tests_cases[0]))
+
+static unsigned long _tests_checks;
+static unsigned long _tests_failures;
+
+static void _tests_check(bool ok, const char* what, const char* detail)
+{
+    ++_tests_checks;
+    if(ok)
+        return;
+    ++_tests_failures;
+    printf("FAIL %s : %s\n", what, detail);
+}
+
+static void _tests_parse(const struct _tests_case_t* c)
+{
+    char text[64];
+    ansi_run_t runs[16];
+    size_t len, nb, i;
+    bool same;
+
+    len = strlen(c->text);
+    memcpy(text, c->text, len);
+    _tests_check(ansi_max_runs(text, len) <= 16, c->what, "max runs");
+    len = ansi_parse(text, len, runs, &nb);
+
+    _tests_check(len == strlen(c->plain), c->what, "length");
+    _tests_check(len == strlen(c->plain)
+            && memcmp(text, c->plain, len) == 0, c->what, "text");
+    same = (nb == c->nb);
+    for(i = 0; same && i < nb; ++i) {
+        same = runs[i].off == c->runs[i].off
+            && runs[i].attr == c->runs[i].attr;
+    }
+    _tests_check(same, c->what, "runs");
+}
+
+static void _tests_find()
+{
+    ansi_run_t runs[3] = { { 2, TESTS_RED }, { 5, TESTS_GREEN },
+        { 9, ANSI_PLAIN } };
+
+    _tests_check(ansi_find(runs, 0, 0) == 0, "find", "no run");
+    _tests_check(ansi_find(runs, 3, 0) == 3, "find", "before the first run");
+    _tests_check(ansi_find(runs, 3, 1) == 3, "find", "just before");
+    _tests_check(ansi_find(runs, 3, 2) == 0, "find", "at the first run");
+    _tests_check(ansi_find(runs, 3, 4) == 0, "find", "in the first run");
+    _tests_check(ansi_find(runs, 3, 5) == 1, "find", "at the second run");
+    _tests_check(ansi_find(runs, 3, 8) == 1, "find", "in the second run");
+    _tests_check(ansi_find(runs, 3, 9) == 2, "find", "at the last run");
+    _tests_check(ansi_find(runs, 3, 100) == 2, "find", "after the last run");
+    _tests_check(ansi_find(runs, 1, 7) == 0, "find", "a single run");
+}
+
+int main()
+{
+    size_t i;
+
+    for(i = 0; i < TESTS_CASES; ++i)
+        _tests_parse(&_tests_cases[i]);
+    _tests_find();
+
+    printf("ansi : %lu checks, %lu failures.\n",
+            _tests_checks, _tests_failures);
+    return (_tests_failures == 0 ? 0 : 1);
+}
+
@@ -0,0 +1,193 @@
+
+#include "columns.h"
+#include "fields.h"
+#include <stdio.h>
+#include <string.h>
+#include <locale.h>
+
+#define TESTS_RED (1 | (ANSI_DEFAULT << 4))
+
+static unsigned long _tests_checks;
+static unsigned long _tests_failures;
+
+static void _tests_check(bool ok, const char* what)
+{
+    ++_tests_checks;
+    if(ok)
+        return;
+    ++_tests_failures;
+    printf("FAIL %s\n", what);
+}
+
+/* Index lines of fields, all displayed. */
+static void _tests_lines(size_t nb, const char** lines, size_t nbfields)
+{
+    size_t i;
+    fields_set(nbfields, false);
+    for(i = 0; i < nb; ++i) {
+        if(!fields_add(i, lines[i], strlen(lines[i])))
+            _tests_check(false, "add");
+    }
+}
+
+/* Lay out a line and compare it to the text expected. */
+static void _tests_layout(const char* what, size_t id, const char* text,
+        const ansi_run_t* runs, size_t nbruns, const char* expected)
+{
+    const ansi_run_t* oruns;
+    const char* out;
+    size_t olen, onbruns;
+
+    out = columns_layout(id, text, strlen(text), runs, nbruns,
+            &olen, &oruns, &onbruns);
+    _tests_check(out && olen == strlen(expected)
+            && memcmp(out, expected, olen) == 0, what);
+    if(out && (olen != strlen(expected) || memcmp(out, expected, olen) != 0))
+        printf("     got \"%.*s\", expected \"%s\"\n", (int)olen, out,
+                expected);
+}
+
+/* The fields cut before a wide character which would cross their width. */
+static void _tests_ellipsis()
+{
+    const char* lines[] = {
+        "ab\xe6\xbc\xa2\xe5\xad\x97\tx",  /* "ab" and two wide characters. */
+        "a\xe6\xbc\xa2\xe5\xad\x97\tx",   /* "a" and two wide characters. */
+        "ab\xe6\xbc\xa2\tx",              /* "ab" and one wide character. */
+        "abcdef\tx",
+    };
+    size_t widths[1];
+
+    _tests_lines(4, lines, 2);
+
+    /* The wide character would end after the last column : the ellipsis
+     * takes its place, and the padding makes up for the missing column.
+     */
+    widths[0] = 4;
+    columns_set(COLUMNS_DEFAULT_MAX, widths, 1);
+    columns_update();
+    _tests_check(columns_width(0) == 4 + COLUMNS_GAP + 1, "width");
+    _tests_layout("ellipsis after ab", 0, lines[0], NULL, 0,
+            "ab\xe2\x80\xa6   x");
+    _tests_layout("ellipsis after a wide character", 1, lines[1], NULL, 0,
+            "a\xe6\xbc\xa2\xe2\x80\xa6  x");
+    _tests_layout("exact fit", 2, lines[2], NULL, 0,
+            "ab\xe6\xbc\xa2  x");
+
+    widths[0] = 3;
+    columns_set(COLUMNS_DEFAULT_MAX, widths, 1);
+    columns_update();
+    _tests_layout("wide character crossing the width", 2, lines[2], NULL, 0,
+            "ab\xe2\x80\xa6  x");
+    _tests_layout("ascii cut", 3, lines[3], NULL, 0,
+            "ab\xe2\x80\xa6  x");
+
+    widths[0] = 1;
+    columns_set(COLUMNS_DEFAULT_MAX, widths, 1);
+    columns_update();
+    _tests_layout("only the ellipsis", 1, lines[1], NULL, 0,
+            "\xe2\x80\xa6  x");
+}
+
+/* The columns are as wide as their widest field, up to the maximum. */
+static void _tests_padding()
+{
+    const char* lines[] = {
+        "a\tbbb\tlast",
+        "aaaa\tb\tend",
+        "aa\t\t",
+    };
+
+    _tests_lines(3, lines, 3);
+    columns_set(COLUMNS_DEFAULT_MAX, NULL, 0);
+    columns_update();
+    _tests_layout("padding 0", 0, lines[0], NULL, 0, "a     bbb  last");
+    _tests_layout("padding 1", 1, lines[1], NULL, 0, "aaaa  b    end");
+    _tests_layout("padding 2", 2, lines[2], NULL, 0, "aa         ");
+
+    columns_set(3, NULL, 0);
+    _tests_check(columns_update(), "update");
+    _tests_layout("padding max", 1, lines[1], NULL, 0, "aa\xe2\x80\xa6  b    end");
+    _tests_check(!columns_update(), "no update");
+}
+
+/* The runs follow the text of the fields, the padding is plain. */
+static void _tests_runs()
+{
+    const char* lines[] = { "ab\tcd" };
+    ansi_run_t runs[2] = { { 1, TESTS_RED }, { 4, ANSI_PLAIN } };
+    const ansi_run_t* oruns;
+    size_t widths[1] = { 3 };
+    size_t olen, onbruns;
+
+    _tests_lines(1, lines, 2);
+    columns_set(COLUMNS_DEFAULT_MAX, widths, 1);
+    columns_update();
+    _tests_layout("runs text", 0, lines[0], runs, 2, "ab   cd");
+    columns_layout(0, lines[0], strlen(lines[0]), runs, 2,
+            &olen, &oruns, &onbruns);
+    _tests_check(onbruns == 4
+            && oruns[0].off == 1 && oruns[0].attr == TESTS_RED
+            && oruns[1].off == 2 && oruns[1].attr == ANSI_PLAIN
+            && oruns[2].off == 5 && oruns[2].attr == TESTS_RED
+            && oruns[3].off == 6 && oruns[3].attr == ANSI_PLAIN, "runs");
+
+    /* The ellipsis has the attribute of the character it replaces. */
+    widths[0] = 1;
+    columns_set(COLUMNS_DEFAULT_MAX, widths, 1);
+    columns_update();
+    columns_layout(0, lines[0], strlen(lines[0]), runs, 2,
+            &olen, &oruns, &onbruns);
+    _tests_check(onbruns == 4
+            && oruns[0].off == 0 && oruns[0].attr == TESTS_RED
+            && oruns[1].off == 3 && oruns[1].attr == ANSI_PLAIN, "cut runs");
+}
+
+/* The maximum width follows the lines hidden, shown and replaced. */
+static void _tests_show()
+{
+    const char* lines[] = { "aaaaa", "aaa", "aaaaaaa", "a" };
+
+    _tests_lines(4, lines, 1);
+    _tests_check(fields_width_max(1) == 7, "max");
+    fields_show(2, false);
+    _tests_check(fields_width_max(1) == 5, "max hidden");
+    fields_show(2, false);
+    _tests_check(fields_width_max(1) == 5, "max hidden twice");
+    fields_replace(0, "aa", 2);
+    _tests_check(fields_width_max(1) == 3, "max replaced");
+    fields_replace(2, "aaaaaaaaa", 9);
+    _tests_check(fields_width_max(1) == 3, "max hidden replaced");
+    fields_show(2, true);
+    _tests_check(fields_width_max(1) == 9, "max shown");
+    fields_show(1, false);
+    fields_show(2, false);
+    _tests_check(fields_width_max(1) == 2, "max after hiding");
+    fields_show(0, false);
+    fields_show(3, false);
+    _tests_check(fields_width_max(1) == 0, "max all hidden");
+    fields_show(1, true);
+    _tests_check(fields_width_max(1) == 3, "max shown again");
+}
+
+int main()
+{
+    if(!setlocale(LC_ALL, "C.UTF-8") && !setlocale(LC_ALL, "en_US.UTF-8")) {
+        printf("No UTF-8 locale.\n");
+        return 1;
+    }
+    fields_init();
+    columns_init();
+
+    _tests_ellipsis();
+    _tests_padding();
+    _tests_runs();
+    _tests_show();
+
+    columns_quit();
+    fields_quit();
+    printf("columns : %lu checks, %lu failures.\n",
+            _tests_checks, _tests_failures);
+    return (_tests_failures == 0 ? 0 : 1);
+}
+
@@ -0,0 +1,336 @@
+
+#include "filter.h"
+#include "strmatch.h"
+#include "fields.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <regex.h>
+
+/* The number of lines filtered, more than a batch of the program. */
+#define TESTS_LINES 1000
+/* The longest line generated. */
+#define TESTS_LEN   32
+
+/* The pieces of the fields : numbers, and strings sharing prefixes and
+ * suffixes.
+ */
+static const char* _tests_pieces[] = {
+    "0", "1", "5", "10", "-2", "2.5", "ab", "abc", "xab", "b", "", " "
+};
+#define TESTS_PIECES (sizeof(_tests_pieces) / sizeof(_tests_pieces[0]))
+
+static char   _tests_lines[TESTS_LINES][TESTS_LEN];
+static const char* _tests_texts[TESTS_LINES];
+static size_t _tests_lens[TESTS_LINES];
+
+static unsigned long _tests_checks;
+static unsigned long _tests_failures;
+
+/* A xorshift generator, so that the runs are reproducible. */
+static uint64_t _tests_state = 88172645463325252ULL;
+static size_t _tests_rand(size_t nb)
+{
+    _tests_state ^= _tests_state << 13;
+    _tests_state ^= _tests_state >> 7;
+    _tests_state ^= _tests_state << 17;
+    return (size_t)(_tests_state % nb);
+}
+
+/* Fill a line with three fields of one or two pieces. */
+static void _tests_line(size_t id)
+{
+    char* line = _tests_lines[id];
+    size_t k, n;
+
+    line[0] = '\0';
+    for(k = 0; k < 3; ++k) {
+        for(n = 1 + _tests_rand(2); n > 0; --n)
+            strcat(line, _tests_pieces[_tests_rand(TESTS_PIECES)]);
+        if(k < 2)
+            strcat(line, "\t");
+    }
+    _tests_texts[id] = line;
+    _tests_lens[id]  = strlen(line);
+}
+
+/********************* Direct evaluation *************************************/
+/* The field k of a line, 0-terminated in a static buffer. The field 0 is the
+ * whole line.
+ */
+static const char* _tests_str(const char* line, size_t k)
+{
+    static char buffers[4][TESTS_LEN];
+    static size_t next;
+    char* buffer = buffers[next++ % 4];
+    const char* end;
+
+    for(; k > 1 && line; --k) {
+        line = strchr(line, '\t');
+        if(line)
+            ++line;
+    }
+    if(!line)
+        line = "";
+    end = (k > 0 ? strchr(line, '\t') : NULL);
+    if(!end)
+        end = line + strlen(line);
+    memcpy(buffer, line, end - line);
+    buffer[end - line] = '\0';
+    return buffer;
+}
+
+/* The number of a field : the whole field but spaces must be a number. */
+static double _tests_num(const char* line, size_t k)
+{
+    const char* str = _tests_str(line, k);
+    char* end;
+    double d;
+
+    while(isspace((unsigned char)*str))
+        ++str;
+    d = strtod(str, &end);
+    if(*str == '\0' || end == str)
+        return NAN;
+    while(isspace((unsigned char)*end))
+        ++end;
+    return (*end == '\0' ? d : NAN);
+}
+
+/* Does the field k match the extended regular expression re. */
+static bool _tests_re(const char* line, size_t k, const char* re)
+{
+    regex_t r;
+    bool ret;
+    if(regcomp(&r, re, REG_EXTENDED | REG_NOSUB) != 0)
+        return false;
+    ret = (regexec(&r, _tests_str(line, k), 0, NULL, 0) == 0);
+    regfree(&r);
+    return ret;
+}
+
+/* The comparison of two fields : numeric if both are numbers. */
+static int _tests_cmp_fields(const char* line, size_t k1, size_t k2)
+{
+    double a = _tests_num(line, k1);
+    double b = _tests_num(line, k2);
+    if(isnan(a) || isnan(b))
+        return strcmp(_tests_str(line, k1), _tests_str(line, k2));
+    return (a > b) - (a < b);
+}
+
+/* The truth of a field alone : a number is true if it isn't 0, a string if it
+ * isn't empty.
+ */
+static bool _tests_truth(const char* line, size_t k)
+{
+    double d = _tests_num(line, k);
+    if(isnan(d))
+        return _tests_str(line, k)[0] != '\0';
+    return d != 0;
+}
+
+#define N(k) _tests_num(line, k)
+#define S(k) _tests_str(line, k)
+
+static bool _ref_gt(const char* line) { return N(1) > 5; }
+static bool _ref_ne(const char* line) { return N(1) != 5 && !isnan(N(1)); }
+static bool _ref_prec(const char* line)
+{
+    return N(1) > 5 || (N(2) < 0 && strcmp(S(3), "ab") == 0);
+}
+static bool _ref_paren(const char* line)
+{
+    return (N(1) > 5 || N(2) < 0) && strcmp(S(3), "ab") == 0;
+}
+static bool _ref_not(const char* line) { return !(N(1) > 1); }
+static bool _ref_not_or(const char* line)
+{
+    return !(N(1) > 1 || N(2) > 1) && _tests_re(line, 3, "b");
+}
+static bool _ref_not_not(const char* line) { return !!_tests_truth(line, 3); }
+static bool _ref_search(const char* line) { return _tests_re(line, 3, "ab"); }
+static bool _ref_prefix(const char* line) { return _tests_re(line, 3, "^ab"); }
+static bool _ref_suffix(const char* line) { return _tests_re(line, 3, "ab$"); }
+static bool _ref_exact(const char* line) { return _tests_re(line, 3, "^ab$"); }
+static bool _ref_regex(const char* line) { return _tests_re(line, 2, "^a.c"); }
+static bool _ref_nregex(const char* line)
+{
+    return !_tests_re(line, 1, "b|x");
+}
+static bool _ref_nprefix(const char* line)
+{
+    return !_tests_re(line, 1, "^x");
+}
+static bool _ref_fields(const char* line)
+{
+    return _tests_cmp_fields(line, 1, 2) < 0;
+}
+static bool _ref_fields_eq(const char* line)
+{
+    return _tests_cmp_fields(line, 2, 3) == 0;
+}
+static bool _ref_str(const char* line) { return strcmp(S(3), "ab") >= 0; }
+static bool _ref_str_num(const char* line) { return strcmp(S(1), "5") < 0; }
+static bool _ref_all(const char* line) { return _tests_re(line, 0, "b\t"); }
+static bool _ref_all_cmp(const char* line) { return strcmp(S(0), "5") > 0; }
+static bool _ref_arith(const char* line) { return N(1) + N(2) * 2 > 10; }
+static bool _ref_neg(const char* line) { return -N(1) / 2 < -N(2) - 1; }
+static bool _ref_truth(const char* line)
+{
+    return _tests_truth(line, 3) && _tests_truth(line, 1);
+}
+
+/* The expressions and their direct evaluation. */
+struct _tests_expr_t {
+    const char* expr;
+    bool (*ref)(const char* line);
+};
+static const struct _tests_expr_t _tests_exprs[] = {
+    { "$1 > 5",                              &_ref_gt },
+    { "$1 != 5",                             &_ref_ne },
+    { "$1 > 5 || $2 < 0 && $3 == \"ab\"",    &_ref_prec },
+    { "($1 > 5 || $2 < 0) && $3 == \"ab\"",  &_ref_paren },
+    { "!$1 > 1",                             &_ref_not },
+    { "!($1 > 1 || $2 > 1) && $3 ~ \"b\"",   &_ref_not_or },
+    { "!!$3",                                &_ref_not_not },
+    { "$3 ~ \"ab\"",                         &_ref_search },
+    { "$3 ~ \"^ab\"",                        &_ref_prefix },
+    { "$3 ~ \"ab$\"",                        &_ref_suffix },
+    { "$3 ~ \"^ab$\"",                       &_ref_exact },
+    { "$2 ~ \"^a.c\"",                       &_ref_regex },
+    { "$1 !~ \"b|x\"",                       &_ref_nregex },
+    { "$1 !~ \"^x\"",                        &_ref_nprefix },
+    { "$1 < $2",                             &_ref_fields },
+    { "$2 == $3",                            &_ref_fields_eq },
+    { "$3 >= \"ab\"",                        &_ref_str },
+    { "$1 < \"5\"",                          &_ref_str_num },
+    { "$0 ~ \"b\t\"",                        &_ref_all },
+    { "$0 > \"5\"",                          &_ref_all_cmp },
+    { "$1 + $2 * 2 > 10",                    &_ref_arith },
+    { "-$1 / 2 < -$2 - 1",                   &_ref_neg },
+    { "$3 && $1",                            &_ref_truth },
+};
+#define TESTS_EXPRS (sizeof(_tests_exprs) / sizeof(_tests_exprs[0]))
+
+/* The expressions which must not compile, the last one too deep for the
+ * stack.
+ */
+static const char* _tests_malformed[] = {
+    "$", "$x", "$100", "$1 >", "> 1", "($1 > 1", "$1 > 1)", "$1 ~ ab",
+    "$1 ~ \"ab", "$1 ~ \"(\"", "\"ab\" + 1", "$1 > 1 &&", "|| $1", "!",
+    "$1 $2", "1 2", "$1 ~ \"a\" ~ \"b\"", "-\"a\"", "@",
+    "1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+"
+        "(1+(1+(1+(1+(1+(1+(1+(1+(1+1))))))))))))))))))))))))))))))))"
+};
+#define TESTS_MALFORMED (sizeof(_tests_malformed) / sizeof(_tests_malformed[0]))
+
+/********************* Checks ************************************************/
+/* Evaluate the filter over all the lines, starting at an odd id so that the
+ * batches don't start on the lines, and compare it to the reference.
+ */
+static void _tests_eval(const struct _tests_expr_t* ex, const char* what)
+{
+    static bool out[TESTS_LINES];
+    size_t i, first;
+
+    first = 1 + _tests_rand(300);
+    filter_eval(0, first, _tests_texts, _tests_lens, out);
+    filter_eval(first, TESTS_LINES - first, _tests_texts + first,
+            _tests_lens + first, out + first);
+    for(i = 0; i < TESTS_LINES; ++i) {
+        ++_tests_checks;
+        if(out[i] == ex->ref(_tests_lines[i]))
+            continue;
+        ++_tests_failures;
+        if(_tests_failures <= 20)
+            printf("FAIL %s '%s' : line \"%s\" gives %d\n", what, ex->expr,
+                    _tests_lines[i], out[i]);
+    }
+}
+
+static void _tests_run(const char* what)
+{
+    size_t e, i, id;
+
+    for(e = 0; e < TESTS_EXPRS; ++e) {
+        ++_tests_checks;
+        if(!filter_set(_tests_exprs[e].expr)) {
+            ++_tests_failures;
+            printf("FAIL %s : '%s' doesn't compile\n", what,
+                    _tests_exprs[e].expr);
+            continue;
+        }
+        _tests_eval(&_tests_exprs[e], what);
+
+        /* The numbers cached for the replaced lines are updated. */
+        for(i = 0; i < 20; ++i) {
+            id = _tests_rand(TESTS_LINES);
+            _tests_line(id);
+            fields_replace(id, _tests_texts[id], _tests_lens[id]);
+            filter_replace(id, _tests_texts[id], _tests_lens[id]);
+        }
+        _tests_eval(&_tests_exprs[e], what);
+    }
+}
+
+static void _tests_errors()
+{
+    static bool out[TESTS_LINES];
+    size_t i, n;
+
+    filter_set(_tests_exprs[0].expr);
+    for(i = 0; i < TESTS_MALFORMED; ++i) {
+        ++_tests_checks;
+        if(!filter_set(_tests_malformed[i]))
+            continue;
+        ++_tests_failures;
+        printf("FAIL malformed '%s' compiles\n", _tests_malformed[i]);
+        filter_set(_tests_exprs[0].expr);
+    }
+
+    /* The previous filter is kept. */
+    ++_tests_checks;
+    _tests_eval(&_tests_exprs[0], "kept");
+
+    /* Without a filter, all the lines match. */
+    filter_set(NULL);
+    filter_eval(0, TESTS_LINES, _tests_texts, _tests_lens, out);
+    for(i = 0, n = 0; i < TESTS_LINES; ++i)
+        n += out[i];
+    ++_tests_checks;
+    if(filter_enabled() || n != TESTS_LINES) {
+        ++_tests_failures;
+        printf("FAIL no filter\n");
+    }
+}
+
+int main()
+{
+    size_t id;
+
+    strmatch_init();
+    fields_init();
+    filter_init();
+    for(id = 0; id < TESTS_LINES; ++id)
+        _tests_line(id);
+
+    /* The fields are split from the texts, then read from the index. */
+    _tests_run("split");
+    filter_clear();
+    fields_set(3, true);
+    for(id = 0; id < TESTS_LINES; ++id)
+        fields_add(id, _tests_texts[id], _tests_lens[id]);
+    _tests_run("indexed");
+    _tests_errors();
+
+    filter_quit();
+    fields_quit();
+    printf("filter : %lu checks, %lu failures.\n",
+            _tests_checks, _tests_failures);
+    return (_tests_failures == 0 ? 0 : 1);
+}
+
@@ -0,0 +1,253 @@
+
+#include "sort.h"
+#include "fields.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+/* The number of lines of the small and of the parallel sorts. */
+#define TESTS_SMALL 3000
+#define TESTS_LARGE 70000
+/* The longest line generated. */
+#define TESTS_LEN   32
+
+/* The specifications checked, and their keys for the reference. */
+struct _tests_key_t {
+    size_t field;
+    int type; /* 0 bytes, 1 numeric, 2 natural. */
+    bool reverse;
+};
+struct _tests_spec_t {
+    const char* spec;
+    size_t nb;
+    struct _tests_key_t keys[2];
+};
+static const struct _tests_spec_t _tests_specs[] = {
+    { "",                        1, { { 0, 0, false } } },
+    { "1",                       1, { { 1, 0, false } } },
+    { "1 reverse",               1, { { 1, 0, true } } },
+    { "1 natural",               1, { { 1, 2, false } } },
+    { "1 natural reverse",       1, { { 1, 2, true } } },
+    { "2 numeric",               1, { { 2, 1, false } } },
+    { "2 numeric reverse",       1, { { 2, 1, true } } },
+    { "2 numeric reverse,1",     2, { { 2, 1, true }, { 1, 0, false } } },
+    { "3 natural,2 numeric",     2, { { 3, 2, false }, { 2, 1, false } } },
+};
+#define TESTS_SPECS (sizeof(_tests_specs) / sizeof(_tests_specs[0]))
+
+/* The pieces of the fields : digits with leading zeros, letters and numbers
+ * which aren't.
+ */
+static const char* _tests_pieces[] = {
+    "0", "00", "7", "07", "007", "10", "010", "9", "f", "x", "-", ".", "1e2",
+    "abc", "", "nan"
+};
+#define TESTS_PIECES (sizeof(_tests_pieces) / sizeof(_tests_pieces[0]))
+
+static char   _tests_lines[TESTS_LARGE][TESTS_LEN];
+static size_t _tests_nb;
+static const struct _tests_spec_t* _tests_spec;
+
+static unsigned long _tests_checks;
+static unsigned long _tests_failures;
+
+/* A xorshift generator, so that the runs are reproducible. */
+static uint64_t _tests_state = 88172645463325252ULL;
+static size_t _tests_rand(size_t nb)
+{
+    _tests_state ^= _tests_state << 13;
+    _tests_state ^= _tests_state >> 7;
+    _tests_state ^= _tests_state << 17;
+    return (size_t)(_tests_state % nb);
+}
+
+/* Fill the lines with three fields of random pieces. Few pieces are used so
+ * that many lines are equal.
+ */
+static void _tests_fill(size_t nb)
+{
+    size_t id, k, n;
+    char* line;
+
+    for(id = 0; id < nb; ++id) {
+        line = _tests_lines[id];
+        line[0] = '\0';
+        for(k = 0; k < 3; ++k) {
+            for(n = _tests_rand(3); n > 0; --n)
+                strcat(line, _tests_pieces[_tests_rand(TESTS_PIECES)]);
+            if(k < 2)
+                strcat(line, "\t");
+        }
+    }
+    _tests_nb = nb;
+}
+
+static const char* _tests_text(size_t id, size_t* len)
+{
+    *len = strlen(_tests_lines[id]);
+    return _tests_lines[id];
+}
+
+/* The reference natural comparison : the numbers are compared once their
+ * leading zeros are removed, by length first.
+ */
+static int _tests_natural(const char* a, size_t la, const char* b, size_t lb)
+{
+    size_t i = 0, j = 0, ei, ej;
+
+    for(;;) {
+        if(i == la || j == lb)
+            return (i < la) - (j < lb);
+        if(a[i] >= '0' && a[i] <= '9' && b[j] >= '0' && b[j] <= '9') {
+            while(i < la && a[i] == '0')
+                ++i;
+            while(j < lb && b[j] == '0')
+                ++j;
+            for(ei = i; ei < la && a[ei] >= '0' && a[ei] <= '9'; ++ei);
+            for(ej = j; ej < lb && b[ej] >= '0' && b[ej] <= '9'; ++ej);
+            if(ei - i != ej - j)
+                return (ei - i > ej - j ? 1 : -1);
+            for(; i < ei; ++i, ++j) {
+                if(a[i] != b[j])
+                    return (a[i] > b[j] ? 1 : -1);
+            }
+            continue;
+        }
+        if(a[i] != b[j])
+            return ((unsigned char)a[i] > (unsigned char)b[j] ? 1 : -1);
+        ++i;
+        ++j;
+    }
+}
+
+/* The reference comparison of two lines, by id. */
+static int _tests_cmp(const void* pa, const void* pb)
+{
+    const struct _tests_key_t* key;
+    size_t a = *(const size_t*)pa;
+    size_t b = *(const size_t*)pb;
+    size_t oa, la, ob, lb, k, l;
+    double na, nb;
+    int cmp;
+
+    for(k = 0; k < _tests_spec->nb; ++k) {
+        key = &_tests_spec->keys[k];
+        fields_split(_tests_lines[a], strlen(_tests_lines[a]), key->field,
+                &oa, &la);
+        fields_split(_tests_lines[b], strlen(_tests_lines[b]), key->field,
+                &ob, &lb);
+        if(key->type == 1) {
+            /* The lines which aren't numbers go last, even reversed. */
+            na = fields_parse_num(_tests_lines[a] + oa, la);
+            nb = fields_parse_num(_tests_lines[b] + ob, lb);
+            if(isnan(na) != isnan(nb))
+                return (isnan(na) ? 1 : -1);
+            cmp = (isnan(na) ? 0 : (na > nb) - (na < nb));
+        }
+        else if(key->type == 2)
+            cmp = _tests_natural(_tests_lines[a] + oa, la,
+                    _tests_lines[b] + ob, lb);
+        else {
+            l   = (la < lb ? la : lb);
+            cmp = memcmp(_tests_lines[a] + oa, _tests_lines[b] + ob, l);
+            if(cmp == 0)
+                cmp = (la > lb) - (la < lb);
+            cmp = (cmp > 0) - (cmp < 0);
+        }
+        if(key->reverse)
+            cmp = -cmp;
+        if(cmp != 0)
+            return cmp;
+    }
+    return (a > b) - (a < b);
+}
+
+/* The ids given to the first callback, checked against the reference. */
+static size_t* _tests_ref;
+static size_t  _tests_firsts;
+
+static void _tests_first(size_t* order, size_t nb)
+{
+    ++_tests_firsts;
+    ++_tests_checks;
+    if(memcmp(order, _tests_ref, sizeof(size_t) * nb) != 0) {
+        ++_tests_failures;
+        printf("FAIL first lines of \"%s\"\n", _tests_spec->spec);
+    }
+}
+
+/* Sort the lines with each specification and compare them to qsort. */
+static void _tests_run(size_t first)
+{
+    size_t* order;
+    size_t i, s, bad;
+    sort_t* sort;
+
+    order      = malloc(sizeof(size_t) * _tests_nb);
+    _tests_ref = malloc(sizeof(size_t) * _tests_nb);
+    for(s = 0; s < TESTS_SPECS; ++s) {
+        _tests_spec = &_tests_specs[s];
+        for(i = 0; i < _tests_nb; ++i)
+            _tests_ref[i] = i;
+        qsort(_tests_ref, _tests_nb, sizeof(size_t), &_tests_cmp);
+
+        sort = sort_parse(_tests_spec->spec);
+        if(!sort) {
+            ++_tests_failures;
+            printf("FAIL parse \"%s\"\n", _tests_spec->spec);
+            continue;
+        }
+        sort_set_first(sort, first, &_tests_first);
+        ++_tests_checks;
+        if(!sort_run(sort, _tests_nb, &_tests_text, order)) {
+            ++_tests_failures;
+            printf("FAIL run \"%s\"\n", _tests_spec->spec);
+            sort_destroy(sort);
+            continue;
+        }
+        sort_destroy(sort);
+
+        for(bad = 0; bad < _tests_nb && order[bad] == _tests_ref[bad]; ++bad);
+        ++_tests_checks;
+        if(bad < _tests_nb) {
+            ++_tests_failures;
+            printf("FAIL \"%s\" on %lu lines : position %lu has line %lu "
+                    "instead of %lu\n", _tests_spec->spec, _tests_nb, bad,
+                    order[bad], _tests_ref[bad]);
+        }
+    }
+    free(order);
+    free(_tests_ref);
+}
+
+int main()
+{
+    size_t threads;
+
+    fields_init();
+
+    _tests_fill(TESTS_SMALL);
+    _tests_run(0);
+    _tests_run(25);
+    _tests_run(TESTS_SMALL);
+
+    /* The chunks of the threads are merged, with an odd one left over. */
+    _tests_fill(TESTS_LARGE);
+    for(threads = 1; threads <= 4; ++threads) {
+        sort_set_threads(threads);
+        _tests_run(threads == 3 ? 40 : 0);
+    }
+
+    ++_tests_checks;
+    if(_tests_firsts != 2 * TESTS_SPECS) {
+        ++_tests_failures;
+        printf("FAIL first called %lu times\n", _tests_firsts);
+    }
+
+    fields_quit();
+    printf("sort : %lu checks, %lu failures.\n",
+            _tests_checks, _tests_failures);
+    return (_tests_failures == 0 ? 0 : 1);
+}
+
@@ -0,0 +1,280 @@
+
+#include "strmatch.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <locale.h>
+#include <limits.h>
+#include <wchar.h>
+#include <wctype.h>
+
+/* The number of random hays checked for each implementation. */
+#define TESTS_ROUNDS 3000
+/* The longest hay generated. */
+#define TESTS_HAY    96
+
+/* The pieces the hays are made of : ASCII letters of both cases and UTF-8
+ * characters which lower case has the same length, or none.
+ */
+static const char* _tests_pieces[] = {
+    "a", "b", "A", "B", "x", " ", "\xc3\xa9", "\xc3\x89", "\xc3\x9f",
+    "\xce\xa3", "\xcf\x83", "\xcf\x82"
+};
+#define TESTS_PIECES (sizeof(_tests_pieces) / sizeof(_tests_pieces[0]))
+
+static const char* _tests_impls[] = { "scalar", "sse2", "avx2" };
+static const char* _tests_impl;
+static unsigned long _tests_checks;
+static unsigned long _tests_failures;
+
+/* A xorshift generator, so that the runs are reproducible. */
+static uint64_t _tests_state = 88172645463325252ULL;
+static size_t _tests_rand(size_t nb)
+{
+    _tests_state ^= _tests_state << 13;
+    _tests_state ^= _tests_state >> 7;
+    _tests_state ^= _tests_state << 17;
+    return (size_t)(_tests_state % nb);
+}
+
+/* Fill str with random pieces, up to len bytes. Returns the length used. */
+static size_t _tests_random(char* str, size_t len)
+{
+    const char* piece;
+    size_t used = 0;
+    for(;;) {
+        piece = _tests_pieces[_tests_rand(TESTS_PIECES)];
+        if(used + strlen(piece) > len)
+            return used;
+        memcpy(str + used, piece, strlen(piece));
+        used += strlen(piece);
+    }
+}
+
+/* The reference folding : each character is replaced by its lower case if it
+ * has the same length, the invalid bytes are kept.
+ */
+static void _tests_fold(const char* str, size_t len, char* out)
+{
+    char buffer[MB_LEN_MAX];
+    mbstate_t st;
+    wchar_t wc;
+    size_t i, l;
+
+    memset(&st, 0, sizeof(mbstate_t));
+    for(i = 0; i < len; i += l) {
+        l = mbrtowc(&wc, str + i, len - i, &st);
+        if(l == (size_t)-1 || l == (size_t)-2 || l == 0) {
+            memset(&st, 0, sizeof(mbstate_t));
+            out[i] = str[i];
+            l = 1;
+        }
+        else if(wcrtomb(buffer, towlower(wc), &st) == l)
+            memcpy(out + i, buffer, l);
+        else
+            memcpy(out + i, str + i, l);
+    }
+}
+
+/* The reference search : the offset of the first occurence, -1 if none. */
+static long _tests_find(const char* hay, size_t len,
+        const char* ndl, size_t n, bool icase)
+{
+    char fhay[TESTS_HAY];
+    char fndl[TESTS_HAY];
+    size_t i;
+
+    if(icase) {
+        _tests_fold(hay, len, fhay);
+        _tests_fold(ndl, n, fndl);
+        hay = fhay;
+        ndl = fndl;
+    }
+    for(i = 0; i + n <= len; ++i) {
+        if(memcmp(hay + i, ndl, n) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void _tests_check(bool ok, const char* what, const char* hay,
+        size_t len, const char* ndl, size_t n, int flags)
+{
+    ++_tests_checks;
+    if(ok)
+        return;
+    ++_tests_failures;
+    if(_tests_failures > 20)
+        return;
+    printf("FAIL %s %s%s : hay \"%.*s\" needle \"%.*s\"\n", _tests_impl, what,
+            (flags & STRMATCH_ICASE ? " icase" : ""),
+            (int)len, hay, (int)n, ndl);
+}
+
+/* Compare strmatch_search and strmatch_prefix to the references. */
+static void _tests_single(const char* hay, size_t len,
+        const char* ndl, size_t n, int flags)
+{
+    char buffer[TESTS_HAY + 1];
+    strmatch_t* m;
+    const char* found;
+    long ref;
+    size_t off;
+
+    memcpy(buffer, ndl, n);
+    buffer[n] = '\0';
+    m = strmatch_compile(buffer, flags);
+    if(!m) {
+        _tests_check(false, "compile", hay, len, ndl, n, flags);
+        return;
+    }
+
+    ref   = _tests_find(hay, len, ndl, n, flags & STRMATCH_ICASE);
+    found = strmatch_search(m, hay, len);
+    _tests_check((found ? found - hay : -1) == ref, "search",
+            hay, len, ndl, n, flags);
+
+    for(off = 0; off <= len; off += 1 + _tests_rand(8)) {
+        ref = _tests_find(hay + off, (n < len - off ? n : len - off),
+                ndl, n, flags & STRMATCH_ICASE);
+        _tests_check(strmatch_prefix(m, hay + off, len - off) == (ref == 0),
+                "prefix", hay + off, len - off, ndl, n, flags);
+    }
+    strmatch_destroy(m);
+}
+
+/* Compare strmatch_multi_search to the references. */
+static void _tests_multi(const char* hay, size_t len,
+        char ndls[][TESTS_HAY + 1], size_t nb, int flags)
+{
+    const char* ptrs[16];
+    strmatch_multi_t* m;
+    const char* found;
+    long ref, pos;
+    size_t i, which, refwhich;
+
+    ref      = -1;
+    refwhich = 0;
+    for(i = 0; i < nb; ++i) {
+        ptrs[i] = ndls[i];
+        pos = _tests_find(hay, len, ndls[i], strlen(ndls[i]),
+                flags & STRMATCH_ICASE);
+        if(pos >= 0 && (ref < 0 || pos < ref)) {
+            ref      = pos;
+            refwhich = i;
+        }
+    }
+
+    m = strmatch_multi_compile(ptrs, nb, flags);
+    if(!m) {
+        _tests_check(false, "multi compile", hay, len, "", 0, flags);
+        return;
+    }
+    which = nb;
+    found = strmatch_multi_search(m, hay, len, &which);
+    _tests_check((found ? found - hay : -1) == ref
+            && (!found || which == refwhich), "multi",
+            hay, len, ndls[0], strlen(ndls[0]), flags);
+    strmatch_multi_destroy(m);
+}
+
+/* Pick a needle : a part of hay, crossing a block edge most of the time,
+ * with its case changed or not, or random pieces.
+ */
+static size_t _tests_needle(const char* hay, size_t len, char* ndl)
+{
+    size_t edge, n, off, i;
+
+    if(len == 0 || _tests_rand(4) == 0)
+        return _tests_random(ndl, 1 + _tests_rand(40));
+
+    /* The needle starts before the edge and ends after it. */
+    n    = 1 + _tests_rand(len < 40 ? len : 40);
+    edge = 16 * (1 + _tests_rand(5));
+    off  = edge - (n > 1 ? 1 + _tests_rand(n - 1) : 0);
+    if(off > edge)
+        off = 0;
+    if(off + n > len)
+        off = len - n;
+    memcpy(ndl, hay + off, n);
+    if(_tests_rand(2)) {
+        for(i = 0; i < n; ++i) {
+            if(ndl[i] >= 'a' && ndl[i] <= 'z')
+                ndl[i] += 'A' - 'a';
+            else if(ndl[i] >= 'A' && ndl[i] <= 'Z')
+                ndl[i] += 'a' - 'A';
+        }
+    }
+    return n;
+}
+
+static void _tests_run()
+{
+    char* hay;
+    char ndls[12][TESTS_HAY + 1];
+    char folded[TESTS_HAY];
+    char reference[TESTS_HAY];
+    size_t round, len, n, i, nb;
+    int flags;
+
+    for(round = 0; round < TESTS_ROUNDS; ++round) {
+        /* The hay is allocated to its exact size, so that reading after it
+         * is caught by the memory checkers.
+         */
+        hay = malloc(TESTS_HAY);
+        len = _tests_random(hay, _tests_rand(TESTS_HAY + 1));
+        hay = realloc(hay, len ? len : 1);
+
+        _tests_check(strmatch_ascii(hay, len)
+                == (_tests_find(hay, len, "\x80", 0, false) == 0
+                    && !memchr(hay, 0xc3, len) && !memchr(hay, 0xce, len)
+                    && !memchr(hay, 0xcf, len)),
+                "ascii", hay, len, "", 0, 0);
+        strmatch_fold(hay, len, folded);
+        _tests_fold(hay, len, reference);
+        _tests_check(memcmp(folded, reference, len) == 0, "fold",
+                hay, len, "", 0, 0);
+
+        for(flags = 0; flags <= STRMATCH_ICASE; flags += STRMATCH_ICASE) {
+            for(i = 0; i < 4; ++i) {
+                n = _tests_needle(hay, len, ndls[0]);
+                _tests_single(hay, len, ndls[0], n, flags);
+            }
+
+            /* Below and above the count where all the needles are scanned
+             * at once.
+             */
+            nb = (_tests_rand(2) ? 3 : 12);
+            for(i = 0; i < nb; ++i) {
+                n = _tests_needle(hay, len, ndls[i]);
+                ndls[i][n] = '\0';
+            }
+            _tests_multi(hay, len, ndls, nb, flags);
+        }
+        free(hay);
+    }
+}
+
+int main()
+{
+    int impl;
+
+    if(!setlocale(LC_ALL, "C.UTF-8") && !setlocale(LC_ALL, "en_US.UTF-8")) {
+        printf("No UTF-8 locale.\n");
+        return 1;
+    }
+
+    for(impl = STRMATCH_SCALAR; impl <= STRMATCH_AVX2; ++impl) {
+        _tests_impl = _tests_impls[impl];
+        if(!strmatch_use(impl)) {
+            printf("strmatch : %s not supported, skipped.\n", _tests_impl);
+            continue;
+        }
+        _tests_run();
+    }
+
+    printf("strmatch : %lu checks, %lu failures.\n",
+            _tests_checks, _tests_failures);
+    return (_tests_failures == 0 ? 0 : 1);
+}
+
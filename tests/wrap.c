@@ -0,0 +1,127 @@
+
+#include "wrap.h"
+#include <stdio.h>
+#include <stdint.h>
+
+/* The number of random operations done. */
+#define TESTS_ROUNDS 200000
+/* The most lines the index is filled with before it is cleared. */
+#define TESTS_LINES  3000
+
+/* The reference : the columns of the lines, and the width. */
+static size_t _tests_cols[TESTS_LINES];
+static size_t _tests_nb;
+static size_t _tests_width;
+
+static unsigned long _tests_checks;
+static unsigned long _tests_failures;
+
+/* A xorshift generator, so that the runs are reproducible. */
+static uint64_t _tests_state = 88172645463325252ULL;
+static size_t _tests_rand(size_t nb)
+{
+    _tests_state ^= _tests_state << 13;
+    _tests_state ^= _tests_state >> 7;
+    _tests_state ^= _tests_state << 17;
+    return (size_t)(_tests_state % nb);
+}
+
+/* Pick a number of columns or a width : small ones, ones around the powers
+ * of two the groups are made of, and 0.
+ */
+static size_t _tests_size()
+{
+    size_t p;
+    switch(_tests_rand(4)) {
+        case 0:
+            return _tests_rand(4);
+        case 1:
+            return _tests_rand(100);
+        case 2:
+            p = (size_t)1 << _tests_rand(14);
+            return p - 1 + _tests_rand(3);
+        default:
+            return _tests_rand(20000);
+    }
+}
+
+static void _tests_check(bool ok, const char* what, size_t arg)
+{
+    ++_tests_checks;
+    if(ok)
+        return;
+    ++_tests_failures;
+    if(_tests_failures > 20)
+        return;
+    printf("FAIL %s %lu : %lu lines, width %lu\n", what, arg,
+            _tests_nb, _tests_width);
+}
+
+/* The reference number of rows of a line. */
+static size_t _tests_rows(size_t vid)
+{
+    size_t width = (_tests_width > 0 ? _tests_width : 1);
+    if(vid >= _tests_nb || _tests_cols[vid] <= width)
+        return 1;
+    return (_tests_cols[vid] + width - 1) / width;
+}
+
+/* Compare the whole index to a naive prefix sum. */
+static void _tests_compare()
+{
+    size_t vid, row, sum, i, found, skip, got;
+
+    _tests_check(wrap_count() == _tests_nb, "count", 0);
+    sum = 0;
+    for(vid = 0; vid < _tests_nb + 3; ++vid) {
+        _tests_check(wrap_rows(vid) == _tests_rows(vid), "rows", vid);
+        _tests_check(wrap_row(vid) == sum, "row", vid);
+        sum += _tests_rows(vid);
+    }
+
+    for(i = 0; i < 50; ++i) {
+        row = _tests_rand(sum + 1);
+        skip = row;
+        for(vid = 0; vid < _tests_nb && skip >= _tests_rows(vid); ++vid)
+            skip -= _tests_rows(vid);
+        found = wrap_find(row, &got);
+        _tests_check(found == vid && got == skip, "find", row);
+    }
+}
+
+int main()
+{
+    size_t round, op;
+
+    wrap_init();
+    _tests_width = 80;
+    wrap_clear(_tests_width);
+
+    for(round = 0; round < TESTS_ROUNDS; ++round) {
+        op = _tests_rand(100);
+        if(op < 80 && _tests_nb < TESTS_LINES) {
+            _tests_cols[_tests_nb] = _tests_size();
+            if(!wrap_push(_tests_cols[_tests_nb]))
+                _tests_check(false, "push", _tests_nb);
+            ++_tests_nb;
+        }
+        else if(op < 98) {
+            _tests_width = _tests_size();
+            wrap_resize(_tests_width);
+        }
+        else {
+            _tests_nb    = 0;
+            _tests_width = _tests_size();
+            wrap_clear(_tests_width);
+        }
+
+        if(_tests_rand(64) == 0 || op >= 80)
+            _tests_compare();
+    }
+    wrap_quit();
+
+    printf("wrap : %lu checks, %lu failures.\n",
+            _tests_checks, _tests_failures);
+    return (_tests_failures == 0 ? 0 : 1);
+}
+